@@ -0,0 +1,361 @@
+//
+//  ArrayFile.h
+//  Expand
+//
+
+#ifndef ArrayFile_h
+#define ArrayFile_h
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Matrix.h"
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // file format
+    // --------------------------------------------------------------------
+    
+    // version written to new files, files of a later version being rejected
+    constexpr std::uint32_t ArrayFileVersion = 1;
+    
+    /**
+     *
+     * Header of the binary files holding arrays of fixed-size vectors or
+     * matrices, followed by their elements from byte \c offset on.
+     *
+     * Every item is stored as \c rows rows of \c cols scalars, rows being
+     * \c leading scalars apart and items \c stride scalars apart, so that
+     * the padding of the \c Aligned policy is kept as is. Scalars are stored
+     * in the byte order of the writer, recorded in \c byteOrder, and the
+     * elements start on a 64-byte boundary.
+     *
+     */
+    struct ArrayFileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        
+        // 0 for vectors and 1 for matrices
+        std::uint32_t kind;
+        
+        // 'f' for floating point, 'i' for signed and 'u' for unsigned
+        // integers, and size in bytes
+        std::uint32_t scalar;
+        std::uint32_t scalarSize;
+        
+        std::uint32_t rows;
+        std::uint32_t cols;
+        std::uint32_t leading;
+        std::uint64_t stride;
+        std::uint64_t count;
+        std::uint64_t offset;
+    };
+    
+    static_assert(sizeof(ArrayFileHeader) == 64, "ArrayFileHeader must span a single cache line");
+    
+    constexpr char ArrayFileMagic[8] = {'E', 'X', 'P', 'A', 'N', 'D', 'A', 'F'};
+    
+    constexpr std::uint32_t ArrayFileByteOrder = 0x01020304;
+    
+    /**
+     *
+     * Description of the items of type \c E stored in array files: owning
+     * fixed-size Vectors and Matrices, read back as views of type
+     * \c view_type.
+     *
+     */
+    template <typename E>
+    struct ArrayItem;
+    
+    template <typename T, std::size_t N, typename A>
+    struct ArrayItem<Vector<T, N, 0, A>> {
+        
+        static_assert(N != Dynamic, "Array files only hold fixed-size vectors");
+        
+        typedef T               value_type;
+        typedef Vector<T, N, 1> view_type;
+        
+        static constexpr std::uint32_t kind = 0;
+        static constexpr std::size_t rows = 1;
+        static constexpr std::size_t cols = N;
+        static constexpr std::size_t leading = A::template padded<T>(N);
+        static constexpr std::size_t stride = leading;
+        
+        static view_type view(T* const t, std::size_t const&) {
+            return view_type(t);
+        }
+    };
+    
+    template <typename T, std::size_t M, std::size_t N, typename A>
+    struct ArrayItem<Matrix<T, M, N, A>> {
+        
+        static_assert(M != Dynamic, "Array files only hold fixed-size matrices");
+        static_assert(!std::is_same<A, Mapped>::value, "Array files only hold matrices owning their elements");
+        
+        typedef T                    value_type;
+        typedef MatrixRef<T, M, N>   view_type;
+        
+        static constexpr std::uint32_t kind = 1;
+        static constexpr std::size_t rows = M;
+        static constexpr std::size_t cols = N;
+        static constexpr std::size_t leading = A::template leading<T>(N);
+        static constexpr std::size_t stride = M * leading;
+        
+        static view_type view(T* const t, std::size_t const& leading) {
+            return view_type(t, leading);
+        }
+    };
+    
+    // scalar type code of \c T
+    template <typename T>
+    constexpr std::uint32_t scalarCode() {
+        static_assert(std::is_arithmetic<T>::value, "Array files only hold arithmetic scalars");
+        return std::is_floating_point<T>::value ? 'f' : std::is_signed<T>::value ? 'i' : 'u';
+    }
+    
+    // --------------------------------------------------------------------
+    // writer
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Writes items of type \c E to an array file as they come, the number of
+     * items being recorded in the header when the file is closed.
+     *
+     * Failures to write throw \c std::runtime_error.
+     *
+     */
+    template <typename E>
+    class ArrayFileWriter {
+        
+        typedef ArrayItem<E> Item;
+        typedef typename Item::value_type T;
+        
+        static_assert(std::is_trivially_copyable<E>::value && sizeof(E) == Item::stride * sizeof(T),
+                      "Array file items must be stored as their elements only");
+        
+    public:
+        
+        // creates or truncates the file at \c path
+        explicit ArrayFileWriter(std::string const& path)
+            : _path(path), _file(path, std::ios::binary | std::ios::trunc), _count(0) {
+            if (!_file) {
+                throw std::runtime_error("Cannot create array file " + _path);
+            }
+            writeHeader();
+        }
+        
+        ArrayFileWriter(ArrayFileWriter<E> const&) = delete;
+        
+        ArrayFileWriter<E>& operator=(ArrayFileWriter<E> const&) = delete;
+        
+        // closes the file, errors being ignored
+        ~ArrayFileWriter() {
+            if (_file.is_open()) {
+                try {
+                    close();
+                } catch (...) {
+                }
+            }
+        }
+        
+        // number of items written so far
+        std::size_t size() const {
+            return _count;
+        }
+        
+        // appends an item, expressions being evaluated first
+        void write(E const& item) {
+            write(&item, 1);
+        }
+        
+        // appends the \c n items at \c items
+        void write(E const* items, std::size_t const& n) {
+            _file.write(reinterpret_cast<const char*>(items), std::streamsize(n * sizeof(E)));
+            if (!_file) {
+                throw std::runtime_error("Cannot write to array file " + _path);
+            }
+            _count += n;
+        }
+        
+        // records the number of items and closes the file
+        void close() {
+            _file.seekp(0);
+            writeHeader();
+            _file.close();
+            if (!_file) {
+                throw std::runtime_error("Cannot write to array file " + _path);
+            }
+        }
+        
+    private:
+        
+        std::string _path;
+        std::ofstream _file;
+        std::size_t _count;
+        
+        void writeHeader() {
+            ArrayFileHeader header = {};
+            std::memcpy(header.magic, ArrayFileMagic, sizeof(header.magic));
+            header.version = ArrayFileVersion;
+            header.byteOrder = ArrayFileByteOrder;
+            header.kind = Item::kind;
+            header.scalar = scalarCode<T>();
+            header.scalarSize = sizeof(T);
+            header.rows = Item::rows;
+            header.cols = Item::cols;
+            header.leading = Item::leading;
+            header.stride = Item::stride;
+            header.count = _count;
+            header.offset = sizeof(ArrayFileHeader);
+            _file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            if (!_file) {
+                throw std::runtime_error("Cannot write to array file " + _path);
+            }
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // reader
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Array file of items of type \c E mapped in memory, whose items are
+     * exposed as views: nothing is read until accessed, and pages are shared
+     * with the system cache.
+     *
+     * The mapping is private, so that writing through the views modifies a
+     * copy of the touched pages and never the file itself. Files written for
+     * another storage policy of \c E are read as well, the views following
+     * the leading dimension of the file.
+     *
+     * Files which cannot be opened or do not hold items of type \c E throw
+     * \c std::runtime_error.
+     *
+     */
+    template <typename E>
+    class ArrayFile {
+        
+        typedef ArrayItem<E> Item;
+        typedef typename Item::value_type T;
+        
+    public:
+        
+        typedef typename Item::view_type view_type;
+        
+        explicit ArrayFile(std::string const& path) : _mapping(nullptr), _length(0) {
+            int const fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "Cannot open array file " + path);
+            }
+            struct stat status;
+            if (::fstat(fd, &status) != 0 || std::size_t(status.st_size) < sizeof(ArrayFileHeader)) {
+                ::close(fd);
+                throw std::runtime_error("Truncated array file " + path);
+            }
+            _length = std::size_t(status.st_size);
+            void* mapping = ::mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (mapping == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "Cannot map array file " + path);
+            }
+            _mapping = static_cast<char*>(mapping);
+            
+            std::memcpy(&_header, _mapping, sizeof(_header));
+            const char* error = validate();
+            if (error) {
+                ::munmap(_mapping, _length);
+                throw std::runtime_error(std::string(error) + " in array file " + path);
+            }
+        }
+        
+        ArrayFile(ArrayFile<E>&& rhs) noexcept
+            : _mapping(rhs._mapping), _length(rhs._length), _header(rhs._header) {
+            rhs._mapping = nullptr;
+            rhs._length = 0;
+        }
+        
+        ArrayFile(ArrayFile<E> const&) = delete;
+        
+        ArrayFile<E>& operator=(ArrayFile<E> const&) = delete;
+        
+        ~ArrayFile() {
+            if (_mapping) {
+                ::munmap(_mapping, _length);
+            }
+        }
+        
+        // number of items
+        std::size_t size() const {
+            return std::size_t(_header.count);
+        }
+        
+        bool empty() const {
+            return size() == 0;
+        }
+        
+        // distance between two consecutive items
+        std::size_t stride() const {
+            return std::size_t(_header.stride);
+        }
+        
+        // pointer to the first element of the first item
+        T* data() const {
+            return reinterpret_cast<T*>(_mapping + _header.offset);
+        }
+        
+        view_type operator[](std::size_t const& i) const {
+            ASSERT(i < size(), "Index (" << i << ") out of bounds in ArrayFile of size " << size());
+            return Item::view(data() + i * stride(), _header.leading);
+        }
+        
+    private:
+        
+        char* _mapping;
+        std::size_t _length;
+        ArrayFileHeader _header;
+        
+        // reason why the file cannot be read as items of type \c E, if any
+        const char* validate() const {
+            if (std::memcmp(_header.magic, ArrayFileMagic, sizeof(_header.magic)) != 0) {
+                return "Bad magic number";
+            }
+            if (_header.version == 0 || _header.version > ArrayFileVersion) {
+                return "Unsupported version";
+            }
+            if (_header.byteOrder != ArrayFileByteOrder) {
+                return "Foreign byte order";
+            }
+            if (_header.kind != Item::kind || _header.rows != Item::rows || _header.cols != Item::cols) {
+                return "Mismatched item dimensions";
+            }
+            if (_header.scalar != scalarCode<T>() || _header.scalarSize != sizeof(T)) {
+                return "Mismatched scalar type";
+            }
+            if (_header.leading < Item::cols || _header.stride < (Item::rows - 1) * _header.leading + Item::cols) {
+                return "Overlapping items";
+            }
+            if (_header.offset % alignof(T) != 0 || _header.offset > _length ||
+                (_length - _header.offset) / sizeof(T) / _header.stride < _header.count) {
+                return "Truncated data";
+            }
+            return nullptr;
+        }
+    };
+}
+
+#endif /* ArrayFile_h */
@@ -0,0 +1,128 @@
+//
+//  Check.h
+//  Expand
+//
+
+#ifndef Check_h
+#define Check_h
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+
+// failures are handled out of line so that the code around the checks
+// stays small, their message only being formatted once they fail
+#define EXPAND_COLD __attribute__((cold, noinline))
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // checking policies
+    // --------------------------------------------------------------------
+    
+    // reports the failed condition and its message on the standard error,
+    // then exits
+    struct Checked {
+        
+        static constexpr bool enabled = true;
+        
+        template <typename F>
+        [[noreturn]] EXPAND_COLD static void fail(char const* condition, char const* file, int line, F const& message) {
+            std::cerr << "Assertion '" << condition << "' failed in " << file << " line " << line << ": ";
+            message(std::cerr);
+            std::cerr << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    };
+    
+    // stops on the failing check, under a debugger or with a core dump,
+    // without formatting its message
+    struct Trap {
+        
+        static constexpr bool enabled = true;
+        
+        template <typename F>
+        [[noreturn]] EXPAND_COLD static void fail(char const*, char const*, int, F const&) {
+            __builtin_trap();
+        }
+    };
+    
+    // compiles the checks out, conditions not even being evaluated
+    struct Unchecked {
+        
+        static constexpr bool enabled = false;
+        
+        template <typename F>
+        [[noreturn]] static void fail(char const*, char const*, int, F const&) {
+            __builtin_unreachable();
+        }
+    };
+    
+    // policy of the checks made by the library, of the accessors of every
+    // Vector and Matrix type unless specialized otherwise
+#ifndef EXPAND_CHECK_POLICY
+#   define EXPAND_CHECK_POLICY Checked
+#endif
+    
+    typedef EXPAND_CHECK_POLICY DefaultCheck;
+    
+    // policy of the bounds and dimension checks of the Vector or Matrix type
+    // \c E, which may be specialized before \c E is first used, e.g.
+    // template <> struct CheckPolicy<Vector<float, 3>> { typedef Trap type; };
+    template <typename E>
+    struct CheckPolicy {
+        typedef DefaultCheck type;
+    };
+    
+    // --------------------------------------------------------------------
+    // unchecked access
+    // --------------------------------------------------------------------
+    
+    // true for the Vector and Matrix instances, which provide unchecked
+    // accessors besides their checked operators
+    template <typename E, typename = void>
+    struct HasUnchecked : std::false_type {};
+    
+    template <typename E>
+    struct HasUnchecked<E, decltype(void(std::declval<E&>().unchecked(0)))> : std::true_type {};
+    
+    // element \c i of expression \c e as read by the evaluation kernels and
+    // the expression nodes, whose indices derive from sizes checked once when
+    // the expression was built, hence bypassing the checked operators
+    template <typename E>
+    constexpr decltype(auto) element(E& e, std::size_t const& i) {
+        if constexpr (HasUnchecked<E>::value) {
+            return e.unchecked(i);
+        } else {
+            return e[i];
+        }
+    }
+    
+    // element (i, j) of matrix expression \c e, the same way
+    template <typename E>
+    constexpr decltype(auto) element(E& e, std::size_t const& i, std::size_t const& j) {
+        if constexpr (HasUnchecked<E>::value) {
+            return e.unchecked(i, j);
+        } else {
+            return e(i, j);
+        }
+    }
+}
+
+// checks \c condition according to \c Policy, \c message being streamed
+// only once it fails
+#define EXPAND_CHECK(Policy, condition, message) \
+    do { \
+        if constexpr (Policy::enabled) { \
+            if (!(condition)) { \
+                Policy::fail(#condition, __FILE__, __LINE__, [&](std::ostream& stream) { stream << message; }); \
+            } \
+        } \
+    } while (false)
+
+// checks made by the library regardless of the operand types
+#define ASSERT(condition, message) EXPAND_CHECK(::expand::DefaultCheck, condition, message)
+
+#endif /* Check_h */
@@ -0,0 +1,164 @@
+//
+//  Dispatch.h
+//  Expand
+//
+
+#ifndef Dispatch_h
+#define Dispatch_h
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#include "Packet.h"
+
+// attributes of the kernels compiled for each instruction set, every call
+// they make being inlined so that the whole kernel uses it
+#define EXPAND_TARGET_SSE2 __attribute__((target("sse2"), flatten))
+#define EXPAND_TARGET_AVX2 __attribute__((target("avx2,fma,f16c"), flatten))
+#define EXPAND_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,f16c"), flatten))
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // instruction sets
+    // --------------------------------------------------------------------
+    
+    // instruction sets for which the kernels are compiled, from the
+    // narrowest to the widest
+    enum class Isa {
+        Default,    // those enabled at compile time
+        SSE2,
+        AVX2,       // along with FMA and F16C
+        AVX512      // F, BW, DQ and VL, along with AVX2, FMA and F16C
+    };
+    
+    inline char const* isaName(Isa const& isa) {
+        switch (isa) {
+            case Isa::SSE2:
+                return "sse2";
+            case Isa::AVX2:
+                return "avx2";
+            case Isa::AVX512:
+                return "avx512";
+            default:
+                return "default";
+        }
+    }
+    
+    // widest instruction set supported by the processor and the system
+    inline Isa detectIsa() {
+#if EXPAND_DISPATCH
+        __builtin_cpu_init();
+        bool const avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+            __builtin_cpu_supports("f16c");
+        if (avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+            __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+            return Isa::AVX512;
+        }
+        return avx2 ? Isa::AVX2 : Isa::SSE2;
+#else
+        return Isa::Default;
+#endif
+    }
+    
+    // detected instruction set, or the one named by the \c EXPAND_ISA
+    // environment variable when the processor supports it
+    inline Isa selectIsa() {
+        Isa const detected = detectIsa();
+        if (char const* name = std::getenv("EXPAND_ISA")) {
+            for (Isa const isa : {Isa::SSE2, Isa::AVX2, Isa::AVX512}) {
+                if (std::strcmp(name, isaName(isa)) == 0) {
+                    return isa < detected ? isa : detected;
+                }
+            }
+        }
+        return detected;
+    }
+    
+    // instruction set of the kernels, selected when the program starts:
+    // evaluations taking place before, from other static initializers,
+    // use those enabled at compile time
+    inline Isa const selectedIsa = selectIsa();
+    
+    inline Isa isa() {
+        return selectedIsa;
+    }
+    
+    // --------------------------------------------------------------------
+    // dispatch
+    // --------------------------------------------------------------------
+    
+    // calls \c f(std::integral_constant<std::size_t, W>()) in code compiled
+    // for the instruction set whose packets are \c W bytes wide
+    template <std::size_t W>
+    struct Target {
+        template <typename F>
+        static decltype(auto) run(F const& f) {
+            return f(std::integral_constant<std::size_t, W>());
+        }
+    };
+
+#if EXPAND_DISPATCH
+    template <>
+    struct Target<16> {
+        template <typename F>
+        EXPAND_TARGET_SSE2 static decltype(auto) run(F const& f) {
+            return f(std::integral_constant<std::size_t, 16>());
+        }
+    };
+    
+    template <>
+    struct Target<32> {
+        template <typename F>
+        EXPAND_TARGET_AVX2 static decltype(auto) run(F const& f) {
+            return f(std::integral_constant<std::size_t, 32>());
+        }
+    };
+    
+    template <>
+    struct Target<64> {
+        template <typename F>
+        EXPAND_TARGET_AVX512 static decltype(auto) run(F const& f) {
+            return f(std::integral_constant<std::size_t, 64>());
+        }
+    };
+#endif
+    
+    // calls \c f(std::integral_constant<std::size_t, W>()), \c W being the
+    // width in bytes of the packets of the selected instruction set, so
+    // that \c f can pick parameters such as block sizes before running
+    // kernels through \c Target<W>
+    template <typename F>
+    decltype(auto) selectWidth(F const& f) {
+#if EXPAND_DISPATCH
+        switch (isa()) {
+            case Isa::AVX512:
+                return f(std::integral_constant<std::size_t, 64>());
+            case Isa::AVX2:
+                return f(std::integral_constant<std::size_t, 32>());
+            case Isa::SSE2:
+                return f(std::integral_constant<std::size_t, 16>());
+            default:
+                break;
+        }
+#endif
+        return f(std::integral_constant<std::size_t, EXPAND_SIMD_BYTES>());
+    }
+    
+    // calls \c f(std::integral_constant<std::size_t, W>()) in code compiled
+    // for the selected instruction set, \c W being the width of its packets
+    template <typename F>
+    decltype(auto) dispatch(F const& f) {
+        return selectWidth([&](auto w) -> decltype(auto) {
+            return Target<decltype(w)::value>::run(f);
+        });
+    }
+}
+
+EXPAND_PSABI_END
+
+#endif /* Dispatch_h */
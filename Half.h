@@ -0,0 +1,302 @@
+//
+//  Half.h
+//  Expand
+//
+
+#ifndef Half_h
+#define Half_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Packet.h"
+
+// conversions of whole packets of half-precision floats, inlined into the
+// kernels compiled for the instruction sets providing them
+#define EXPAND_TARGET_F16C __attribute__((target("avx,f16c")))
+#define EXPAND_TARGET_AVX512F __attribute__((target("avx512f")))
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // bit-level conversions
+    // --------------------------------------------------------------------
+    
+    // bits of \c x reinterpreted as a \c To, scalar or packet alike
+    template <typename To, typename From>
+    inline To bitCast(From const& x) {
+        static_assert(sizeof(To) == sizeof(From), "Bit casts must preserve the size");
+        To t;
+        std::memcpy(&t, &x, sizeof(To));
+        return t;
+    }
+    
+    // the following work on the bits of single-precision floats held by
+    // \c U, an unsigned 32-bit integer or a packet of them, the floats
+    // themselves being held by \c F, so that scalars and packets convert
+    // alike
+    
+    // bits of the half-precision floats, in the low half of each lane,
+    // nearest to the single-precision floats \c f, ties to even
+    template <typename U, typename F>
+    inline U halfFromFloat(U f) {
+        U const sign = f & 0x80000000u;
+        f ^= sign;
+        // too large: infinity, or a quiet NaN
+        U const large = f > 0x7f800000u ? U{} + 0x7e00u : U{} + 0x7c00u;
+        // subnormal: rounded by the addition of the smallest normal number
+        // whose ulp is that of the half-precision subnormals
+        U const magic = U{} + (126u << 23);
+        U const small = bitCast<U>(bitCast<F>(f) + bitCast<F>(magic)) - magic;
+        // normal: exponent rebiased and mantissa rounded
+        U const normal = (f + 0xc8000fffu + ((f >> 13) & 1u)) >> 13;
+        U const h = f >= (143u << 23) ? large : f < (113u << 23) ? small : normal;
+        return h | sign >> 16;
+    }
+    
+    // bits of the single-precision floats equal to the half-precision ones
+    // held in the low half of each lane of \c h
+    template <typename U, typename F>
+    inline U floatFromHalf(U const& h) {
+        // exponent rebiased by the product, which also normalizes subnormals
+        U f = bitCast<U>(bitCast<F>((h & 0x7fffu) << 13) * bitCast<F>(U{} + (239u << 23)));
+        // infinities and NaNs keep the largest exponent
+        f |= f >= (143u << 23) ? U{} + (255u << 23) : U{};
+        return f | (h & 0x8000u) << 16;
+    }
+    
+    // bits of the bfloat16 nearest to the single-precision floats \c f, ties
+    // to even, NaNs staying quiet NaNs
+    template <typename U>
+    inline U bfloat16FromFloat(U const& f) {
+        U const rounded = (f + 0x7fffu + ((f >> 16) & 1u)) >> 16;
+        return (f & 0x7fffffffu) > 0x7f800000u ? (f >> 16) | 0x40u : rounded;
+    }
+    
+    // --------------------------------------------------------------------
+    // instructions
+    // --------------------------------------------------------------------
+    
+    // true when packets of \c W bytes of floats are converted from and to
+    // half precision by single instructions: F16C ones when enabled at
+    // compile time or for the AVX2 kernels selected at runtime, whose
+    // processors all have them, and AVX-512 ones for 64-byte packets
+    template <std::size_t W>
+    constexpr bool hasHalfInstructions() {
+#if defined(__x86_64__) || defined(__i386__)
+#   if defined(__F16C__)
+        if (W == 16 || W == 32) {
+            return true;
+        }
+#   endif
+#   if defined(__AVX512F__)
+        if (W == 64) {
+            return true;
+        }
+#   endif
+        return EXPAND_DISPATCH && (W == 32 || W == 64);
+#else
+        return false;
+#endif
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    EXPAND_TARGET_F16C inline __m128 widenHalves4(const void* p) {
+        return _mm_cvtph_ps(_mm_loadl_epi64(static_cast<__m128i const*>(p)));
+    }
+    
+    EXPAND_TARGET_F16C inline __m256 widenHalves8(const void* p) {
+        return _mm256_cvtph_ps(_mm_loadu_si128(static_cast<__m128i const*>(p)));
+    }
+    
+    EXPAND_TARGET_AVX512F inline __m512 widenHalves16(const void* p) {
+        return _mm512_maskz_cvtph_ps(0xffff, _mm256_loadu_si256(static_cast<__m256i const*>(p)));
+    }
+    
+    EXPAND_TARGET_F16C inline void narrowHalves4(void* p, __m128 const& x) {
+        _mm_storel_epi64(static_cast<__m128i*>(p), _mm_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+    }
+    
+    EXPAND_TARGET_F16C inline void narrowHalves8(void* p, __m256 const& x) {
+        _mm_storeu_si128(static_cast<__m128i*>(p), _mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+    }
+    
+    EXPAND_TARGET_AVX512F inline void narrowHalves16(void* p, __m512 const& x) {
+        _mm256_storeu_si256(static_cast<__m256i*>(p), _mm512_maskz_cvtps_ph(0xffff, x, _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    
+    // --------------------------------------------------------------------
+    // storage types
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * IEEE 754 half-precision float, as a storage type.
+     *
+     * Vectors and matrices of \c half hold elements of 2 bytes, which their
+     * expressions and reductions widen to \c float, results being rounded
+     * to the nearest \c half, ties to even, once stored. Packets are
+     * converted by F16C or AVX-512 instructions where available and bit by
+     * bit elsewhere, both rounding alike.
+     *
+     */
+    struct half {
+        
+        std::uint16_t bits;
+        
+        half() = default;
+        
+        half(float const& f) : bits(static_cast<std::uint16_t>(
+            halfFromFloat<std::uint32_t, float>(bitCast<std::uint32_t>(f)))) {}
+        
+        operator float() const {
+            return bitCast<float>(floatFromHalf<std::uint32_t, float>(bits));
+        }
+        
+        // computed in single precision, then rounded
+        half& operator+=(float const& f) {
+            return *this = float(*this) + f;
+        }
+        
+        half& operator-=(float const& f) {
+            return *this = float(*this) - f;
+        }
+        
+        half& operator*=(float const& f) {
+            return *this = float(*this) * f;
+        }
+        
+        half& operator/=(float const& f) {
+            return *this = float(*this) / f;
+        }
+        
+        // \c P::size contiguous elements at \c p widened into a packet of
+        // floats
+        template <typename P>
+        static typename P::type widen(const half* p) {
+            constexpr std::size_t W = sizeof(typename P::type);
+            static_assert(W == P::size * sizeof(float), "Reduced-precision floats widen to float");
+#if defined(__x86_64__) || defined(__i386__)
+            if constexpr (hasHalfInstructions<W>() && W == 16) {
+                return (typename P::type)widenHalves4(p);
+            } else if constexpr (hasHalfInstructions<W>() && W == 32) {
+                return (typename P::type)widenHalves8(p);
+            } else if constexpr (hasHalfInstructions<W>() && W == 64) {
+                return (typename P::type)widenHalves16(p);
+            } else
+#endif
+            {
+                typedef typename Packet<std::uint16_t, W / 2>::type Halves;
+                typedef typename Packet<std::uint32_t, W>::type Bits;
+                Halves h;
+                std::memcpy(&h, p, sizeof(Halves));
+                Bits const f = floatFromHalf<Bits, typename P::type>(__builtin_convertvector(h, Bits));
+                return bitCast<typename P::type>(f);
+            }
+        }
+        
+        // packet of floats \c x narrowed into \c P::size contiguous elements
+        // at \c p
+        template <typename P>
+        static void narrow(half* p, typename P::type const& x) {
+            constexpr std::size_t W = sizeof(typename P::type);
+            static_assert(W == P::size * sizeof(float), "Reduced-precision floats widen to float");
+#if defined(__x86_64__) || defined(__i386__)
+            if constexpr (hasHalfInstructions<W>() && W == 16) {
+                narrowHalves4(p, (__m128)x);
+            } else if constexpr (hasHalfInstructions<W>() && W == 32) {
+                narrowHalves8(p, (__m256)x);
+            } else if constexpr (hasHalfInstructions<W>() && W == 64) {
+                narrowHalves16(p, (__m512)x);
+            } else
+#endif
+            {
+                typedef typename Packet<std::uint16_t, W / 2>::type Halves;
+                typedef typename Packet<std::uint32_t, W>::type Bits;
+                Bits const h = halfFromFloat<Bits, typename P::type>(bitCast<Bits>(x));
+                Halves const narrowed = __builtin_convertvector(h, Halves);
+                std::memcpy(p, &narrowed, sizeof(Halves));
+            }
+        }
+    };
+    
+    /**
+     *
+     * Brain floating-point number: the upper 16 bits of a \c float, as a
+     * storage type.
+     *
+     * It keeps the range of \c float with 8 bits of precision, and is
+     * widened and rounded like \c half, its conversions being mere shifts
+     * and additions on every target.
+     *
+     */
+    struct bfloat16 {
+        
+        std::uint16_t bits;
+        
+        bfloat16() = default;
+        
+        bfloat16(float const& f) : bits(static_cast<std::uint16_t>(
+            bfloat16FromFloat(bitCast<std::uint32_t>(f)))) {}
+        
+        operator float() const {
+            return bitCast<float>(std::uint32_t(bits) << 16);
+        }
+        
+        // computed in single precision, then rounded
+        bfloat16& operator+=(float const& f) {
+            return *this = float(*this) + f;
+        }
+        
+        bfloat16& operator-=(float const& f) {
+            return *this = float(*this) - f;
+        }
+        
+        bfloat16& operator*=(float const& f) {
+            return *this = float(*this) * f;
+        }
+        
+        bfloat16& operator/=(float const& f) {
+            return *this = float(*this) / f;
+        }
+        
+        template <typename P>
+        static typename P::type widen(const bfloat16* p) {
+            constexpr std::size_t W = sizeof(typename P::type);
+            static_assert(W == P::size * sizeof(float), "Reduced-precision floats widen to float");
+            typedef typename Packet<std::uint16_t, W / 2>::type Halves;
+            typedef typename Packet<std::uint32_t, W>::type Bits;
+            Halves h;
+            std::memcpy(&h, p, sizeof(Halves));
+            return bitCast<typename P::type>(__builtin_convertvector(h, Bits) << 16);
+        }
+        
+        template <typename P>
+        static void narrow(bfloat16* p, typename P::type const& x) {
+            constexpr std::size_t W = sizeof(typename P::type);
+            static_assert(W == P::size * sizeof(float), "Reduced-precision floats widen to float");
+            typedef typename Packet<std::uint16_t, W / 2>::type Halves;
+            typedef typename Packet<std::uint32_t, W>::type Bits;
+            Halves const narrowed = __builtin_convertvector(bfloat16FromFloat(bitCast<Bits>(x)), Halves);
+            std::memcpy(p, &narrowed, sizeof(Halves));
+        }
+    };
+    
+    template <>
+    struct Widened<half> {
+        typedef float type;
+    };
+    
+    template <>
+    struct Widened<bfloat16> {
+        typedef float type;
+    };
+}
+
+EXPAND_PSABI_END
+
+#endif /* Half_h */
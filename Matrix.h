@@ -8,58 +8,79 @@
 
 #include <iostream>
 
-#include <iostream>
-
-#define ASSERT(condition, message) \
-    do { \
-        if (!(condition)) { \
-            std::cerr << "Assertion '" #condition "' failed in " << __FILE__ \
-                << " line " << __LINE__ << ": " << message << std::endl; \
-            std::exit(EXIT_FAILURE); \
-        } \
-    } while (false)
+#include "Check.h"
 
 #include "MatrixIter.h"
 #include "MatrixIterConst.h"
+#include "MatrixMemory.h"
 
 #include "Vector.h"
 
+#include "MatrixOps.h"
+#include "MatrixProduct.h"
+#include "MatrixTranspose.h"
+#include "MatrixSolve.h"
+
+EXPAND_PSABI_BEGIN
+
 namespace expand {
  
-    template <typename T, std::size_t M, std::size_t N = M>
-    class Matrix {
+    template <typename T, std::size_t M, std::size_t N = M, typename A = Packed>
+    class Matrix : public MatrixMemory<T, M, N, A> {
+        
+        friend class MatrixIter<T, M, N, A>;
+        friend class MatrixIterConst<T, M, N, A>;
+        
+        // distance between two consecutive rows when known at compile time
+        static constexpr std::size_t L = M == Dynamic ? Dynamic : A::template leading<T>(N);
+        
+        // small fixed-size matrices are evaluated fully unrolled
+        static constexpr bool unrolled = M != Dynamic && M * N > 0 && M * N <= EXPAND_UNROLL_LIMIT;
         
-        friend class MatrixIter<T, M, N>;
-        friend class MatrixIterConst<T, M, N>;
+        // views reference foreign memory which they can neither allocate
+        // nor resize
+        static constexpr bool owning = !std::is_same<A, Mapped>::value;
+        
+        // Matrix holding the evaluation of an expression assigned to this one
+        typedef Matrix<T, M, N, typename std::conditional<owning, A, Packed>::type> Evaluated;
+        
+    public:
         
         // --------------------------------------------------------------------
         // STL-compatible type definitions
         // --------------------------------------------------------------------
         
         typedef T                           value_type;
-        typedef MatrixIter<T, M, N>         iterator;
-        typedef MatrixIterConst<T, M, N>    const_iterator;
+        typedef MatrixIter<T, M, N, A>      iterator;
+        typedef MatrixIterConst<T, M, N, A> const_iterator;
         typedef T&                          reference;
         typedef const T&                    const_reference;
         typedef std::ptrdiff_t              difference_type;
         typedef std::size_t                 size_type;
         
         typedef Vector<T, N, 1>             RowVector;
-        typedef Vector<T, M, N>             ColVector;
-        typedef Vector<T, M, N + 1>         TraceVector;
+        typedef Vector<T, M, L>             ColVector;
+        typedef Vector<T, M, L == Dynamic ? Dynamic : L + 1> TraceVector;
+        
+    private:
         
-        // dimensions
-        enum {
-            _rows = M,
-            _cols = N,
-            _size = M * N
-        };
+        using MatrixMemory<T, M, N, A>::_elements;
         
-        // data
-        T _elements[M * N];
+        // policy of the bounds and dimension checks
+        typedef typename MatrixMemory<T, M, N, A>::Check Check;
+        
+        // dimensions of the expressions assigned to this Matrix must agree
+        // with its own when both are known at compile time
+        template <typename E>
+        static constexpr bool agrees = MatrixShapes<Matrix<T, M, N, A>, E>::agree;
         
     public:
         
+        using MatrixMemory<T, M, N, A>::rows;
+        using MatrixMemory<T, M, N, A>::cols;
+        using MatrixMemory<T, M, N, A>::size;
+        using MatrixMemory<T, M, N, A>::stride;
+        
         // --------------------------------------------------------------------
         // constructors
         // --------------------------------------------------------------------
@@ -67,33 +88,103 @@ namespace expand {
         // default constructor
         Matrix() {}
         
-        // copy constructor
-        Matrix(Matrix<T, M, N> const& other) {
-            ASSERT(other.size() == _size, "Matrix dimensions must agree");
-            for (std::size_t i(0); i < _size; i++) {
-                _elements[i] = other._elements[i];
-            }
-        }
+        // copies and moves are those of the storage, hence trivial for
+        // fixed-size matrices and deep for dynamic ones
+        Matrix(Matrix<T, M, N, A> const& other) = default;
+        
+        Matrix(Matrix<T, M, N, A>&& other) = default;
         
         // copy memory content at t
-        Matrix(const T* t) {
-            for (std::size_t i(0); i < _size; i++) {
-                _elements[i] = *(t++);
+        template <std::size_t D = M, typename std::enable_if<D != Dynamic, int>::type = 0>
+        constexpr Matrix(const T* t) : MatrixMemory<T, M, N, A>(M, N) {
+            for (std::size_t i(0); i < rows(); i++) {
+                for (std::size_t j(0); j < cols(); j++) {
+                    unchecked(i, j) = *(t++);
+                }
             }
         }
         
         // fill with provided value
-        Matrix(const T val) {
-            for (std::size_t i(0); i < _size; i++) {
-                _elements[i] = val;
+        template <std::size_t D = M, typename std::enable_if<D != Dynamic, int>::type = 0>
+        constexpr Matrix(const T val) : MatrixMemory<T, M, N, A>(M, N) {
+            for (std::size_t i(0); i < rows(); i++) {
+                for (std::size_t j(0); j < cols(); j++) {
+                    unchecked(i, j) = val;
+                }
+            }
+        }
+        
+        // dynamic Matrix of \c rows x \c cols uninitialized elements
+        template <std::size_t D = M, typename std::enable_if<D == Dynamic, int>::type = 0>
+        Matrix(size_type const& rows, size_type const& cols) : MatrixMemory<T, M, N, A>(rows, cols) {}
+        
+        // dynamic Matrix of \c rows x \c cols elements copied from memory
+        template <std::size_t D = M, typename std::enable_if<D == Dynamic, int>::type = 0>
+        Matrix(size_type const& rows, size_type const& cols, const T* t) : MatrixMemory<T, M, N, A>(rows, cols) {
+            for (std::size_t i(0); i < rows; i++) {
+                for (std::size_t j(0); j < cols; j++) {
+                    unchecked(i, j) = *(t++);
+                }
+            }
+        }
+        
+        // dynamic Matrix of \c rows x \c cols elements filled with provided
+        // value
+        template <std::size_t D = M, typename std::enable_if<D == Dynamic, int>::type = 0>
+        Matrix(size_type const& rows, size_type const& cols, const T val) : MatrixMemory<T, M, N, A>(rows, cols) {
+            for (std::size_t i(0); i < rows; i++) {
+                for (std::size_t j(0); j < cols; j++) {
+                    unchecked(i, j) = val;
+                }
             }
         }
         
         // fill with provided values
-        Matrix(std::initializer_list<T> const& elements) {
+        template <std::size_t D = M, typename std::enable_if<D != Dynamic, int>::type = 0>
+        constexpr Matrix(std::initializer_list<T> const& elements) : MatrixMemory<T, M, N, A>(M, N) {
             std::size_t i(0);
-            for (auto it = elements.begin(); it != elements.end(); it++) {
-                (*this)[i++] = *it;
+            for (auto it = elements.begin(); it != elements.end(); it++, i++) {
+                (*this)(i / N, i % N) = *it;
+            }
+        }
+        
+        // view of the \c M x \c N matrix at \c t, rows being \c ld elements
+        // apart
+        template <typename B = A, typename std::enable_if<std::is_same<B, Mapped>::value && M != Dynamic, int>::type = 0>
+        Matrix(T* const t, size_type const& ld = N) : MatrixMemory<T, M, N, A>(t, ld) {}
+        
+        // view of the \c rows x \c cols matrix at \c t, rows being \c ld
+        // elements apart
+        template <typename B = A, typename std::enable_if<std::is_same<B, Mapped>::value && M == Dynamic, int>::type = 0>
+        Matrix(T* const t, size_type const& rows, size_type const& cols, size_type const& ld)
+            : MatrixMemory<T, M, N, A>(t, rows, cols, ld) {}
+        
+        // view of the \c rows x \c cols matrix at \c t, stored contiguously
+        template <typename B = A, typename std::enable_if<std::is_same<B, Mapped>::value && M == Dynamic, int>::type = 0>
+        Matrix(T* const t, size_type const& rows, size_type const& cols)
+            : MatrixMemory<T, M, N, A>(t, rows, cols, cols) {}
+        
+        // a Matrix can be constructed from any MatrixExpression, forcing its
+        // evaluation in a single pass
+        template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+        constexpr Matrix(MatExpression const& mat) : MatrixMemory<T, M, N, A>(mat.rows(), mat.cols()) {
+            static_assert(agrees<MatExpression>, "Matrix dimensions must agree");
+            evaluateFrom<Assign>(mat);
+        }
+        
+        // products are evaluated by the blocked kernel, straight into the
+        // Matrix being constructed as it cannot alias an operand, or element
+        // by element for small matrices; those of reduced precision are
+        // accumulated in a widened Matrix, then rounded once
+        template <typename T1, typename T2>
+        constexpr Matrix(MatrixProduct<T1, T2> const& prod) : MatrixMemory<T, M, N, A>(prod.rows(), prod.cols()) {
+            static_assert(agrees<MatrixProduct<T1, T2>>, "Matrix dimensions must agree");
+            if constexpr (unrolled) {
+                evaluateFrom<Assign>(prod);
+            } else if constexpr (!std::is_same<typename Widened<T>::type, T>::value) {
+                evaluateFrom<Assign>(Matrix<typename Widened<T>::type, M, N, typename std::conditional<owning, A, Packed>::type>(prod));
+            } else {
+                prod.template evaluateTo<Assign>(_elements, stride());
             }
         }
         
@@ -102,26 +193,38 @@ namespace expand {
         // --------------------------------------------------------------------
         
         iterator begin() {
-            return MatrixIter<T, M, N>(*this);
+            return MatrixIter<T, M, N, A>(*this);
         }
         
         const_iterator begin() const {
-            return MatrixIterConst<T, M, N>(*this);
+            return MatrixIterConst<T, M, N, A>(*this);
+        }
+        
+        iterator end() {
+            return MatrixIter<T, M, N, A>(*this, true);
+        }
+        
+        const_iterator end() const {
+            return MatrixIterConst<T, M, N, A>(*this, true);
+        }
+        
+        const_iterator cbegin() const {
+            return begin();
         }
         
-        inline static size_type size() {
-            return _size;
+        const_iterator cend() const {
+            return end();
         }
         
-        inline static size_type max_size() {
+        size_type max_size() const {
             return size();
         }
         
-        inline static bool empty() {
-            return false;
+        bool empty() const {
+            return size() == 0;
         }
         
-        // pointer to the data
+        // pointer to the data, rows being \c stride() elements apart
         T* data() {
             return _elements;
         }
@@ -136,63 +239,289 @@ namespace expand {
         // --------------------------------------------------------------------
         
         RowVector getRow(const int i) {
-            ASSERT(i >= 0 && i < _rows, "Row index (" << i << ") out of bounds in Matrix");
-            return RowVector(_elements + i * _rows);
+            EXPAND_CHECK(Check, i >= 0 && size_type(i) < rows(), "Row index (" << i << ") out of bounds in Matrix");
+            return RowVector(_elements + i * stride(), cols());
         }
         
+        // columns and trace are strided by the leading dimension, the number
+        // of rows having to be known at compile time
         ColVector getCol(const int j) {
-            ASSERT(j >= 0 && j < _cols, "Col index (" << j << ") out of bounds in Matrix");
-            return ColVector(_elements + j);
+            static_assert(N != Dynamic, "Columns of dynamic matrices cannot be viewed as vectors");
+            EXPAND_CHECK(Check, j >= 0 && size_type(j) < N, "Col index (" << j << ") out of bounds in Matrix");
+            if constexpr (L == Dynamic) {
+                return ColVector(_elements + j, stride());
+            } else {
+                return ColVector(_elements + j);
+            }
         }
         
         TraceVector getTrace() {
-            ASSERT(_rows == _cols, "Trace only defined for a square Matrix");
-            return TraceVector(_elements);
+            static_assert(N != Dynamic, "The trace of dynamic matrices cannot be viewed as a vector");
+            static_assert(M == N, "Trace only defined for a square Matrix");
+            if constexpr (L == Dynamic) {
+                return TraceVector(_elements, stride() + 1);
+            } else {
+                return TraceVector(_elements);
+            }
+        }
+        
+        // view of the \c R x \c C block whose top-left element is (i, j)
+        template <std::size_t R, std::size_t C>
+        Matrix<T, R, C, Mapped> block(size_type const& i, size_type const& j) {
+            EXPAND_CHECK(Check, i + R <= rows() && j + C <= cols(), "Block (" << i << ", " << j << ") out of bounds in Matrix");
+            return Matrix<T, R, C, Mapped>(_elements + i * stride() + j, stride());
+        }
+        
+        // view of the \c r x \c c block whose top-left element is (i, j)
+        Matrix<T, Dynamic, Dynamic, Mapped> block(size_type const& i, size_type const& j,
+                                                  size_type const& r, size_type const& c) {
+            EXPAND_CHECK(Check, i + r <= rows() && j + c <= cols(), "Block (" << i << ", " << j << ") out of bounds in Matrix");
+            return Matrix<T, Dynamic, Dynamic, Mapped>(_elements + i * stride() + j, r, c, stride());
+        }
+        
+        // transpose, a view moving no data until assigned to a Matrix
+        constexpr MatrixTranspose<Matrix<T, M, N, A>> transpose() const {
+            return MatrixTranspose<Matrix<T, M, N, A>>{*this};
+        }
+        
+        // transposes a square Matrix in place, dynamic matrices of other
+        // dimensions being reallocated
+        Matrix<T, M, N, A>& transposeInPlace() {
+            static_assert(M == N, "Only square matrices can be transposed in place");
+            if (rows() == cols()) {
+                expand::transposeInPlace(_elements, stride(), rows());
+            } else if constexpr (owning) {
+                *this = Matrix<T, M, N, A>(transpose());
+            } else {
+                EXPAND_CHECK(Check, rows() == cols(), "Only square views can be transposed in place");
+            }
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // decompositions
+        // --------------------------------------------------------------------
+        
+        // LU factorization with partial pivoting of a square Matrix
+        LU<T, M == Dynamic ? Dynamic : N> lu() const {
+            return LU<T, M == Dynamic ? Dynamic : N>(*this);
+        }
+        
+        // Cholesky factorization of a symmetric positive definite Matrix
+        Cholesky<T, M == Dynamic ? Dynamic : N> cholesky() const {
+            return Cholesky<T, M == Dynamic ? Dynamic : N>(*this);
+        }
+        
+        T determinant() const {
+            return expand::determinant(*this);
+        }
+        
+        auto inverse() const {
+            return expand::inverse(*this);
         }
         
         // --------------------------------------------------------------------
         // operators
         // --------------------------------------------------------------------
         
-        T operator[](size_type const& i) const {
-            ASSERT(i >= 0 && i < _size, "Direct index (" << i << ") out of bounds in Matrix");
+        // direct index in the storage, rows being \c stride() elements apart
+        constexpr T operator[](size_type const& i) const {
+            EXPAND_CHECK(Check, i < rows() * stride(), "Direct index (" << i << ") out of bounds in Matrix");
             return _elements[i];
         }
         
-        T& operator[](size_type const& i) {
-            ASSERT(i >= 0 && i < _size, "Direct index (" << i << ") out of bounds in Matrix");
+        constexpr T& operator[](size_type const& i) {
+            EXPAND_CHECK(Check, i < rows() * stride(), "Direct index (" << i << ") out of bounds in Matrix");
             return _elements[i];
         }
         
-        T operator()(size_type const& i, size_type const& j) const {
-            ASSERT(i >= 0 && i < _rows, "Row index (" << i << ") out of bounds in Matrix");
-            ASSERT(j >= 0 && j < _cols, "Col index (" << j << ") out of bounds in Matrix");
-            return (*this)[i * N + j];
+        constexpr T operator()(size_type const& i, size_type const& j) const {
+            EXPAND_CHECK(Check, i < rows(), "Row index (" << i << ") out of bounds in Matrix");
+            EXPAND_CHECK(Check, j < cols(), "Col index (" << j << ") out of bounds in Matrix");
+            return _elements[i * stride() + j];
         }
         
-        T& operator()(size_type const& i, size_type const& j) {
-            ASSERT(i >= 0 && i < _rows, "Row index (" << i << ") out of bounds in Matrix");
-            ASSERT(j >= 0 && j < _cols, "Col index (" << j << ") out of bounds in Matrix");
-            return (*this)[i * N + j];
+        constexpr T& operator()(size_type const& i, size_type const& j) {
+            EXPAND_CHECK(Check, i < rows(), "Row index (" << i << ") out of bounds in Matrix");
+            EXPAND_CHECK(Check, j < cols(), "Col index (" << j << ") out of bounds in Matrix");
+            return _elements[i * stride() + j];
         }
         
-        friend std::ostream& operator<<(std::ostream& os, Matrix<T, M, N> const& mat) {
-            os << "Mat(" << mat._rows << "x" << mat._cols << ")<" << typeid(T).name() << ">" << std::endl;
+        // direct index \c i and element (i, j), without bounds checks
+        constexpr T unchecked(size_type const& i) const {
+            return _elements[i];
+        }
+        
+        constexpr T& unchecked(size_type const& i) {
+            return _elements[i];
+        }
+        
+        constexpr T unchecked(size_type const& i, size_type const& j) const {
+            return _elements[i * stride() + j];
+        }
+        
+        constexpr T& unchecked(size_type const& i, size_type const& j) {
+            return _elements[i * stride() + j];
+        }
+        
+        // dynamic matrices are resized to match the assigned Matrix, while
+        // views copy the elements they reference
+        Matrix<T, M, N, A>& operator=(Matrix<T, M, N, A> const& rhs) = default;
+        
+        Matrix<T, M, N, A>& operator=(Matrix<T, M, N, A>&& rhs) = default;
+        
+        template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+        constexpr Matrix<T, M, N, A>& operator=(MatExpression const& rhs) {
+            static_assert(agrees<MatExpression>, "Matrix dimensions must agree");
+            if constexpr (owning) {
+                if (rhs.rows() != rows() || rhs.cols() != cols()) {
+                    // resizing first would release memory the expression may read
+                    return *this = Matrix<T, M, N, A>(rhs);
+                }
+            }
+            EXPAND_CHECK(Check, rhs.rows() == rows() && rhs.cols() == cols(), "Matrix dimensions must agree");
+            evaluateFrom<Assign>(rhs);
+            return *this;
+        }
+        
+        template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+        constexpr Matrix<T, M, N, A>& operator+=(MatExpression const& rhs) {
+            static_assert(agrees<MatExpression>, "Matrix dimensions must agree");
+            EXPAND_CHECK(Check, rhs.rows() == rows() && rhs.cols() == cols(), "Matrix dimensions must agree");
+            evaluateFrom<AddAssign>(rhs);
+            return *this;
+        }
+        
+        template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+        constexpr Matrix<T, M, N, A>& operator-=(MatExpression const& rhs) {
+            static_assert(agrees<MatExpression>, "Matrix dimensions must agree");
+            EXPAND_CHECK(Check, rhs.rows() == rows() && rhs.cols() == cols(), "Matrix dimensions must agree");
+            evaluateFrom<SubAssign>(rhs);
+            return *this;
+        }
+        
+        // the destination may be an operand of the product, which is hence
+        // evaluated into a temporary first, unless the evaluation is unrolled
+        // as it then reads every operand before storing
+        template <typename T1, typename T2>
+        constexpr Matrix<T, M, N, A>& operator=(MatrixProduct<T1, T2> const& prod) {
+            static_assert(agrees<MatrixProduct<T1, T2>>, "Matrix dimensions must agree");
+            if constexpr (unrolled) {
+                EXPAND_CHECK(Check, prod.rows() == rows() && prod.cols() == cols(), "Matrix dimensions must agree");
+                evaluateFrom<Assign>(prod);
+                return *this;
+            } else {
+                return *this = Evaluated(prod);
+            }
+        }
+        
+        template <typename T1, typename T2>
+        constexpr Matrix<T, M, N, A>& operator+=(MatrixProduct<T1, T2> const& prod) {
+            static_assert(agrees<MatrixProduct<T1, T2>>, "Matrix dimensions must agree");
+            if constexpr (unrolled) {
+                EXPAND_CHECK(Check, prod.rows() == rows() && prod.cols() == cols(), "Matrix dimensions must agree");
+                evaluateFrom<AddAssign>(prod);
+                return *this;
+            } else {
+                return *this += Evaluated(prod);
+            }
+        }
+        
+        template <typename T1, typename T2>
+        constexpr Matrix<T, M, N, A>& operator-=(MatrixProduct<T1, T2> const& prod) {
+            static_assert(agrees<MatrixProduct<T1, T2>>, "Matrix dimensions must agree");
+            if constexpr (unrolled) {
+                EXPAND_CHECK(Check, prod.rows() == rows() && prod.cols() == cols(), "Matrix dimensions must agree");
+                evaluateFrom<SubAssign>(prod);
+                return *this;
+            } else {
+                return *this -= Evaluated(prod);
+            }
+        }
+        
+        // --------------------------------------------------------------------
+        // packet evaluation
+        // --------------------------------------------------------------------
+        
+        static constexpr bool vectorizable = Packet<typename Widened<T>::type>::size > 1;
+        
+        // direct indices i to i + P::size - 1
+        template <typename P>
+        typename P::type packet(size_type const& i) const {
+            return P::load(_elements + i);
+        }
+        
+        // columns j to j + P::size - 1 of row i
+        template <typename P>
+        typename P::type packet(size_type const& i, size_type const& j) const {
+            return P::load(_elements + i * stride() + j);
+        }
+        
+        friend std::ostream& operator<<(std::ostream& os, Matrix<T, M, N, A> const& mat) {
+            os << "Mat(" << mat.rows() << "x" << mat.cols() << ")<" << typeid(T).name() << ">" << std::endl;
             os << "[";
-            for (std::size_t i(0); i < mat._rows; i++) {
+            for (std::size_t i(0); i < mat.rows(); i++) {
                 os << "[ ";
-                for (std::size_t j(0); j < mat._cols; j++) {
+                for (std::size_t j(0); j < mat.cols(); j++) {
                     os << mat(i, j) << " ";
                 }
                 os << "]";
-                if(i < mat._rows - 1) {
+                if(i < mat.rows() - 1) {
                     os << std::endl << " ";
                 }
             }
             os << "]";
             return os;
         }
+        
+    private:
+        
+        /**
+         *
+         * Evaluates \c e through \c Op fully unrolled for small matrices, by
+         * its dedicated kernel if any, in a single pass over the storage
+         * when its operands are laid out like this Matrix, padding included,
+         * and row by row otherwise, large matrices being split across
+         * threads either way.
+         *
+         */
+        template <typename Op, typename E>
+        constexpr void evaluateFrom(E const& e) {
+            typedef typename MatrixLayout<E>::type Layout;
+            if constexpr (unrolled) {
+                evaluateRowsUnrolled<Op, N>(_elements, stride(), e, std::make_index_sequence<M * N>());
+            } else if constexpr (HasEvaluateTo<E>::value) {
+                e.template evaluateTo<Op>(_elements, stride());
+            } else if constexpr (std::is_same<Layout, Packed>::value && std::is_same<A, Packed>::value) {
+                evaluate<Op>(_elements, 1, size(), e);
+            } else if constexpr (std::is_same<Layout, A>::value && E::vectorizable &&
+                                 std::is_same<WidenedType<E>, typename Widened<T>::type>::value) {
+                evaluate<Op>(_elements, 1, rows() * stride(), e);
+            } else if (size() >= EXPAND_PARALLEL_THRESHOLD) {
+                // whole rows are dealt to the thread pool
+                parallelFor(rows(), parallelGrain<T>(size(), cols()) / cols(), [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i(begin); i < end; i++) {
+                        evaluate<Op>(_elements + i * stride(), 1, cols(), MatrixRow<E>{e, i});
+                    }
+                });
+            } else {
+                for (std::size_t i(0); i < rows(); i++) {
+                    evaluate<Op>(_elements + i * stride(), 1, cols(), MatrixRow<E>{e, i});
+                }
+            }
+        }
     };
+    
+    // Matrix whose dimensions are only known at runtime
+    template <typename T>
+    using MatrixX = Matrix<T, Dynamic, Dynamic>;
+    
+    // view of a matrix in foreign memory, of dimensions only known at
+    // runtime by default
+    template <typename T, std::size_t M = Dynamic, std::size_t N = M>
+    using MatrixRef = Matrix<T, M, N, Mapped>;
 }
 
+EXPAND_PSABI_END
+
 #endif /* Matrix_h */
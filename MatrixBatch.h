@@ -0,0 +1,836 @@
+//
+//  MatrixBatch.h
+//  Expand
+//
+
+#ifndef MatrixBatch_h
+#define MatrixBatch_h
+
+#include <type_traits>
+#include <utility>
+
+#include "Matrix.h"
+#include "VectorBatch.h"
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    template <typename T, std::size_t M, std::size_t N>
+    class MatrixBatch;
+    
+    // --------------------------------------------------------------------
+    // expression traits
+    // --------------------------------------------------------------------
+    
+    // true for every type which can be used as an operand of the matrix
+    // batch operators: MatrixBatch instances and expression nodes
+    template <typename E>
+    struct IsMatrixBatchExpression : std::false_type {};
+    
+    template <typename T, std::size_t M, std::size_t N>
+    struct IsMatrixBatchExpression<MatrixBatch<T, M, N>> : std::true_type {};
+    
+    // --------------------------------------------------------------------
+    // expression nodes
+    // --------------------------------------------------------------------
+    
+    // Matrix batch expressions are indexed by (component, matrix), component
+    // r * cols + c being element (r, c), and evaluated across the matrices
+    // of the batch, one SIMD lane per matrix; \c size is the number of
+    // matrices and \c rows and \c cols the dimensions of each of them
+    
+    template <typename T1, typename T2>
+    struct MatrixBatchSum {
+        
+        static_assert(T1::rows == T2::rows && T1::cols == T2::cols, "Matrix dimensions must agree");
+        
+        typedef decltype(std::declval<T1>()(0, 0) + std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr std::size_t rows = T2::rows;
+        static constexpr std::size_t cols = T2::cols;
+        static constexpr std::size_t components = rows * cols;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            return u(k, i) + v(k, i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            return u.template packet<P>(k, i) + v.template packet<P>(k, i);
+        }
+    };
+    
+    
+    template <typename T1, typename T2>
+    struct MatrixBatchDif {
+        
+        static_assert(T1::rows == T2::rows && T1::cols == T2::cols, "Matrix dimensions must agree");
+        
+        typedef decltype(std::declval<T1>()(0, 0) - std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr std::size_t rows = T2::rows;
+        static constexpr std::size_t cols = T2::cols;
+        static constexpr std::size_t components = rows * cols;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            return u(k, i) - v(k, i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            return u.template packet<P>(k, i) - v.template packet<P>(k, i);
+        }
+    };
+    
+    
+    // scaling of every matrix by a scalar, captured by value
+    template <typename T1>
+    struct MatrixBatchScale {
+        
+        typedef typename T1::value_type value_type;
+        
+        static constexpr std::size_t rows = T1::rows;
+        static constexpr std::size_t cols = T1::cols;
+        static constexpr std::size_t components = rows * cols;
+        
+        static constexpr bool vectorizable = T1::vectorizable;
+        
+        T1 const& u;
+        value_type s;
+        
+        std::size_t size() const {
+            return u.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            return u(k, i) * s;
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            return u.template packet<P>(k, i) * P::set1(s);
+        }
+    };
+    
+    
+    // product of every pair of matrices
+    template <typename T1, typename T2>
+    struct MatrixBatchProduct {
+        
+        static_assert(T1::cols == T2::rows, "Matrix dimensions must agree");
+        
+        typedef decltype(std::declval<T1>()(0, 0) * std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr std::size_t rows = T1::rows;
+        static constexpr std::size_t cols = T2::cols;
+        static constexpr std::size_t components = rows * cols;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            std::size_t const r = k / cols * T1::cols;
+            std::size_t const c = k % cols;
+            value_type result = u(r, i) * v(c, i);
+            for (std::size_t j(1); j < T1::cols; j++) {
+                result += u(r + j, i) * v(j * cols + c, i);
+            }
+            return result;
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            std::size_t const r = k / cols * T1::cols;
+            std::size_t const c = k % cols;
+            typename P::type result = u.template packet<P>(r, i) * v.template packet<P>(c, i);
+            for (std::size_t j(1); j < T1::cols; j++) {
+                result += u.template packet<P>(r + j, i) * v.template packet<P>(j * cols + c, i);
+            }
+            return result;
+        }
+    };
+    
+    
+    // product of every matrix by the vector of the same index, a batch
+    // expression of vectors of size \c rows
+    template <typename T1, typename T2>
+    struct MatrixBatchVectorProduct {
+        
+        static_assert(T1::cols == T2::components, "Matrix and Vector dimensions must agree");
+        
+        typedef decltype(std::declval<T1>()(0, 0) * std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr std::size_t components = T1::rows;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            value_type result = u(k * T1::cols, i) * v(0, i);
+            for (std::size_t j(1); j < T1::cols; j++) {
+                result += u(k * T1::cols + j, i) * v(j, i);
+            }
+            return result;
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            typename P::type result = u.template packet<P>(k * T1::cols, i) * v.template packet<P>(0, i);
+            for (std::size_t j(1); j < T1::cols; j++) {
+                result += u.template packet<P>(k * T1::cols + j, i) * v.template packet<P>(j, i);
+            }
+            return result;
+        }
+    };
+    
+    
+    // affine transform of every point of size D by the matrix of the same
+    // index, of D or D + 1 rows and D + 1 columns: the point is multiplied
+    // by the first D columns and translated by the last one, the last row
+    // of square matrices being ignored
+    template <typename T1, typename T2>
+    struct MatrixBatchTransform {
+        
+        static constexpr std::size_t D = T2::components;
+        
+        static_assert(T1::cols == D + 1 && (T1::rows == D || T1::rows == D + 1), "Matrix and Vector dimensions must agree");
+        
+        typedef decltype(std::declval<T1>()(0, 0) * std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr std::size_t components = D;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            value_type result = u(k * T1::cols + D, i);
+            for (std::size_t j(0); j < D; j++) {
+                result += u(k * T1::cols + j, i) * v(j, i);
+            }
+            return result;
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            typename P::type result = u.template packet<P>(k * T1::cols + D, i);
+            for (std::size_t j(0); j < D; j++) {
+                result += u.template packet<P>(k * T1::cols + j, i) * v.template packet<P>(j, i);
+            }
+            return result;
+        }
+    };
+    
+    template <typename T1, typename T2>
+    struct IsMatrixBatchExpression<MatrixBatchSum<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsMatrixBatchExpression<MatrixBatchDif<T1, T2>> : std::true_type {};
+    
+    template <typename T1>
+    struct IsMatrixBatchExpression<MatrixBatchScale<T1>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsMatrixBatchExpression<MatrixBatchProduct<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsBatchExpression<MatrixBatchVectorProduct<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsBatchExpression<MatrixBatchTransform<T1, T2>> : std::true_type {};
+    
+    // --------------------------------------------------------------------
+    // operators
+    // --------------------------------------------------------------------
+    
+    // only participate in overload resolution for matrix batch expressions
+    template <typename T1>
+    using EnableIfMatrixBatchExpression = typename std::enable_if<IsMatrixBatchExpression<T1>::value, int>::type;
+    
+    template <typename T1, typename T2>
+    using EnableIfMatrixBatchExpressions = typename std::enable_if<
+        IsMatrixBatchExpression<T1>::value && IsMatrixBatchExpression<T2>::value, int>::type;
+    
+    // a matrix batch expression and a batch expression of vectors
+    template <typename T1, typename T2>
+    using EnableIfMatrixVectorBatchExpressions = typename std::enable_if<
+        IsMatrixBatchExpression<T1>::value && IsBatchExpression<T2>::value, int>::type;
+    
+    // addition
+    template <typename T1, typename T2, EnableIfMatrixBatchExpressions<T1, T2> = 0>
+    auto operator+(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return MatrixBatchSum<T1, T2>{u, v};
+    }
+    
+    // substraction
+    template <typename T1, typename T2, EnableIfMatrixBatchExpressions<T1, T2> = 0>
+    auto operator-(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return MatrixBatchDif<T1, T2>{u, v};
+    }
+    
+    // matrix products
+    template <typename T1, typename T2, EnableIfMatrixBatchExpressions<T1, T2> = 0>
+    auto operator*(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return MatrixBatchProduct<T1, T2>{u, v};
+    }
+    
+    // matrix-vector products
+    template <typename T1, typename T2, EnableIfMatrixVectorBatchExpressions<T1, T2> = 0>
+    auto operator*(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return MatrixBatchVectorProduct<T1, T2>{u, v};
+    }
+    
+    // scaling
+    template <typename T1, EnableIfMatrixBatchExpression<T1> = 0>
+    auto operator*(T1 const& u, typename T1::value_type const& s) {
+        return MatrixBatchScale<T1>{u, s};
+    }
+    
+    template <typename T1, EnableIfMatrixBatchExpression<T1> = 0>
+    auto operator*(typename T1::value_type const& s, T1 const& u) {
+        return MatrixBatchScale<T1>{u, s};
+    }
+    
+    // affine transforms of points
+    template <typename T1, typename T2, EnableIfMatrixVectorBatchExpressions<T1, T2> = 0>
+    auto transform(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return MatrixBatchTransform<T1, T2>{u, v};
+    }
+    
+    // --------------------------------------------------------------------
+    // linear systems
+    // --------------------------------------------------------------------
+    
+    // magnitude of every lane of \c x
+    template <typename V>
+    V magnitude(V const& x) {
+        return x < V{} ? -x : x;
+    }
+    
+    /**
+     *
+     * Solves A X = B by Gauss-Jordan elimination for one system per lane of
+     * the packets of \c P, A of size \c N being held by \c a and B of \c R
+     * columns by \c b, one packet per element in row-major order. X
+     * overwrites B.
+     *
+     * Pivots are chosen lane by lane by conditionally swapping rows, so that
+     * every lane runs the same instructions.
+     *
+     */
+    template <typename P, std::size_t N, std::size_t R>
+    void gaussJordan(typename P::type (&a)[N * N], typename P::type (&b)[N * R]) {
+        typedef typename P::type V;
+        for (std::size_t k(0); k < N; k++) {
+            for (std::size_t i(k + 1); i < N; i++) {
+                auto const swap = magnitude(a[i * N + k]) > magnitude(a[k * N + k]);
+                for (std::size_t j(k); j < N; j++) {
+                    V const t = a[k * N + j];
+                    a[k * N + j] = swap ? a[i * N + j] : t;
+                    a[i * N + j] = swap ? t : a[i * N + j];
+                }
+                for (std::size_t j(0); j < R; j++) {
+                    V const t = b[k * R + j];
+                    b[k * R + j] = swap ? b[i * R + j] : t;
+                    b[i * R + j] = swap ? t : b[i * R + j];
+                }
+            }
+            V const inv = P::set1(1) / a[k * N + k];
+            for (std::size_t j(k + 1); j < N; j++) {
+                a[k * N + j] *= inv;
+            }
+            for (std::size_t j(0); j < R; j++) {
+                b[k * R + j] *= inv;
+            }
+            for (std::size_t i(0); i < N; i++) {
+                if (i != k) {
+                    V const f = a[i * N + k];
+                    for (std::size_t j(k + 1); j < N; j++) {
+                        a[i * N + j] -= f * a[k * N + j];
+                    }
+                    for (std::size_t j(0); j < R; j++) {
+                        b[i * R + j] -= f * b[k * R + j];
+                    }
+                }
+            }
+        }
+    }
+    
+    // solves the systems of the \c P::size lanes starting at \c a, \c b and
+    // \c x, components being \c lda, \c ldb and \c ldx elements apart, B
+    // being the identity when \c b is null
+    template <typename P, std::size_t N, std::size_t R, typename T>
+    void gaussJordanLanes(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* x, std::size_t ldx) {
+        typename P::type ta[N * N], tb[N * R];
+        for (std::size_t k(0); k < N * N; k++) {
+            ta[k] = P::load(a + k * lda);
+        }
+        for (std::size_t k(0); k < N * R; k++) {
+            tb[k] = b ? P::load(b + k * ldb) : P::set1(T(k / R == k % R));
+        }
+        gaussJordan<P, N, R>(ta, tb);
+        for (std::size_t k(0); k < N * R; k++) {
+            P::store(x + k * ldx, tb[k]);
+        }
+    }
+    
+    // solves the systems of matrices [\c begin, \c end) a packet of matrices
+    // at a time, the remaining ones being solved one by one
+    template <std::size_t N, std::size_t R, typename T>
+    void gaussJordanRange(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* x, std::size_t ldx,
+                          std::size_t begin, std::size_t end) {
+        typedef Packet<T> P;
+        typedef Packet<T, sizeof(T)> S;
+        std::size_t i(begin);
+        for (; i + P::size <= end; i += P::size) {
+            gaussJordanLanes<P, N, R>(a + i, lda, b ? b + i : b, ldb, x + i, ldx);
+        }
+        for (; i < end; i++) {
+            gaussJordanLanes<S, N, R>(a + i, lda, b ? b + i : b, ldb, x + i, ldx);
+        }
+    }
+    
+    // solves the \c n systems, from \c EXPAND_PARALLEL_THRESHOLD elements
+    // on by several threads
+    template <std::size_t N, std::size_t R, typename T>
+    void gaussJordan(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* x, std::size_t ldx, std::size_t n) {
+        if (N * N * n >= EXPAND_PARALLEL_THRESHOLD) {
+            parallelFor(n, parallelGrain<T>(N * N * n, N * N * Packet<T>::size) / (N * N), [&](std::size_t begin, std::size_t end) {
+                gaussJordanRange<N, R>(a, lda, b, ldb, x, ldx, begin, end);
+            });
+        } else {
+            gaussJordanRange<N, R>(a, lda, b, ldb, x, ldx, 0, n);
+        }
+    }
+    
+    
+    /**
+     *
+     * Collection of \c M x \c N matrices stored as a structure of arrays:
+     * element (r, c) of every matrix is contiguous in memory, so that
+     * products, inverses and transforms over the whole batch map each
+     * matrix to one SIMD lane.
+     *
+     * Each component array starts on a \c DynamicAlignment boundary. The
+     * matrices are copied from and to arrays of Matrix instances by
+     * \c gather and \c scatter, or one at a time by index.
+     *
+     */
+    template <typename T, std::size_t M, std::size_t N>
+    class MatrixBatch {
+        
+        static_assert(M != Dynamic && N != Dynamic, "The dimensions of the matrices of a batch must be known at compile time");
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // type definitions
+        // --------------------------------------------------------------------
+        
+        typedef T                           value_type;
+        typedef Matrix<T, M, N>             matrix_type;
+        typedef Vector<T, Dynamic, 1>       component_type;
+        typedef std::size_t                 size_type;
+        
+        static constexpr std::size_t rows = M;
+        static constexpr std::size_t cols = N;
+        static constexpr std::size_t components = M * N;
+        
+    private:
+        
+        // component arrays, \c _stride elements apart
+        T* _elements;
+        
+        // number of matrices
+        std::size_t _size;
+        
+        // number of matrices rounded up to keep component arrays aligned
+        std::size_t _stride;
+        
+        static std::size_t strideFor(std::size_t const& n) {
+            constexpr std::size_t A = DynamicAlignment / sizeof(T) > 0 ? DynamicAlignment / sizeof(T) : 1;
+            return (n + A - 1) / A * A;
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // default constructor, no matrix
+        MatrixBatch() : _elements(nullptr), _size(0), _stride(0) {}
+        
+        // batch of \c n uninitialized matrices
+        explicit MatrixBatch(size_type const& n)
+            : _elements(alignedAllocate<T>(components * strideFor(n))), _size(n), _stride(strideFor(n)) {}
+        
+        // batch of \c n copies of \c value
+        MatrixBatch(size_type const& n, matrix_type const& value) : MatrixBatch(n) {
+            for (std::size_t k(0); k < components; k++) {
+                T* c = _elements + k * _stride;
+                for (std::size_t i(0); i < _size; i++) {
+                    c[i] = value(k / N, k % N);
+                }
+            }
+        }
+        
+        // gathers \c n matrices stored contiguously at \c t
+        MatrixBatch(matrix_type const* t, size_type const& n) : MatrixBatch(n) {
+            gather(t);
+        }
+        
+        // copy constructor
+        MatrixBatch(MatrixBatch<T, M, N> const& rhs) : MatrixBatch(rhs._size) {
+            copy(rhs);
+        }
+        
+        // move constructor, stealing the storage of \c rhs
+        MatrixBatch(MatrixBatch<T, M, N>&& rhs) noexcept
+            : _elements(rhs._elements), _size(rhs._size), _stride(rhs._stride) {
+            rhs._elements = nullptr;
+            rhs._size = 0;
+            rhs._stride = 0;
+        }
+        
+        // a MatrixBatch can be constructed from any matrix batch expression,
+        // forcing its evaluation
+        template <typename BatchExpression, EnableIfMatrixBatchExpression<BatchExpression> = 0>
+        MatrixBatch(BatchExpression const& rhs) : MatrixBatch(rhs.size()) {
+            static_assert(BatchExpression::rows == M && BatchExpression::cols == N, "Matrix dimensions must agree");
+            evaluateBatch<Assign>(rhs);
+        }
+        
+        ~MatrixBatch() {
+            alignedFree(_elements, components * _stride);
+        }
+        
+        // --------------------------------------------------------------------
+        // size
+        // --------------------------------------------------------------------
+        
+        // number of matrices
+        size_type size() const {
+            return _size;
+        }
+        
+        bool empty() const {
+            return _size == 0;
+        }
+        
+        // distance between two consecutive components of a matrix
+        size_type stride() const {
+            return _stride;
+        }
+        
+        // reallocates the storage when the number of matrices changes, the
+        // matrices being left uninitialized
+        void resize(size_type const& n) {
+            if (strideFor(n) != _stride) {
+                alignedFree(_elements, components * _stride);
+                _elements = alignedAllocate<T>(components * strideFor(n));
+                _stride = strideFor(n);
+            }
+            _size = n;
+        }
+        
+        // --------------------------------------------------------------------
+        // methods
+        // --------------------------------------------------------------------
+        
+        // copy of the \c i-th matrix
+        matrix_type operator[](size_type const& i) const {
+            ASSERT(i < _size, "Index (" << i << ") out of bounds in MatrixBatch of size " << _size);
+            matrix_type result;
+            for (std::size_t k(0); k < components; k++) {
+                result(k / N, k % N) = _elements[k * _stride + i];
+            }
+            return result;
+        }
+        
+        // replaces the \c i-th matrix by \c value
+        void set(size_type const& i, matrix_type const& value) {
+            ASSERT(i < _size, "Index (" << i << ") out of bounds in MatrixBatch of size " << _size);
+            for (std::size_t k(0); k < components; k++) {
+                _elements[k * _stride + i] = value(k / N, k % N);
+            }
+        }
+        
+        // view of element (r, c) of every matrix
+        component_type component(size_type const& r, size_type const& c) {
+            ASSERT(r < M && c < N, "Element (" << r << ", " << c << ") out of bounds in MatrixBatch of matrices of size " << M << "x" << N);
+            return component_type(_elements + (r * N + c) * _stride, _size);
+        }
+        
+        // gathers \c size() matrices stored contiguously at \c t, a tile of
+        // packets of components of as many matrices being transposed at once
+        void gather(matrix_type const* t) {
+            typedef Packet<T> P;
+            std::size_t i(0);
+            if constexpr (P::size > 1 && components >= P::size) {
+                for (; i + P::size <= _size; i += P::size) {
+                    std::size_t k(0);
+                    for (; k + P::size <= components; k += P::size) {
+                        typename P::type r[P::size];
+                        for (std::size_t l(0); l < P::size; l++) {
+                            r[l] = P::load(t[i + l].data() + k);
+                        }
+                        P::transpose(r);
+                        for (std::size_t l(0); l < P::size; l++) {
+                            P::store(_elements + (k + l) * _stride + i, r[l]);
+                        }
+                    }
+                    for (; k < components; k++) {
+                        for (std::size_t l(0); l < P::size; l++) {
+                            _elements[k * _stride + i + l] = t[i + l].data()[k];
+                        }
+                    }
+                }
+            }
+            for (; i < _size; i++) {
+                for (std::size_t k(0); k < components; k++) {
+                    _elements[k * _stride + i] = t[i].data()[k];
+                }
+            }
+        }
+        
+        // scatters the matrices to contiguous memory at \c t
+        void scatter(matrix_type* t) const {
+            typedef Packet<T> P;
+            std::size_t i(0);
+            if constexpr (P::size > 1 && components >= P::size) {
+                for (; i + P::size <= _size; i += P::size) {
+                    std::size_t k(0);
+                    for (; k + P::size <= components; k += P::size) {
+                        typename P::type r[P::size];
+                        for (std::size_t l(0); l < P::size; l++) {
+                            r[l] = P::load(_elements + (k + l) * _stride + i);
+                        }
+                        P::transpose(r);
+                        for (std::size_t l(0); l < P::size; l++) {
+                            P::store(t[i + l].data() + k, r[l]);
+                        }
+                    }
+                    for (; k < components; k++) {
+                        for (std::size_t l(0); l < P::size; l++) {
+                            t[i + l].data()[k] = _elements[k * _stride + i + l];
+                        }
+                    }
+                }
+            }
+            for (; i < _size; i++) {
+                for (std::size_t k(0); k < components; k++) {
+                    t[i].data()[k] = _elements[k * _stride + i];
+                }
+            }
+        }
+        
+        // pointer to the data
+        T* data() {
+            return _elements;
+        }
+        
+        // const pointer to the data
+        const T* data() const {
+            return _elements;
+        }
+        
+        // --------------------------------------------------------------------
+        // operators
+        // --------------------------------------------------------------------
+        
+        // component \c k, that is element (k / N, k % N), of the \c i-th
+        // matrix
+        T operator()(size_type const& k, size_type const& i) const {
+            return _elements[k * _stride + i];
+        }
+        
+        T& operator()(size_type const& k, size_type const& i) {
+            return _elements[k * _stride + i];
+        }
+        
+        MatrixBatch<T, M, N>& operator=(MatrixBatch<T, M, N> const& rhs) {
+            if (this != &rhs) {
+                resize(rhs._size);
+                copy(rhs);
+            }
+            return *this;
+        }
+        
+        MatrixBatch<T, M, N>& operator=(MatrixBatch<T, M, N>&& rhs) noexcept {
+            std::swap(_elements, rhs._elements);
+            std::swap(_size, rhs._size);
+            std::swap(_stride, rhs._stride);
+            return *this;
+        }
+        
+        template <typename BatchExpression, EnableIfMatrixBatchExpression<BatchExpression> = 0>
+        MatrixBatch<T, M, N>& operator=(BatchExpression const& rhs) {
+            static_assert(BatchExpression::rows == M && BatchExpression::cols == N, "Matrix dimensions must agree");
+            if (rhs.size() != _size) {
+                // resizing first would release memory the expression may read
+                return *this = MatrixBatch<T, M, N>(rhs);
+            }
+            evaluateBatch<Assign>(rhs);
+            return *this;
+        }
+        
+        template <typename BatchExpression, EnableIfMatrixBatchExpression<BatchExpression> = 0>
+        MatrixBatch<T, M, N>& operator+=(BatchExpression const& rhs) {
+            static_assert(BatchExpression::rows == M && BatchExpression::cols == N, "Matrix dimensions must agree");
+            ASSERT(rhs.size() == _size, "Batch sizes must agree");
+            evaluateBatch<AddAssign>(rhs);
+            return *this;
+        }
+        
+        template <typename BatchExpression, EnableIfMatrixBatchExpression<BatchExpression> = 0>
+        MatrixBatch<T, M, N>& operator-=(BatchExpression const& rhs) {
+            static_assert(BatchExpression::rows == M && BatchExpression::cols == N, "Matrix dimensions must agree");
+            ASSERT(rhs.size() == _size, "Batch sizes must agree");
+            evaluateBatch<SubAssign>(rhs);
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // packet evaluation
+        // --------------------------------------------------------------------
+        
+        static constexpr bool vectorizable = Packet<T>::size > 1;
+        
+        // component \c k of matrices i to i + P::size - 1
+        template <typename P>
+        typename P::type packet(size_type const& k, size_type const& i) const {
+            return P::load(_elements + k * _stride + i);
+        }
+        
+    private:
+        
+        // copies the matrices of a batch of the same size, leaving the
+        // padding at the end of each component array untouched
+        void copy(MatrixBatch<T, M, N> const& rhs) {
+            for (std::size_t k(0); k < components; k++) {
+                for (std::size_t i(0); i < _size; i++) {
+                    _elements[k * _stride + i] = rhs._elements[k * _stride + i];
+                }
+            }
+        }
+        
+        /**
+         *
+         * Evaluates \c e into the batch through \c Op, a packet of matrices
+         * at a time, from \c EXPAND_PARALLEL_THRESHOLD elements on by several
+         * threads.
+         *
+         * Every component of the packet is computed before any is stored,
+         * so that \c e may read the matrices it is assigned to, as in
+         * \c a = a * b.
+         *
+         */
+        template <typename Op, typename E>
+        void evaluateBatch(E const& e) {
+            if (components * _size >= EXPAND_PARALLEL_THRESHOLD) {
+                parallelFor(_size, parallelGrain<T>(components * _size, components * Packet<T>::size) / components, [&](std::size_t begin, std::size_t end) {
+                    evaluateBatchRange<Op>(e, begin, end);
+                });
+            } else {
+                evaluateBatchRange<Op>(e, 0, _size);
+            }
+        }
+        
+        // evaluates matrices [\c begin, \c end) of \c e
+        template <typename Op, typename E>
+        void evaluateBatchRange(E const& e, std::size_t const& begin, std::size_t const& end) {
+            std::size_t i(begin);
+            if constexpr (E::vectorizable && std::is_same<typename E::value_type, T>::value) {
+                typedef Packet<T> P;
+                for (; i + P::size <= end; i += P::size) {
+                    typename P::type r[components];
+                    for (std::size_t k(0); k < components; k++) {
+                        r[k] = e.template packet<P>(k, i);
+                    }
+                    for (std::size_t k(0); k < components; k++) {
+                        T* d = _elements + k * _stride + i;
+                        P::store(d, Op::apply(P::load(d), r[k]));
+                    }
+                }
+            }
+            for (; i < end; i++) {
+                T r[components];
+                for (std::size_t k(0); k < components; k++) {
+                    r[k] = static_cast<T>(e(k, i));
+                }
+                for (std::size_t k(0); k < components; k++) {
+                    T* d = _elements + k * _stride + i;
+                    *d = Op::apply(*d, r[k]);
+                }
+            }
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // functions
+    // --------------------------------------------------------------------
+    
+    // inverse of every matrix, singular matrices giving non-finite elements
+    template <typename T, std::size_t N>
+    MatrixBatch<T, N, N> inverse(MatrixBatch<T, N, N> const& a) {
+        MatrixBatch<T, N, N> x(a.size());
+        gaussJordan<N, N>(a.data(), a.stride(), static_cast<const T*>(nullptr), 0, x.data(), x.stride(), a.size());
+        return x;
+    }
+    
+    // solution of the system of every matrix and the vector of the same
+    // index
+    template <typename T, std::size_t N>
+    VectorBatch<T, N> solve(MatrixBatch<T, N, N> const& a, VectorBatch<T, N> const& b) {
+        ASSERT(a.size() == b.size(), "Batch sizes must agree");
+        VectorBatch<T, N> x(a.size());
+        gaussJordan<N, 1>(a.data(), a.stride(), b.data(), b.stride(), x.data(), x.stride(), a.size());
+        return x;
+    }
+}
+
+EXPAND_PSABI_END
+
+#endif /* MatrixBatch_h */
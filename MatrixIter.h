@@ -6,39 +6,189 @@
 #ifndef MatrixIter_h
 #define MatrixIter_h
 
-#include <iostream>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+#include "VectorMemory.h"
 
 namespace expand {
     
-    template <typename T, std::size_t M, std::size_t N>
+    template <typename T, std::size_t M, std::size_t N, typename A>
     class Matrix;
     
-    template <typename T, std::size_t M, std::size_t N>
+    template <typename T, std::size_t M, std::size_t N, typename A>
+    class MatrixIterConst;
+    
+    /**
+     *
+     * Random-access iterator over the elements of a Matrix in row-major
+     * order, skipping the padding at the end of the rows.
+     *
+     */
+    template <typename T, std::size_t M, std::size_t N, typename A>
     class MatrixIter {
         
-        T* _elements;
-    
+        friend class MatrixIterConst<T, M, N, A>;
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // STL-compatible type definitions
+        // --------------------------------------------------------------------
+        
+        typedef T                               value_type;
+        typedef T&                              reference;
+        typedef T*                              pointer;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef std::random_access_iterator_tag iterator_category;
+        
+    private:
+        
+        // first element of the current row
+        T* _row;
+        
+        // current column
+        difference_type _col;
+        
+        // number of columns, and distance between two consecutive rows
+        difference_type _cols;
+        difference_type _stride;
+        
+        constexpr difference_type cols() const {
+            return N == Dynamic ? _cols : difference_type(N);
+        }
+        
     public:
         
         // --------------------------------------------------------------------
         // constructors
         // --------------------------------------------------------------------
         
-        MatrixIter(Matrix<T, M, N>& mat) : _elements(mat._elements) {}
+        MatrixIter() : _row(nullptr), _col(0), _cols(0), _stride(0) {}
+        
+        // first element of \c mat, or one past its last element for \c end
+        MatrixIter(Matrix<T, M, N, A>& mat, bool const& end = false)
+            : _row(mat._elements), _col(0), _cols(difference_type(mat.cols())), _stride(difference_type(mat.stride())) {
+            if (end && mat.size() > 0) {
+                _row += difference_type(mat.rows()) * _stride;
+            }
+        }
+        
+        // --------------------------------------------------------------------
+        // access
+        // --------------------------------------------------------------------
+        
+        T& operator*() const {
+            return _row[_col];
+        }
+        
+        T* operator->() const {
+            return _row + _col;
+        }
+        
+        T& operator[](difference_type const& i) const {
+            return *(*this + i);
+        }
+        
+        // --------------------------------------------------------------------
+        // moves
+        // --------------------------------------------------------------------
+        
+        MatrixIter<T, M, N, A>& operator++() {
+            if (++_col == cols()) {
+                _col = 0;
+                _row += _stride;
+            }
+            return *this;
+        }
+        
+        MatrixIter<T, M, N, A> operator++(int) {
+            MatrixIter<T, M, N, A> ret(*this);
+            ++(*this);
+            return ret;
+        }
+        
+        MatrixIter<T, M, N, A>& operator--() {
+            if (_col-- == 0) {
+                _col = cols() - 1;
+                _row -= _stride;
+            }
+            return *this;
+        }
+        
+        MatrixIter<T, M, N, A> operator--(int) {
+            MatrixIter<T, M, N, A> ret(*this);
+            --(*this);
+            return ret;
+        }
+        
+        MatrixIter<T, M, N, A>& operator+=(difference_type const& n) {
+            difference_type const k = _col + n;
+            difference_type rows = k / cols();
+            if (k % cols() < 0) {
+                rows--;
+            }
+            _row += rows * _stride;
+            _col = k - rows * cols();
+            return *this;
+        }
+        
+        MatrixIter<T, M, N, A>& operator-=(difference_type const& n) {
+            return *this += -n;
+        }
+        
+        MatrixIter<T, M, N, A> operator+(difference_type const& n) const {
+            MatrixIter<T, M, N, A> ret(*this);
+            return ret += n;
+        }
+        
+        friend MatrixIter<T, M, N, A> operator+(difference_type const& n, MatrixIter<T, M, N, A> const& it) {
+            return it + n;
+        }
+        
+        MatrixIter<T, M, N, A> operator-(difference_type const& n) const {
+            MatrixIter<T, M, N, A> ret(*this);
+            return ret -= n;
+        }
+        
+        difference_type operator-(MatrixIter<T, M, N, A> const& other) const {
+            if (_row == other._row) {
+                return _col - other._col;
+            }
+            return (_row - other._row) / _stride * cols() + _col - other._col;
+        }
+        
+        void swap(MatrixIter<T, M, N, A>& rhs) {
+            std::swap(*this, rhs);
+        }
         
         // --------------------------------------------------------------------
-        // operators
+        // comparisons
         // --------------------------------------------------------------------
         
-        T& operator[](unsigned int const& i) const {
-            ASSERT(i < M * N, "Index (" << i << ") out of bounds in Matrix");
-            return _elements[i];
+        bool operator==(MatrixIter<T, M, N, A> const& other) const {
+            return _row == other._row && _col == other._col;
+        }
+        
+        bool operator!=(MatrixIter<T, M, N, A> const& other) const {
+            return !(*this == other);
+        }
+        
+        bool operator<(MatrixIter<T, M, N, A> const& other) const {
+            return _row < other._row || (_row == other._row && _col < other._col);
+        }
+        
+        bool operator>(MatrixIter<T, M, N, A> const& other) const {
+            return other < *this;
+        }
+        
+        bool operator<=(MatrixIter<T, M, N, A> const& other) const {
+            return !(other < *this);
         }
         
-        T& operator()(unsigned int const& i, unsigned int const& j) const {
-            ASSERT(i < M, "Col index (" << i << ") out of bounds in Matrix.col()");
-            ASSERT(j < N, "Row index (" << j << ") out of bounds in Matrix.row()");
-            return _elements[i * M + j];
+        bool operator>=(MatrixIter<T, M, N, A> const& other) const {
+            return !(*this < other);
         }
     };
 }
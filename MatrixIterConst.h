@@ -6,17 +6,56 @@
 #ifndef MatrixIterConst_h
 #define MatrixIterConst_h
 
-#include <iostream>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+#include "MatrixIter.h"
 
 namespace expand {
     
-    template <typename T, std::size_t M, std::size_t N>
+    template <typename T, std::size_t M, std::size_t N, typename A>
     class Matrix;
     
-    template <typename T, std::size_t M, std::size_t N>
+    template <typename T, std::size_t M, std::size_t N, typename A>
+    class MatrixIter;
+    
+    /**
+     *
+     * Random-access iterator over the constant elements of a Matrix in row-major
+     * order, skipping the padding at the end of the rows.
+     *
+     */
+    template <typename T, std::size_t M, std::size_t N, typename A>
     class MatrixIterConst {
         
-        T* _elements;
+    public:
+        
+        // --------------------------------------------------------------------
+        // STL-compatible type definitions
+        // --------------------------------------------------------------------
+        
+        typedef T                               value_type;
+        typedef const T&                        reference;
+        typedef const T*                        pointer;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef std::random_access_iterator_tag iterator_category;
+        
+    private:
+        
+        // first element of the current row
+        const T* _row;
+        
+        // current column
+        difference_type _col;
+        
+        // number of columns, and distance between two consecutive rows
+        difference_type _cols;
+        difference_type _stride;
+        
+        constexpr difference_type cols() const {
+            return N == Dynamic ? _cols : difference_type(N);
+        }
         
     public:
         
@@ -24,21 +63,134 @@ namespace expand {
         // constructors
         // --------------------------------------------------------------------
         
-        MatrixIterConst(Matrix<T, M, N> const& mat) : _elements(const_cast<T*>(mat._elements)) {}
+        MatrixIterConst() : _row(nullptr), _col(0), _cols(0), _stride(0) {}
+        
+        // first element of \c mat, or one past its last element for \c end
+        MatrixIterConst(Matrix<T, M, N, A> const& mat, bool const& end = false)
+            : _row(mat._elements), _col(0), _cols(difference_type(mat.cols())), _stride(difference_type(mat.stride())) {
+            if (end && mat.size() > 0) {
+                _row += difference_type(mat.rows()) * _stride;
+            }
+        }
+        
+        // iterators convert to constant iterators
+        MatrixIterConst(MatrixIter<T, M, N, A> const& it)
+            : _row(it._row), _col(it._col), _cols(it._cols), _stride(it._stride) {}
+        
+        // --------------------------------------------------------------------
+        // access
+        // --------------------------------------------------------------------
+        
+        const T& operator*() const {
+            return _row[_col];
+        }
+        
+        const T* operator->() const {
+            return _row + _col;
+        }
+        
+        const T& operator[](difference_type const& i) const {
+            return *(*this + i);
+        }
+        
+        // --------------------------------------------------------------------
+        // moves
+        // --------------------------------------------------------------------
+        
+        MatrixIterConst<T, M, N, A>& operator++() {
+            if (++_col == cols()) {
+                _col = 0;
+                _row += _stride;
+            }
+            return *this;
+        }
+        
+        MatrixIterConst<T, M, N, A> operator++(int) {
+            MatrixIterConst<T, M, N, A> ret(*this);
+            ++(*this);
+            return ret;
+        }
+        
+        MatrixIterConst<T, M, N, A>& operator--() {
+            if (_col-- == 0) {
+                _col = cols() - 1;
+                _row -= _stride;
+            }
+            return *this;
+        }
+        
+        MatrixIterConst<T, M, N, A> operator--(int) {
+            MatrixIterConst<T, M, N, A> ret(*this);
+            --(*this);
+            return ret;
+        }
+        
+        MatrixIterConst<T, M, N, A>& operator+=(difference_type const& n) {
+            difference_type const k = _col + n;
+            difference_type rows = k / cols();
+            if (k % cols() < 0) {
+                rows--;
+            }
+            _row += rows * _stride;
+            _col = k - rows * cols();
+            return *this;
+        }
+        
+        MatrixIterConst<T, M, N, A>& operator-=(difference_type const& n) {
+            return *this += -n;
+        }
+        
+        MatrixIterConst<T, M, N, A> operator+(difference_type const& n) const {
+            MatrixIterConst<T, M, N, A> ret(*this);
+            return ret += n;
+        }
+        
+        friend MatrixIterConst<T, M, N, A> operator+(difference_type const& n, MatrixIterConst<T, M, N, A> const& it) {
+            return it + n;
+        }
+        
+        MatrixIterConst<T, M, N, A> operator-(difference_type const& n) const {
+            MatrixIterConst<T, M, N, A> ret(*this);
+            return ret -= n;
+        }
+        
+        difference_type operator-(MatrixIterConst<T, M, N, A> const& other) const {
+            if (_row == other._row) {
+                return _col - other._col;
+            }
+            return (_row - other._row) / _stride * cols() + _col - other._col;
+        }
+        
+        void swap(MatrixIterConst<T, M, N, A>& rhs) {
+            std::swap(*this, rhs);
+        }
         
         // --------------------------------------------------------------------
-        // operators
+        // comparisons
         // --------------------------------------------------------------------
         
-        T& operator[](unsigned int const& i) const {
-            ASSERT(i < M * N, "Index (" << i << ") out of bounds in Matrix");
-            return _elements[i];
+        bool operator==(MatrixIterConst<T, M, N, A> const& other) const {
+            return _row == other._row && _col == other._col;
+        }
+        
+        bool operator!=(MatrixIterConst<T, M, N, A> const& other) const {
+            return !(*this == other);
+        }
+        
+        bool operator<(MatrixIterConst<T, M, N, A> const& other) const {
+            return _row < other._row || (_row == other._row && _col < other._col);
+        }
+        
+        bool operator>(MatrixIterConst<T, M, N, A> const& other) const {
+            return other < *this;
+        }
+        
+        bool operator<=(MatrixIterConst<T, M, N, A> const& other) const {
+            return !(other < *this);
         }
         
-        T& operator()(unsigned int const& i, unsigned int const& j) const {
-            ASSERT(i < M, "Col index (" << i << ") out of bounds in Matrix.col()");
-            ASSERT(j < N, "Row index (" << j << ") out of bounds in Matrix.row()");
-            return _elements[i * M + j];
+        bool operator>=(MatrixIterConst<T, M, N, A> const& other) const {
+            return !(*this < other);
         }
     };
 }
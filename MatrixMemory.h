@@ -0,0 +1,399 @@
+//
+//  MatrixMemory.h
+//  Expand
+//
+
+#ifndef MatrixMemory_h
+#define MatrixMemory_h
+
+#include <type_traits>
+#include <utility>
+
+#include "VectorMemory.h"
+
+namespace expand {
+    
+    /**
+     *
+     * Storage policy of the matrices referencing foreign memory rather than
+     * owning their elements, rows being a leading dimension apart which is
+     * only known at runtime. Such views are neither allocated nor copied:
+     * assigning to them writes through to the memory they reference.
+     *
+     */
+    struct Mapped {
+        template <typename T>
+        static constexpr std::size_t leading(std::size_t const&) {
+            return Dynamic;
+        }
+    };
+    
+    /**
+     *
+     * Row-major storage of the elements of a \c M x \c N Matrix, held in
+     * place when both dimensions are known at compile time, rows being laid
+     * out as required by the storage policy \c A.
+     *
+     */
+    template <typename T, std::size_t M, std::size_t N, typename A>
+    class Matrix;
+    
+    template <typename T, std::size_t M, std::size_t N, typename A = Packed>
+    class MatrixMemory {
+        
+        static_assert(M != Dynamic && N != Dynamic, "Matrix dimensions must be either both fixed or both Dynamic");
+        
+    protected:
+        
+        // policy of the dimension checks
+        typedef typename CheckPolicy<Matrix<T, M, N, A>>::type Check;
+        
+        // data, rows being \c stride() elements apart
+        alignas(A::template alignment<T>()) T _elements[M * A::template leading<T>(N)];
+        
+        // padding elements are zeroed so that evaluating them is harmless
+        void clearPadding() {
+            for (std::size_t i(0); i < M; i++) {
+                for (std::size_t j(N); j < stride(); j++) {
+                    _elements[i * stride() + j] = T();
+                }
+            }
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // default constructor
+        MatrixMemory() {
+            clearPadding();
+        }
+        
+        // storage for \c rows x \c cols elements, which must be \c M x \c N;
+        // small matrices are value-initialized so that they can be built at
+        // compile time
+        constexpr MatrixMemory(std::size_t const& rows, std::size_t const& cols)
+            : MatrixMemory(rows, cols, std::integral_constant<bool, M * N <= EXPAND_UNROLL_LIMIT>()) {}
+        
+    private:
+        
+        constexpr MatrixMemory(std::size_t const& rows, std::size_t const& cols, std::true_type) : _elements() {
+            resize(rows, cols);
+        }
+        
+        MatrixMemory(std::size_t const& rows, std::size_t const& cols, std::false_type) {
+            resize(rows, cols);
+            clearPadding();
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // dimensions
+        // --------------------------------------------------------------------
+        
+        static constexpr std::size_t rows() {
+            return M;
+        }
+        
+        static constexpr std::size_t cols() {
+            return N;
+        }
+        
+        static constexpr std::size_t size() {
+            return M * N;
+        }
+        
+        // distance between two consecutive rows
+        static constexpr std::size_t stride() {
+            return A::template leading<T>(N);
+        }
+        
+        // fixed-size storage cannot be resized
+        static constexpr void resize(std::size_t const& rows, std::size_t const& cols) {
+            EXPAND_CHECK(Check, rows == M && cols == N, "Matrix dimensions must agree");
+        }
+    };
+    
+    
+    /**
+     *
+     * Specialization for \c MatrixMemory instances whose dimensions are only
+     * known at runtime, storing their elements on the heap.
+     *
+     */
+    template <typename T, typename A>
+    class MatrixMemory<T, Dynamic, Dynamic, A> {
+        
+    protected:
+        
+        // policy of the dimension checks
+        typedef typename CheckPolicy<Matrix<T, Dynamic, Dynamic, A>>::type Check;
+        
+        // data, aligned on \c DynamicAlignment, rows being \c stride()
+        // elements apart
+        T* _elements;
+        
+        // dimensions
+        std::size_t _rows;
+        std::size_t _cols;
+        
+        // storage for \c rows x \c cols elements, padding elements being
+        // zeroed
+        static T* allocate(std::size_t const& rows, std::size_t const& cols) {
+            std::size_t const stride = A::template leading<T>(cols);
+            T* pointer = alignedAllocate<T>(rows * stride);
+            for (std::size_t i(0); i < rows; i++) {
+                for (std::size_t j(cols); j < stride; j++) {
+                    pointer[i * stride + j] = T();
+                }
+            }
+            return pointer;
+        }
+        
+        // number of elements of the storage, padding included
+        std::size_t capacity() const {
+            return _rows * stride();
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // default constructor, no element
+        MatrixMemory() : _elements(nullptr), _rows(0), _cols(0) {}
+        
+        // storage for \c rows x \c cols elements
+        MatrixMemory(std::size_t const& rows, std::size_t const& cols)
+            : _elements(allocate(rows, cols)), _rows(rows), _cols(cols) {}
+        
+        // copy constructor
+        MatrixMemory(MatrixMemory<T, Dynamic, Dynamic, A> const& rhs) : MatrixMemory(rhs._rows, rhs._cols) {
+            for (std::size_t i(0); i < capacity(); i++) {
+                _elements[i] = rhs._elements[i];
+            }
+        }
+        
+        // move constructor, stealing the storage of \c rhs
+        MatrixMemory(MatrixMemory<T, Dynamic, Dynamic, A>&& rhs) noexcept
+            : _elements(rhs._elements), _rows(rhs._rows), _cols(rhs._cols) {
+            rhs._elements = nullptr;
+            rhs._rows = 0;
+            rhs._cols = 0;
+        }
+        
+        ~MatrixMemory() {
+            alignedFree(_elements, capacity());
+        }
+        
+        MatrixMemory<T, Dynamic, Dynamic, A>& operator=(MatrixMemory<T, Dynamic, Dynamic, A> const& rhs) {
+            resize(rhs._rows, rhs._cols);
+            for (std::size_t i(0); i < capacity(); i++) {
+                _elements[i] = rhs._elements[i];
+            }
+            return *this;
+        }
+        
+        MatrixMemory<T, Dynamic, Dynamic, A>& operator=(MatrixMemory<T, Dynamic, Dynamic, A>&& rhs) noexcept {
+            std::swap(_elements, rhs._elements);
+            std::swap(_rows, rhs._rows);
+            std::swap(_cols, rhs._cols);
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // dimensions
+        // --------------------------------------------------------------------
+        
+        std::size_t rows() const {
+            return _rows;
+        }
+        
+        std::size_t cols() const {
+            return _cols;
+        }
+        
+        std::size_t size() const {
+            return _rows * _cols;
+        }
+        
+        // distance between two consecutive rows
+        std::size_t stride() const {
+            return A::template leading<T>(_cols);
+        }
+        
+        // reallocates the storage when the number of elements it holds,
+        // padding included, changes, the elements being left uninitialized
+        void resize(std::size_t const& rows, std::size_t const& cols) {
+            if (rows * A::template leading<T>(cols) != capacity()) {
+                alignedFree(_elements, capacity());
+                _elements = allocate(rows, cols);
+            } else if (cols != _cols) {
+                // the rows are laid out anew in the same storage
+                for (std::size_t i(0); i < rows; i++) {
+                    for (std::size_t j(cols); j < A::template leading<T>(cols); j++) {
+                        _elements[i * A::template leading<T>(cols) + j] = T();
+                    }
+                }
+            }
+            _rows = rows;
+            _cols = cols;
+        }
+    };
+    
+    /**
+     *
+     * Specialization for \c MatrixMemory instances referencing a \c M x \c N
+     * matrix in foreign memory.
+     *
+     */
+    template <typename T, std::size_t M, std::size_t N>
+    class MatrixMemory<T, M, N, Mapped> {
+        
+        static_assert(M != Dynamic && N != Dynamic, "Matrix dimensions must be either both fixed or both Dynamic");
+        
+    protected:
+        
+        // policy of the dimension checks
+        typedef typename CheckPolicy<Matrix<T, M, N, Mapped>>::type Check;
+        
+        // referenced data, rows being \c stride() elements apart
+        T* _elements;
+        
+        // leading dimension
+        std::size_t _stride;
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // reference to the matrix at \c t, rows being \c stride elements apart
+        MatrixMemory(T* const t, std::size_t const& stride) : _elements(t), _stride(stride) {
+            EXPAND_CHECK(Check, stride >= N, "Leading dimension (" << stride << ") smaller than the number of columns");
+        }
+        
+        // copies reference the same memory
+        MatrixMemory(MatrixMemory<T, M, N, Mapped> const& rhs) = default;
+        
+        // assignments write through to the referenced memory
+        MatrixMemory<T, M, N, Mapped>& operator=(MatrixMemory<T, M, N, Mapped> const& rhs) {
+            for (std::size_t i(0); i < M; i++) {
+                for (std::size_t j(0); j < N; j++) {
+                    _elements[i * _stride + j] = rhs._elements[i * rhs._stride + j];
+                }
+            }
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // dimensions
+        // --------------------------------------------------------------------
+        
+        static constexpr std::size_t rows() {
+            return M;
+        }
+        
+        static constexpr std::size_t cols() {
+            return N;
+        }
+        
+        static constexpr std::size_t size() {
+            return M * N;
+        }
+        
+        // distance between two consecutive rows
+        constexpr std::size_t stride() const {
+            return _stride;
+        }
+        
+        // references cannot be resized
+        static constexpr void resize(std::size_t const& rows, std::size_t const& cols) {
+            EXPAND_CHECK(Check, rows == M && cols == N, "Matrix dimensions must agree");
+        }
+    };
+    
+    /**
+     *
+     * Specialization for \c MatrixMemory instances referencing a matrix in
+     * foreign memory, whose dimensions are only known at runtime.
+     *
+     */
+    template <typename T>
+    class MatrixMemory<T, Dynamic, Dynamic, Mapped> {
+        
+    protected:
+        
+        // policy of the dimension checks
+        typedef typename CheckPolicy<Matrix<T, Dynamic, Dynamic, Mapped>>::type Check;
+        
+        // referenced data, rows being \c stride() elements apart
+        T* _elements;
+        
+        // dimensions and leading dimension
+        std::size_t _rows;
+        std::size_t _cols;
+        std::size_t _stride;
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // reference to the \c rows x \c cols matrix at \c t, rows being
+        // \c stride elements apart
+        MatrixMemory(T* const t, std::size_t const& rows, std::size_t const& cols, std::size_t const& stride)
+            : _elements(t), _rows(rows), _cols(cols), _stride(stride) {
+            EXPAND_CHECK(Check, stride >= cols, "Leading dimension (" << stride << ") smaller than the number of columns");
+        }
+        
+        // copies reference the same memory
+        MatrixMemory(MatrixMemory<T, Dynamic, Dynamic, Mapped> const& rhs) = default;
+        
+        // assignments write through to the referenced memory, which cannot
+        // be resized
+        MatrixMemory<T, Dynamic, Dynamic, Mapped>& operator=(MatrixMemory<T, Dynamic, Dynamic, Mapped> const& rhs) {
+            resize(rhs._rows, rhs._cols);
+            for (std::size_t i(0); i < _rows; i++) {
+                for (std::size_t j(0); j < _cols; j++) {
+                    _elements[i * _stride + j] = rhs._elements[i * rhs._stride + j];
+                }
+            }
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // dimensions
+        // --------------------------------------------------------------------
+        
+        std::size_t rows() const {
+            return _rows;
+        }
+        
+        std::size_t cols() const {
+            return _cols;
+        }
+        
+        std::size_t size() const {
+            return _rows * _cols;
+        }
+        
+        // distance between two consecutive rows
+        std::size_t stride() const {
+            return _stride;
+        }
+        
+        // references cannot be resized
+        void resize(std::size_t const& rows, std::size_t const& cols) const {
+            EXPAND_CHECK(Check, rows == _rows && cols == _cols, "Matrix dimensions must agree");
+        }
+    };
+}
+
+#endif /* MatrixMemory_h */
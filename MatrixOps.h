@@ -0,0 +1,533 @@
+//
+//  MatrixOps.h
+//  Expand
+//
+
+#ifndef MatrixOps_h
+#define MatrixOps_h
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "MatrixMemory.h"
+#include "VectorEval.h"
+#include "VectorOps.h"
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    template <typename T, std::size_t M, std::size_t N, typename A>
+    class Matrix;
+    
+    // --------------------------------------------------------------------
+    // expression traits
+    // --------------------------------------------------------------------
+    
+    // true for every type which can be used as an operand of the matrix
+    // operators: Matrix instances and expression nodes
+    template <typename E>
+    struct IsMatrixExpression : std::false_type {};
+    
+    template <typename T, std::size_t M, std::size_t N, typename A>
+    struct IsMatrixExpression<Matrix<T, M, N, A>> : std::true_type {};
+    
+    // true for Matrix instances of scalar type \c T, whose elements lie in
+    // memory rows \c stride() elements apart
+    template <typename E, typename T>
+    struct IsMatrixStorage : std::false_type {};
+    
+    template <typename T, std::size_t M, std::size_t N, typename A>
+    struct IsMatrixStorage<Matrix<T, M, N, A>, T> : std::true_type {};
+    
+    // dimensions of a matrix expression known at compile time
+    template <typename E>
+    struct MatrixShape;
+    
+    template <typename T, std::size_t M, std::size_t N, typename A>
+    struct MatrixShape<Matrix<T, M, N, A>> {
+        static constexpr std::size_t rows = M;
+        static constexpr std::size_t cols = N;
+    };
+    
+    // dimensions of an element-wise combination of \c T1 and \c T2, known
+    // at compile time when those of either are
+    template <typename T1, typename T2>
+    struct MatrixShapes {
+        static constexpr std::size_t rows = MatrixShape<T1>::rows != Dynamic ? MatrixShape<T1>::rows : MatrixShape<T2>::rows;
+        static constexpr std::size_t cols = MatrixShape<T1>::cols != Dynamic ? MatrixShape<T1>::cols : MatrixShape<T2>::cols;
+        
+        // false when both dimensions are known at compile time and differ
+        static constexpr bool agree =
+            (MatrixShape<T1>::rows == Dynamic || MatrixShape<T2>::rows == Dynamic ||
+             MatrixShape<T1>::rows == MatrixShape<T2>::rows) &&
+            (MatrixShape<T1>::cols == Dynamic || MatrixShape<T2>::cols == Dynamic ||
+             MatrixShape<T1>::cols == MatrixShape<T2>::cols);
+    };
+    
+    // storage policy shared by every Matrix read by an expression, direct
+    // indices only addressing the same element in all of them when it is
+    // not \c void
+    template <typename E>
+    struct MatrixLayout;
+    
+    template <typename T, std::size_t M, std::size_t N, typename A>
+    struct MatrixLayout<Matrix<T, M, N, A>> {
+        typedef A type;
+    };
+    
+    // the rows of views are laid out by their leading dimension only
+    template <typename T, std::size_t M, std::size_t N>
+    struct MatrixLayout<Matrix<T, M, N, Mapped>> {
+        typedef void type;
+    };
+    
+    template <typename T1, typename T2>
+    struct MatrixLayouts {
+        typedef typename std::conditional<
+            std::is_same<typename MatrixLayout<T1>::type, typename MatrixLayout<T2>::type>::value,
+            typename MatrixLayout<T1>::type, void>::type type;
+    };
+    
+    // --------------------------------------------------------------------
+    // expression nodes
+    // --------------------------------------------------------------------
+    
+    // Matrix expressions are evaluated in a single pass over the row-major
+    // elements when their operands share the same storage policy, and row
+    // by row otherwise, hence expose both a direct index and the (row, col)
+    // access
+    
+    template <typename T1, typename T2>
+    struct MatrixSum {
+        
+        typedef decltype(std::declval<T1>()[0] + std::declval<T2>()[0]) value_type;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        constexpr std::size_t rows() const {
+            return v.rows();
+        }
+        
+        constexpr std::size_t cols() const {
+            return v.cols();
+        }
+        
+        constexpr std::size_t size() const {
+            return v.size();
+        }
+        
+        constexpr auto operator[](std::size_t i) const {
+            return element(u, i) + element(v, i);
+        }
+        
+        constexpr auto operator()(std::size_t i, std::size_t j) const {
+            return element(u, i, j) + element(v, i, j);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i) const {
+            return u.template packet<P>(i) + v.template packet<P>(i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i, std::size_t j) const {
+            return u.template packet<P>(i, j) + v.template packet<P>(i, j);
+        }
+    };
+    
+    
+    template <typename T1, typename T2>
+    struct MatrixDif {
+        
+        typedef decltype(std::declval<T1>()[0] - std::declval<T2>()[0]) value_type;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        constexpr std::size_t rows() const {
+            return v.rows();
+        }
+        
+        constexpr std::size_t cols() const {
+            return v.cols();
+        }
+        
+        constexpr std::size_t size() const {
+            return v.size();
+        }
+        
+        constexpr auto operator[](std::size_t i) const {
+            return element(u, i) - element(v, i);
+        }
+        
+        constexpr auto operator()(std::size_t i, std::size_t j) const {
+            return element(u, i, j) - element(v, i, j);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i) const {
+            return u.template packet<P>(i) - v.template packet<P>(i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i, std::size_t j) const {
+            return u.template packet<P>(i, j) - v.template packet<P>(i, j);
+        }
+    };
+    
+    
+    // element-wise (Hadamard) product
+    template <typename T1, typename T2>
+    struct MatrixMul {
+        
+        typedef decltype(std::declval<T1>()[0] * std::declval<T2>()[0]) value_type;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        constexpr std::size_t rows() const {
+            return v.rows();
+        }
+        
+        constexpr std::size_t cols() const {
+            return v.cols();
+        }
+        
+        constexpr std::size_t size() const {
+            return v.size();
+        }
+        
+        constexpr auto operator[](std::size_t i) const {
+            return element(u, i) * element(v, i);
+        }
+        
+        constexpr auto operator()(std::size_t i, std::size_t j) const {
+            return element(u, i, j) * element(v, i, j);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i) const {
+            return u.template packet<P>(i) * v.template packet<P>(i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i, std::size_t j) const {
+            return u.template packet<P>(i, j) * v.template packet<P>(i, j);
+        }
+    };
+    
+    
+    // scaling by a scalar, captured by value
+    template <typename T1>
+    struct MatrixScale {
+        
+        typedef WidenedType<T1> value_type;
+        
+        static constexpr bool vectorizable = T1::vectorizable;
+        
+        T1 const& u;
+        value_type s;
+        
+        constexpr std::size_t rows() const {
+            return u.rows();
+        }
+        
+        constexpr std::size_t cols() const {
+            return u.cols();
+        }
+        
+        constexpr std::size_t size() const {
+            return u.size();
+        }
+        
+        constexpr auto operator[](std::size_t i) const {
+            return element(u, i) * s;
+        }
+        
+        constexpr auto operator()(std::size_t i, std::size_t j) const {
+            return element(u, i, j) * s;
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i) const {
+            return u.template packet<P>(i) * P::set1(s);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i, std::size_t j) const {
+            return u.template packet<P>(i, j) * P::set1(s);
+        }
+    };
+    
+    // values of a quantized matrix (see \c VectorDequantize)
+    template <typename T1>
+    struct MatrixDequantize {
+        
+        static_assert(std::is_integral<typename T1::value_type>::value, "Only integer expressions are dequantized");
+        
+        typedef float value_type;
+        
+        static constexpr bool vectorizable = T1::vectorizable;
+        
+        T1 const& u;
+        float s;
+        
+        constexpr std::size_t rows() const {
+            return u.rows();
+        }
+        
+        constexpr std::size_t cols() const {
+            return u.cols();
+        }
+        
+        constexpr std::size_t size() const {
+            return u.size();
+        }
+        
+        constexpr float operator[](std::size_t i) const {
+            return static_cast<float>(element(u, i)) * s;
+        }
+        
+        constexpr float operator()(std::size_t i, std::size_t j) const {
+            return static_cast<float>(element(u, i, j)) * s;
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i) const {
+            typedef Packet<typename T1::value_type, P::size * sizeof(typename T1::value_type)> Q;
+            return dequantizePacket<P, typename T1::value_type>(u.template packet<Q>(i)) * P::set1(s);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i, std::size_t j) const {
+            typedef Packet<typename T1::value_type, P::size * sizeof(typename T1::value_type)> Q;
+            return dequantizePacket<P, typename T1::value_type>(u.template packet<Q>(i, j)) * P::set1(s);
+        }
+    };
+    
+    
+    // matrix quantized to 8-bit integers (see \c VectorQuantize)
+    template <typename T1>
+    struct MatrixQuantize {
+        
+        typedef std::int8_t value_type;
+        
+        static constexpr bool vectorizable = T1::vectorizable && std::is_same<WidenedType<T1>, float>::value;
+        
+        T1 const& u;
+        float r;
+        
+        constexpr std::size_t rows() const {
+            return u.rows();
+        }
+        
+        constexpr std::size_t cols() const {
+            return u.cols();
+        }
+        
+        constexpr std::size_t size() const {
+            return u.size();
+        }
+        
+        value_type operator[](std::size_t i) const {
+            return static_cast<value_type>(quantizeRound(static_cast<float>(element(u, i)) * r));
+        }
+        
+        value_type operator()(std::size_t i, std::size_t j) const {
+            return static_cast<value_type>(quantizeRound(static_cast<float>(element(u, i, j)) * r));
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i) const {
+            return quantizePacket<P>([&](auto q, std::size_t k) {
+                return u.template packet<decltype(q)>(i + k);
+            }, r);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i, std::size_t j) const {
+            return quantizePacket<P>([&](auto q, std::size_t k) {
+                return u.template packet<decltype(q)>(i, j + k);
+            }, r);
+        }
+    };
+    
+    template <typename T1, typename T2>
+    struct IsMatrixExpression<MatrixSum<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsMatrixExpression<MatrixDif<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsMatrixExpression<MatrixMul<T1, T2>> : std::true_type {};
+    
+    template <typename T1>
+    struct IsMatrixExpression<MatrixScale<T1>> : std::true_type {};
+    
+    template <typename T1>
+    struct IsMatrixExpression<MatrixDequantize<T1>> : std::true_type {};
+    
+    template <typename T1>
+    struct IsMatrixExpression<MatrixQuantize<T1>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct MatrixShape<MatrixSum<T1, T2>> : MatrixShapes<T1, T2> {};
+    
+    template <typename T1, typename T2>
+    struct MatrixShape<MatrixDif<T1, T2>> : MatrixShapes<T1, T2> {};
+    
+    template <typename T1, typename T2>
+    struct MatrixShape<MatrixMul<T1, T2>> : MatrixShapes<T1, T2> {};
+    
+    template <typename T1>
+    struct MatrixShape<MatrixScale<T1>> : MatrixShape<T1> {};
+    
+    template <typename T1>
+    struct MatrixShape<MatrixDequantize<T1>> : MatrixShape<T1> {};
+    
+    template <typename T1>
+    struct MatrixShape<MatrixQuantize<T1>> : MatrixShape<T1> {};
+    
+    template <typename T1, typename T2>
+    struct MatrixLayout<MatrixSum<T1, T2>> : MatrixLayouts<T1, T2> {};
+    
+    template <typename T1, typename T2>
+    struct MatrixLayout<MatrixDif<T1, T2>> : MatrixLayouts<T1, T2> {};
+    
+    template <typename T1, typename T2>
+    struct MatrixLayout<MatrixMul<T1, T2>> : MatrixLayouts<T1, T2> {};
+    
+    template <typename T1>
+    struct MatrixLayout<MatrixScale<T1>> : MatrixLayout<T1> {};
+    
+    // quantization changes the padding of the rows along with the size of
+    // the elements
+    template <typename T1>
+    struct MatrixLayout<MatrixDequantize<T1>> {
+        typedef void type;
+    };
+    
+    template <typename T1>
+    struct MatrixLayout<MatrixQuantize<T1>> {
+        typedef void type;
+    };
+    
+    /**
+     *
+     * Evaluates the elements \c I of the row-major expression \c e, of \c N
+     * columns, into memory at \c dst, rows being \c ld elements apart,
+     * combining them with the current content through \c Op.
+     *
+     * As for vectors, the evaluation is fully unrolled and every element is
+     * computed before any is stored.
+     *
+     */
+    template <typename Op, std::size_t N, typename T, typename E, std::size_t... I>
+    constexpr void evaluateRowsUnrolled(T* dst, std::size_t const ld, E const& e, std::index_sequence<I...>) {
+        typedef typename Widened<T>::type C;
+        C const r[] = {static_cast<C>(element(e, I / N, I % N))...};
+        ((dst[I / N * ld + I % N] = static_cast<T>(Op::apply(static_cast<C>(dst[I / N * ld + I % N]), r[I]))), ...);
+    }
+    
+    /**
+     *
+     * Row \c i of a matrix expression, seen as a vector expression so that
+     * matrices whose operands do not share the same layout are evaluated
+     * row by row by the vector kernel.
+     *
+     */
+    template <typename E>
+    struct MatrixRow {
+        
+        typedef typename E::value_type value_type;
+        
+        static constexpr bool vectorizable = E::vectorizable;
+        
+        E const& e;
+        std::size_t i;
+        
+        constexpr std::size_t size() const {
+            return e.cols();
+        }
+        
+        constexpr auto operator[](std::size_t j) const {
+            return element(e, i, j);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t j) const {
+            return e.template packet<P>(i, j);
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // operators
+    // --------------------------------------------------------------------
+    
+    // only participate in overload resolution for matrix expressions
+    template <typename T1>
+    using EnableIfMatrixExpression = typename std::enable_if<IsMatrixExpression<T1>::value, int>::type;
+    
+    template <typename T1, typename T2>
+    using EnableIfMatrixExpressions = typename std::enable_if<
+        IsMatrixExpression<T1>::value && IsMatrixExpression<T2>::value, int>::type;
+    
+    // addition
+    template <typename T1, typename T2, EnableIfMatrixExpressions<T1, T2> = 0>
+    constexpr auto operator+(T1 const& u, T2 const& v) {
+        static_assert(MatrixShapes<T1, T2>::agree, "Matrix dimensions must agree");
+        ASSERT(u.rows() == v.rows() && u.cols() == v.cols(), "Matrix dimensions must agree");
+        return MatrixSum<T1, T2>{u, v};
+    }
+    
+    // substraction
+    template <typename T1, typename T2, EnableIfMatrixExpressions<T1, T2> = 0>
+    constexpr auto operator-(T1 const& u, T2 const& v) {
+        static_assert(MatrixShapes<T1, T2>::agree, "Matrix dimensions must agree");
+        ASSERT(u.rows() == v.rows() && u.cols() == v.cols(), "Matrix dimensions must agree");
+        return MatrixDif<T1, T2>{u, v};
+    }
+    
+    // element-wise multiplication, \c operator* being the matrix product
+    template <typename T1, typename T2, EnableIfMatrixExpressions<T1, T2> = 0>
+    constexpr auto hadamard(T1 const& u, T2 const& v) {
+        static_assert(MatrixShapes<T1, T2>::agree, "Matrix dimensions must agree");
+        ASSERT(u.rows() == v.rows() && u.cols() == v.cols(), "Matrix dimensions must agree");
+        return MatrixMul<T1, T2>{u, v};
+    }
+    
+    // scaling
+    template <typename T1, EnableIfMatrixExpression<T1> = 0>
+    constexpr auto operator*(T1 const& u, WidenedType<T1> const& s) {
+        return MatrixScale<T1>{u, s};
+    }
+    
+    template <typename T1, EnableIfMatrixExpression<T1> = 0>
+    constexpr auto operator*(WidenedType<T1> const& s, T1 const& u) {
+        return MatrixScale<T1>{u, s};
+    }
+    
+    // quantization
+    template <typename T1, EnableIfMatrixExpression<T1> = 0>
+    constexpr auto dequantize(T1 const& u, float const& s) {
+        return MatrixDequantize<T1>{u, s};
+    }
+    
+    template <typename T1, EnableIfMatrixExpression<T1> = 0>
+    constexpr auto quantize(T1 const& u, float const& s) {
+        return MatrixQuantize<T1>{u, 1 / s};
+    }
+}
+
+EXPAND_PSABI_END
+
+#endif /* MatrixOps_h */
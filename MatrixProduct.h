@@ -0,0 +1,564 @@
+//
+//  MatrixProduct.h
+//  Expand
+//
+
+#ifndef MatrixProduct_h
+#define MatrixProduct_h
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#include "MatrixOps.h"
+#include "MatrixTranspose.h"
+#include "ThreadPool.h"
+#include "VectorEval.h"
+
+// cache sizes in bytes used to pick the blocking of the matrix product
+#ifndef EXPAND_L1_BYTES
+#   define EXPAND_L1_BYTES 32768
+#endif
+
+#ifndef EXPAND_L2_BYTES
+#   define EXPAND_L2_BYTES 262144
+#endif
+
+#ifndef EXPAND_L3_BYTES
+#   define EXPAND_L3_BYTES 2097152
+#endif
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // blocking
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Block sizes of the product of a \c M x \c K matrix by a \c K x \c N
+     * matrix, following the usual GotoBLAS layering:
+     *
+     * - the micro-kernel accumulates a \c mr x \c nr tile of the result in
+     *   registers, \c nr being a whole number of packets;
+     * - a \c kc x \c nr sliver of the right-hand side stays in L1;
+     * - a \c mc x \c kc block of the left-hand side stays in L2;
+     * - a \c kc x \c nc panel of the right-hand side stays in L3.
+     *
+     * Blocks never exceed the (rounded up) dimensions of the product, which
+     * may be \c Dynamic, and registers hold packets of \c W bytes.
+     *
+     */
+    template <typename T, std::size_t M, std::size_t K, std::size_t N, std::size_t W = EXPAND_SIMD_BYTES>
+    struct GemmBlocking {
+        
+        typedef Packet<T, W> P;
+        
+        static constexpr std::size_t mr = P::size > 1 ? 6 : 4;
+        static constexpr std::size_t nr = 2 * P::size;
+        
+        static constexpr std::size_t roundUp(std::size_t n, std::size_t m) {
+            return (n + m - 1) / m * m;
+        }
+        
+        // dynamic dimensions get the largest block fitting in cache
+        static constexpr std::size_t clamp(std::size_t n, std::size_t hi, std::size_t m) {
+            return n == Dynamic ? std::max(hi / m * m, m) : std::max(std::min(roundUp(n, m), hi / m * m), m);
+        }
+        
+        static constexpr std::size_t kc = clamp(K, EXPAND_L1_BYTES / (2 * nr * sizeof(T)), 8);
+        static constexpr std::size_t mc = clamp(M, EXPAND_L2_BYTES / (2 * kc * sizeof(T)), mr);
+        static constexpr std::size_t nc = clamp(N, EXPAND_L3_BYTES / (2 * kc * sizeof(T)), nr);
+    };
+    
+    // per-thread buffers holding the packed blocks of a product, large
+    // enough for the blocking of every packet width the kernels use
+    template <typename T, std::size_t M, std::size_t K, std::size_t N>
+    struct GemmBuffers {
+        
+        template <std::size_t W>
+        static constexpr std::size_t lhsSize = GemmBlocking<T, M, K, N, W>::mc * GemmBlocking<T, M, K, N, W>::kc;
+        
+        template <std::size_t W>
+        static constexpr std::size_t rhsSize = GemmBlocking<T, M, K, N, W>::kc * GemmBlocking<T, M, K, N, W>::nc;
+        
+#if EXPAND_DISPATCH
+        static constexpr std::size_t lhsCapacity = std::max({lhsSize<16>, lhsSize<32>, lhsSize<64>});
+        static constexpr std::size_t rhsCapacity = std::max({rhsSize<16>, rhsSize<32>, rhsSize<64>});
+#else
+        static constexpr std::size_t lhsCapacity = lhsSize<EXPAND_SIMD_BYTES>;
+        static constexpr std::size_t rhsCapacity = rhsSize<EXPAND_SIMD_BYTES>;
+#endif
+        
+        // buffers of the calling thread
+        static T* lhs() {
+            alignas(64) static thread_local T buffer[lhsCapacity];
+            return buffer;
+        }
+        
+        static T* rhs() {
+            alignas(64) static thread_local T buffer[rhsCapacity];
+            return buffer;
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // kernels
+    // --------------------------------------------------------------------
+    
+    // packs rows [i0, i0 + m) and columns [k0, k0 + k) of \c a into slivers
+    // of \c mr rows stored column by column, padding with zeros
+    template <std::size_t MR, typename T, typename E>
+    inline void gemmPackLhs(T* dst, E const& a, std::size_t i0, std::size_t m,
+                            std::size_t k0, std::size_t k) {
+        for (std::size_t s(0); s < m; s += MR) {
+            std::size_t const rows = std::min(MR, m - s);
+            for (std::size_t p(0); p < k; p++) {
+                for (std::size_t r(0); r < MR; r++) {
+                    *(dst++) = r < rows ? static_cast<T>(element(a, i0 + s + r, k0 + p)) : T(0);
+                }
+            }
+        }
+    }
+    
+    // packs rows [k0, k0 + k) and columns [j0, j0 + n) of \c b into slivers
+    // of \c nr columns stored row by row, padding with zeros
+    template <std::size_t NR, typename T, typename E>
+    inline void gemmPackRhs(T* dst, E const& b, std::size_t k0, std::size_t k,
+                            std::size_t j0, std::size_t n) {
+        for (std::size_t s(0); s < n; s += NR) {
+            std::size_t const cols = std::min(NR, n - s);
+            for (std::size_t p(0); p < k; p++) {
+                for (std::size_t c(0); c < NR; c++) {
+                    *(dst++) = c < cols ? static_cast<T>(element(b, k0 + p, j0 + s + c)) : T(0);
+                }
+            }
+        }
+    }
+    
+    // multiplies a packed \c MR x \c k sliver by a packed \c k x \c NR
+    // sliver, keeping the whole \c MR x \c NR tile in registers holding
+    // \c W bytes each
+    template <typename Op, std::size_t MR, std::size_t NR, std::size_t W, typename T>
+    inline void gemmMicroKernel(std::size_t k, const T* a, const T* b, T* c, std::size_t ldc) {
+        typedef Packet<T, W> P;
+        constexpr std::size_t NP = NR / P::size;
+        
+        typename P::type acc[MR][NP] = {};
+        for (std::size_t p(0); p < k; p++) {
+            typename P::type bp[NP];
+#pragma GCC unroll 8
+            for (std::size_t q(0); q < NP; q++) {
+                bp[q] = P::load(b + q * P::size);
+            }
+#pragma GCC unroll 8
+            for (std::size_t r(0); r < MR; r++) {
+                typename P::type const ar = P::set1(a[r]);
+#pragma GCC unroll 8
+                for (std::size_t q(0); q < NP; q++) {
+                    acc[r][q] += ar * bp[q];
+                }
+            }
+            a += MR;
+            b += NR;
+        }
+#pragma GCC unroll 8
+        for (std::size_t r(0); r < MR; r++) {
+#pragma GCC unroll 8
+            for (std::size_t q(0); q < NP; q++) {
+                T* dst = c + r * ldc + q * P::size;
+                P::store(dst, Op::apply(P::load(dst), acc[r][q]));
+            }
+        }
+    }
+    
+    // multiplies the packed blocks, tiles overlapping the border of the
+    // result going through a temporary
+    template <typename Op, std::size_t MR, std::size_t NR, std::size_t W, typename T>
+    inline void gemmMacroKernel(std::size_t m, std::size_t n, std::size_t k,
+                                const T* a, const T* b, T* c, std::size_t ldc) {
+        alignas(64) T tile[MR * NR];
+        for (std::size_t j(0); j < n; j += NR) {
+            std::size_t const cols = std::min(NR, n - j);
+            for (std::size_t i(0); i < m; i += MR) {
+                std::size_t const rows = std::min(MR, m - i);
+                T* dst = c + i * ldc + j;
+                if (rows == MR && cols == NR) {
+                    gemmMicroKernel<Op, MR, NR, W>(k, a + i * k, b + j * k, dst, ldc);
+                } else {
+                    gemmMicroKernel<Assign, MR, NR, W>(k, a + i * k, b + j * k, tile, NR);
+                    for (std::size_t r(0); r < rows; r++) {
+                        for (std::size_t q(0); q < cols; q++) {
+                            dst[r * ldc + q] = Op::apply(dst[r * ldc + q], tile[r * NR + q]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    /**
+     *
+     * Evaluates the product of the \c M x \c K expression \c a by the
+     * \c K x \c N expression \c b into the row-major memory at \c c, rows
+     * being \c ldc elements apart, combining it with the current content
+     * through \c Op. Dimensions known at compile time select the blocking,
+     * the actual ones being read from the operands.
+     *
+     * Operands are read through their (row, col) accessor while being packed,
+     * so any matrix expression can be multiplied without being evaluated
+     * first.
+     *
+     * From \c EXPAND_PARALLEL_GEMM_THRESHOLD multiply-adds on, the blocks of
+     * rows of each panel are dealt to the thread pool, every thread packing
+     * its own blocks of the left-hand side into its own buffer while sharing
+     * the packed panel of the right-hand side.
+     *
+     * Packing and multiplication run in code compiled for the instruction
+     * set selected at runtime, whose packets are \c W bytes wide.
+     *
+     */
+    template <typename Op, std::size_t M, std::size_t K, std::size_t N, std::size_t W,
+              typename T, typename T1, typename T2>
+    void gemmBlocked(T* c, std::size_t ldc, T1 const& a, T2 const& b) {
+        typedef GemmBlocking<T, M, K, N, W> B;
+        typedef GemmBuffers<T, M, K, N> Buffers;
+        typedef typename std::conditional<std::is_same<Op, SubAssign>::value,
+                                          SubAssign, AddAssign>::type Acc;
+        
+        std::size_t const rows = a.rows();
+        std::size_t const depth = a.cols();
+        std::size_t const cols = b.cols();
+        
+        // blocks of rows, no larger than mc, leaving several per thread
+        bool const parallel = rows * depth * cols >= EXPAND_PARALLEL_GEMM_THRESHOLD;
+        std::size_t const grain = parallel ? std::min(B::mc, parallelGrain<T>(rows, B::mr)) : rows;
+        
+        for (std::size_t jc(0); jc < cols; jc += B::nc) {
+            std::size_t const n = std::min(B::nc, cols - jc);
+            for (std::size_t pc(0); pc < depth; pc += B::kc) {
+                std::size_t const k = std::min(B::kc, depth - pc);
+                T* const rhs = Buffers::rhs();
+                Target<W>::run([&](auto) {
+                    gemmPackRhs<B::nr>(rhs, b, pc, k, jc, n);
+                });
+                parallelFor(rows, grain, [&](std::size_t begin, std::size_t end) {
+                    Target<W>::run([&](auto) {
+                        T* const lhs = Buffers::lhs();
+                        for (std::size_t ic(begin); ic < end; ic += B::mc) {
+                            std::size_t const m = std::min(B::mc, end - ic);
+                            gemmPackLhs<B::mr>(lhs, a, ic, m, pc, k);
+                            T* dst = c + ic * ldc + jc;
+                            if (pc == 0) {
+                                gemmMacroKernel<Op, B::mr, B::nr, W>(m, n, k, lhs, rhs, dst, ldc);
+                            } else {
+                                gemmMacroKernel<Acc, B::mr, B::nr, W>(m, n, k, lhs, rhs, dst, ldc);
+                            }
+                        }
+                    });
+                });
+            }
+        }
+    }
+    
+    // evaluates the product of \c a by \c b with the blocking of the
+    // instruction set selected at runtime
+    template <typename Op, std::size_t M, std::size_t K, std::size_t N,
+              typename T, typename T1, typename T2>
+    void gemm(T* c, std::size_t ldc, T1 const& a, T2 const& b) {
+        selectWidth([&](auto w) {
+            gemmBlocked<Op, M, K, N, decltype(w)::value>(c, ldc, a, b);
+        });
+    }
+    
+    // evaluates rows [\c begin, \c end) of the product of \c a by \c x in
+    // packets of \c W bytes, accumulating reduced-precision elements in
+    // their widened type
+    template <typename Op, std::size_t W, typename T, typename E, typename S>
+    void gemvRange(T* y, std::size_t step, E const& a, const S* x, std::size_t begin, std::size_t end) {
+        typedef typename Widened<T>::type C;
+        constexpr std::size_t R = 4;
+        std::size_t const K = a.cols();
+        std::size_t i(begin);
+        if constexpr (E::vectorizable && std::is_same<C, WidenedType<E>>::value) {
+            typedef Packet<C, W> P;
+            for (; i + R <= end; i += R) {
+                typename P::type acc[R] = {};
+                std::size_t j(0);
+                for (; j + P::size <= K; j += P::size) {
+                    typename P::type const xp = P::load(x + j);
+#pragma GCC unroll 4
+                    for (std::size_t r(0); r < R; r++) {
+                        acc[r] += a.template packet<P>(i + r, j) * xp;
+                    }
+                }
+                for (std::size_t r(0); r < R; r++) {
+                    C sum(P::sum(acc[r]));
+                    for (std::size_t k(j); k < K; k++) {
+                        sum += static_cast<C>(element(a, i + r, k)) * static_cast<C>(x[k]);
+                    }
+                    y[(i + r) * step] = static_cast<T>(Op::apply(static_cast<C>(y[(i + r) * step]), sum));
+                }
+            }
+        }
+        // counted from a local bound, which keeps the compiler from
+        // reasoning about the overflow of i * step
+        std::size_t const n = end - i;
+        T* const yi = y + i * step;
+        for (std::size_t r(0); r < n; r++) {
+            C sum(0);
+            for (std::size_t k(0); k < K; k++) {
+                sum += static_cast<C>(element(a, i + r, k)) * static_cast<C>(x[k]);
+            }
+            yi[r * step] = static_cast<T>(Op::apply(static_cast<C>(yi[r * step]), sum));
+        }
+    }
+    
+    // evaluates elements [\c begin, \c end) of the product of the transpose
+    // of the Matrix \c a by \c x, each strip of columns of \c a being
+    // accumulated in registers of \c W bytes, scaled by \c x, over all its
+    // rows
+    template <typename Op, std::size_t W, typename T, typename E>
+    void gemvTransposedRange(T* y, std::size_t step, E const& a, const T* x, std::size_t begin, std::size_t end) {
+        typedef Packet<T, W> P;
+        constexpr std::size_t R = 4;
+        std::size_t const K = a.rows();
+        std::size_t const ld = a.stride();
+        const T* data = a.data();
+        std::size_t j(begin);
+        for (; j + R * P::size <= end; j += R * P::size) {
+            typename P::type acc[R] = {};
+            for (std::size_t k(0); k < K; k++) {
+                typename P::type const xk = P::set1(x[k]);
+#pragma GCC unroll 4
+                for (std::size_t r(0); r < R; r++) {
+                    acc[r] += xk * P::load(data + k * ld + j + r * P::size);
+                }
+            }
+            for (std::size_t r(0); r < R; r++) {
+                alignas(64) T sums[P::size];
+                P::store(sums, acc[r]);
+                for (std::size_t l(0); l < P::size; l++) {
+                    T& dst = y[(j + r * P::size + l) * step];
+                    dst = Op::apply(dst, sums[l]);
+                }
+            }
+        }
+        for (; j < end; j++) {
+            T sum(0);
+            for (std::size_t k(0); k < K; k++) {
+                sum += data[k * ld + j] * x[k];
+            }
+            y[j * step] = Op::apply(y[j * step], sum);
+        }
+    }
+    
+    /**
+     *
+     * Evaluates the product of the matrix expression \c a by the
+     * contiguous vector at \c x into memory at \c y, consecutive elements
+     * being \c step apart, combining it with the current content through
+     * \c Op. Reduced-precision elements of \c y may be computed from a
+     * vector \c x of their widened type.
+     *
+     * Rows are processed four at a time so that each packet of \c x is
+     * loaded once for all of them, from \c EXPAND_PARALLEL_THRESHOLD matrix
+     * elements on by several threads. The transpose of a Matrix of exact
+     * elements is rather read along its rows, strips of columns being dealt
+     * to the threads. Either way, rows run in code compiled for the
+     * instruction set selected at runtime.
+     *
+     */
+    template <typename Op, typename T, typename E, typename S>
+    void gemv(T* y, std::size_t step, E const& a, const S* x) {
+        std::size_t const M = a.rows();
+        if constexpr (IsTransposedStorage<E, T>::value && std::is_same<S, T>::value &&
+                      std::is_same<typename Widened<T>::type, T>::value) {
+            // strips span as many columns as the selected kernel processes
+            selectWidth([&](auto w) {
+                constexpr std::size_t W = decltype(w)::value;
+                auto range = [&](std::size_t begin, std::size_t end) {
+                    Target<W>::run([&](auto) {
+                        gemvTransposedRange<Op, W>(y, step, a.u, x, begin, end);
+                    });
+                };
+                if (M * a.cols() >= EXPAND_PARALLEL_THRESHOLD) {
+                    parallelFor(M, parallelGrain<T>(M * a.cols(), 4 * Packet<T, W>::size * a.cols()) / a.cols(), range);
+                } else {
+                    range(0, M);
+                }
+            });
+        } else {
+            auto range = [&](std::size_t begin, std::size_t end) {
+                dispatch([&](auto w) {
+                    gemvRange<Op, decltype(w)::value>(y, step, a, x, begin, end);
+                });
+            };
+            if (M * a.cols() >= EXPAND_PARALLEL_THRESHOLD) {
+                parallelFor(M, parallelGrain<T>(M * a.cols(), 4 * a.cols()) / a.cols(), range);
+            } else {
+                range(0, M);
+            }
+        }
+    }
+    
+    // --------------------------------------------------------------------
+    // expression nodes
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Matrix product. It is evaluated by the blocked \c gemm kernel when
+     * assigned to a Matrix; used as an operand of another expression, each
+     * element is computed as a dot product, so products should be assigned
+     * to a Matrix before being combined further.
+     *
+     */
+    template <typename T1, typename T2>
+    struct MatrixProduct {
+        
+        typedef decltype(std::declval<T1>()(0, 0) * std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr bool vectorizable = false;
+        
+        static_assert(MatrixShape<T1>::cols == MatrixShape<T2>::rows ||
+                      MatrixShape<T1>::cols == Dynamic || MatrixShape<T2>::rows == Dynamic,
+                      "Matrix dimensions must agree");
+        
+        T1 const& u;
+        T2 const& v;
+        
+        constexpr std::size_t rows() const {
+            return u.rows();
+        }
+        
+        constexpr std::size_t cols() const {
+            return v.cols();
+        }
+        
+        constexpr std::size_t size() const {
+            return rows() * cols();
+        }
+        
+        constexpr value_type operator()(std::size_t i, std::size_t j) const {
+            value_type sum(0);
+            for (std::size_t k(0); k < u.cols(); k++) {
+                sum += element(u, i, k) * element(v, k, j);
+            }
+            return sum;
+        }
+        
+        constexpr value_type operator[](std::size_t i) const {
+            return (*this)(i / cols(), i % cols());
+        }
+        
+        // evaluates the product into the row-major memory at \c dst
+        template <typename Op, typename T>
+        void evaluateTo(T* dst, std::size_t ldc) const {
+            gemm<Op, MatrixShape<T1>::rows, MatrixShape<T1>::cols, MatrixShape<T2>::cols>(dst, ldc, u, v);
+        }
+    };
+    
+    /**
+     *
+     * Product of a matrix by a vector. It is evaluated row by row by the
+     * \c gemv kernel when assigned to a Vector, the vector operand being
+     * first evaluated into contiguous memory unless it already lies there.
+     *
+     */
+    template <typename T1, typename T2>
+    struct MatrixVectorProduct {
+        
+        typedef decltype(std::declval<T1>()(0, 0) * std::declval<T2>()[0]) value_type;
+        
+        static constexpr bool vectorizable = false;
+        
+        static_assert(MatrixShape<T1>::cols == VectorShape<T2>::size ||
+                      MatrixShape<T1>::cols == Dynamic || VectorShape<T2>::size == Dynamic,
+                      "Matrix and Vector dimensions must agree");
+        
+        T1 const& u;
+        T2 const& v;
+        
+        constexpr std::size_t size() const {
+            return u.rows();
+        }
+        
+        constexpr value_type operator[](std::size_t i) const {
+            value_type sum(0);
+            for (std::size_t k(0); k < u.cols(); k++) {
+                sum += element(u, i, k) * element(v, k);
+            }
+            return sum;
+        }
+        
+        template <typename Op, typename T>
+        void evaluateTo(T* dst, std::size_t step, std::size_t) const {
+            if constexpr (IsContiguousVector<T2, T>::value) {
+                // the destination may be the vector operand itself
+                if (v.elements() != dst) {
+                    gemv<Op>(dst, step, u, v.elements());
+                    return;
+                }
+            } else if constexpr (IsContiguousVector<T2, typename Widened<T>::type>::value) {
+                gemv<Op>(dst, step, u, v.elements());
+                return;
+            }
+            // evaluated in the widened type of reduced-precision elements,
+            // so that they are only rounded once stored
+            Vector<typename Widened<T>::type, MatrixShape<T1>::cols, 0> x(v);
+            gemv<Op>(dst, step, u, x.elements());
+        }
+    };
+    
+    template <typename T1, typename T2>
+    struct IsMatrixExpression<MatrixProduct<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsVectorExpression<MatrixVectorProduct<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct HasEvaluateTo<MatrixVectorProduct<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct VectorShape<MatrixVectorProduct<T1, T2>> {
+        static constexpr std::size_t size = MatrixShape<T1>::rows;
+    };
+    
+    template <typename T1, typename T2>
+    struct MatrixShape<MatrixProduct<T1, T2>> {
+        static constexpr std::size_t rows = MatrixShape<T1>::rows;
+        static constexpr std::size_t cols = MatrixShape<T2>::cols;
+    };
+    
+    // the direct index of a product runs over its packed row-major elements
+    template <typename T1, typename T2>
+    struct MatrixLayout<MatrixProduct<T1, T2>> {
+        typedef Packed type;
+    };
+    
+    // --------------------------------------------------------------------
+    // operators
+    // --------------------------------------------------------------------
+    
+    // matrix product
+    template <typename T1, typename T2, EnableIfMatrixExpressions<T1, T2> = 0>
+    constexpr auto operator*(T1 const& u, T2 const& v) {
+        ASSERT(u.cols() == v.rows(), "Matrix dimensions must agree");
+        return MatrixProduct<T1, T2>{u, v};
+    }
+    
+    // matrix-vector product
+    template <typename T1, typename T2, typename std::enable_if<
+        IsMatrixExpression<T1>::value && IsVectorExpression<T2>::value, int>::type = 0>
+    constexpr auto operator*(T1 const& u, T2 const& v) {
+        ASSERT(u.cols() == v.size(), "Matrix and Vector dimensions must agree");
+        return MatrixVectorProduct<T1, T2>{u, v};
+    }
+}
+
+EXPAND_PSABI_END
+
+#endif /* MatrixProduct_h */
@@ -0,0 +1,624 @@
+//
+//  MatrixSolve.h
+//  Expand
+//
+
+#ifndef MatrixSolve_h
+#define MatrixSolve_h
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include "MatrixOps.h"
+#include "MatrixProduct.h"
+#include "MatrixTranspose.h"
+#include "VectorOps.h"
+
+// square matrices up to this size are factorized and solved by fully
+// unrolled kernels
+#ifndef EXPAND_SOLVE_UNROLL_LIMIT
+#   define EXPAND_SOLVE_UNROLL_LIMIT 8
+#endif
+
+// number of columns factorized at a time by the blocked kernels, the rest
+// of the matrix being updated by the matrix product
+#ifndef EXPAND_SOLVE_BLOCK
+#   define EXPAND_SOLVE_BLOCK 32
+#endif
+
+namespace expand {
+    
+    template <typename T, std::size_t N, std::size_t S, typename A>
+    class Vector;
+    
+    // --------------------------------------------------------------------
+    // kernels
+    // --------------------------------------------------------------------
+    
+    // dimension \c n, known at compile time unless \c N is Dynamic
+    template <std::size_t N>
+    constexpr std::size_t dimension(std::size_t n) {
+        return N == Dynamic ? n : N;
+    }
+    
+    // true when square matrices of size \c N are handled by the unrolled
+    // kernels
+    template <std::size_t N>
+    constexpr bool unrolledSolve() {
+        return N != Dynamic && N <= EXPAND_SOLVE_UNROLL_LIMIT;
+    }
+    
+    /**
+     *
+     * Solves T X = B in place for the \c n x \c n triangular matrix T at
+     * \c t, lower triangular if \c Lower and upper triangular otherwise, of
+     * unit diagonal if \c Unit. Element (i, j) of T is t[i * rs + j * cs],
+     * so that transposes are read in place. B is the \c n x \c r matrix at
+     * \c b, rows being \c ldb elements apart.
+     *
+     * \c N and \c R, when not Dynamic, give \c n and \c r at compile time.
+     *
+     */
+    template <bool Lower, bool Unit, std::size_t N, std::size_t R, typename T>
+    void trsmUnblocked(const T* t, std::size_t rs, std::size_t cs, T* b, std::size_t ldb,
+                       std::size_t rows, std::size_t cols) {
+        std::size_t const n = dimension<N>(rows);
+        std::size_t const r = dimension<R>(cols);
+#pragma GCC unroll 8
+        for (std::size_t s(0); s < n; s++) {
+            std::size_t const i = Lower ? s : n - 1 - s;
+            T* bi = b + i * ldb;
+#pragma GCC unroll 8
+            for (std::size_t k(Lower ? 0 : i + 1); k < (Lower ? i : n); k++) {
+                T const tik = t[i * rs + k * cs];
+                const T* bk = b + k * ldb;
+                for (std::size_t j(0); j < r; j++) {
+                    bi[j] -= tik * bk[j];
+                }
+            }
+            if (!Unit) {
+                T const inv = T(1) / t[i * rs + i * cs];
+                for (std::size_t j(0); j < r; j++) {
+                    bi[j] *= inv;
+                }
+            }
+        }
+    }
+    
+    /**
+     *
+     * Solves T X = B in place as \c trsmUnblocked, large systems with many
+     * right-hand sides being solved a block of rows at a time, each block
+     * being first updated by the matrix product with the rows already
+     * solved.
+     *
+     * T must be stored by rows (\c cs of 1) or by columns (\c rs of 1).
+     *
+     */
+    template <bool Lower, bool Unit, std::size_t N, std::size_t R, typename T>
+    void trsm(const T* t, std::size_t rs, std::size_t cs, T* b, std::size_t ldb, std::size_t n, std::size_t r) {
+        constexpr std::size_t NB = EXPAND_SOLVE_BLOCK;
+        if (unrolledSolve<N>() || n <= NB || r < NB) {
+            trsmUnblocked<Lower, Unit, N, R>(t, rs, cs, b, ldb, n, r);
+            return;
+        }
+        ASSERT(cs == 1 || rs == 1, "Triangular matrices must be stored by rows or by columns");
+        typedef Matrix<T, Dynamic, Dynamic, Mapped> View;
+        // views only read the triangular matrix
+        T* const tt = const_cast<T*>(t);
+        for (std::size_t s(0); s < n; s += NB) {
+            std::size_t const m = std::min(NB, n - s);
+            std::size_t const i = Lower ? s : n - s - m;
+            // rows already solved, before the block or after it
+            std::size_t const j = Lower ? 0 : i + m;
+            std::size_t const k = Lower ? i : n - j;
+            if (k > 0) {
+                View const x(b + j * ldb, k, r, ldb);
+                if (cs == 1) {
+                    View const tik(tt + i * rs + j, m, k, rs);
+                    gemm<SubAssign, Dynamic, Dynamic, Dynamic>(b + i * ldb, ldb, tik, x);
+                } else {
+                    View const tki(tt + j * cs + i, k, m, cs);
+                    gemm<SubAssign, Dynamic, Dynamic, Dynamic>(b + i * ldb, ldb, transpose(tki), x);
+                }
+            }
+            trsmUnblocked<Lower, Unit, Dynamic, R>(t + i * rs + i * cs, rs, cs, b + i * ldb, ldb, m, r);
+        }
+    }
+    
+    /**
+     *
+     * Factorizes in place the \c m x \c n panel at \c a, \c m >= \c n, rows
+     * being \c ld elements apart, as P A = L U by Gaussian elimination with
+     * partial pivoting: L, of unit diagonal, is stored below the diagonal
+     * and U on and above it, row k having been swapped with row piv[k].
+     *
+     * Returns false when a pivot is zero, the elimination then going on
+     * with the next column.
+     *
+     */
+    template <std::size_t N, typename T>
+    bool luUnblocked(T* a, std::size_t ld, std::size_t rows, std::size_t cols, std::size_t* piv) {
+        std::size_t const m = dimension<N>(rows);
+        std::size_t const n = dimension<N>(cols);
+        bool invertible(true);
+#pragma GCC unroll 8
+        for (std::size_t k(0); k < n; k++) {
+            std::size_t p(k);
+            T max(std::abs(a[k * ld + k]));
+#pragma GCC unroll 8
+            for (std::size_t i(k + 1); i < m; i++) {
+                T const v = std::abs(a[i * ld + k]);
+                if (v > max) {
+                    max = v;
+                    p = i;
+                }
+            }
+            piv[k] = p;
+            if (p != k) {
+                std::swap_ranges(a + k * ld, a + k * ld + n, a + p * ld);
+            }
+            if (max == T(0)) {
+                invertible = false;
+                continue;
+            }
+            T const inv = T(1) / a[k * ld + k];
+#pragma GCC unroll 8
+            for (std::size_t i(k + 1); i < m; i++) {
+                T const l = a[i * ld + k] *= inv;
+#pragma GCC unroll 8
+                for (std::size_t j(k + 1); j < n; j++) {
+                    a[i * ld + j] -= l * a[k * ld + j];
+                }
+            }
+        }
+        return invertible;
+    }
+    
+    /**
+     *
+     * Factorizes in place the \c n x \c n matrix at \c a as \c luUnblocked.
+     *
+     * Large matrices are factorized a panel of \c EXPAND_SOLVE_BLOCK
+     * columns at a time, right-looking: once the panel is factorized and
+     * its row swaps applied to the whole rows, the block of U on its right
+     * is solved and the trailing matrix updated by the matrix product, which
+     * carries most of the operations.
+     *
+     */
+    template <std::size_t N, typename T>
+    bool lu(T* a, std::size_t ld, std::size_t n, std::size_t* piv) {
+        constexpr std::size_t NB = EXPAND_SOLVE_BLOCK;
+        if (unrolledSolve<N>() || n <= NB) {
+            return luUnblocked<N>(a, ld, n, n, piv);
+        }
+        typedef Matrix<T, Dynamic, Dynamic, Mapped> View;
+        bool invertible(true);
+        for (std::size_t k(0); k < n; k += NB) {
+            std::size_t const b = std::min(NB, n - k);
+            std::size_t const rest = n - k - b;
+            invertible &= luUnblocked<Dynamic>(a + k * ld + k, ld, n - k, b, piv + k);
+            for (std::size_t i(k); i < k + b; i++) {
+                piv[i] += k;
+                if (piv[i] != i) {
+                    std::swap_ranges(a + i * ld, a + i * ld + k, a + piv[i] * ld);
+                    std::swap_ranges(a + i * ld + k + b, a + i * ld + n, a + piv[i] * ld + k + b);
+                }
+            }
+            if (rest > 0) {
+                T* const a12 = a + k * ld + k + b;
+                trsmUnblocked<true, true, Dynamic, Dynamic>(a + k * ld + k, ld, 1, a12, ld, b, rest);
+                View const l21(a + (k + b) * ld + k, rest, b, ld);
+                View const u12(a12, b, rest, ld);
+                gemm<SubAssign, Dynamic, Dynamic, Dynamic>(a12 + b * ld, ld, l21, u12);
+            }
+        }
+        return invertible;
+    }
+    
+    // factorizes in place the \c n x \c n symmetric positive definite matrix
+    // at \c a as L L^T, L being stored on and below the diagonal, from its
+    // lower triangle; returns false when the matrix is not positive definite
+    template <std::size_t N, typename T>
+    bool choleskyUnblocked(T* a, std::size_t ld, std::size_t rows) {
+        std::size_t const n = dimension<N>(rows);
+#pragma GCC unroll 8
+        for (std::size_t j(0); j < n; j++) {
+            const T* lj = a + j * ld;
+            T d(lj[j]);
+#pragma GCC unroll 8
+            for (std::size_t k(0); k < j; k++) {
+                d -= lj[k] * lj[k];
+            }
+            if (!(d > T(0))) {
+                return false;
+            }
+            T const ljj = std::sqrt(d);
+            T const inv = T(1) / ljj;
+            a[j * ld + j] = ljj;
+#pragma GCC unroll 8
+            for (std::size_t i(j + 1); i < n; i++) {
+                T* li = a + i * ld;
+                T s(li[j]);
+#pragma GCC unroll 8
+                for (std::size_t k(0); k < j; k++) {
+                    s -= li[k] * lj[k];
+                }
+                li[j] = s * inv;
+            }
+        }
+        return true;
+    }
+    
+    /**
+     *
+     * Factorizes in place the \c n x \c n matrix at \c a as
+     * \c choleskyUnblocked, then clears its strict upper triangle.
+     *
+     * Large matrices are factorized a block of \c EXPAND_SOLVE_BLOCK columns
+     * at a time, right-looking: once the diagonal block is factorized, the
+     * block below it is solved row by row and the trailing matrix updated by
+     * the matrix product.
+     *
+     */
+    template <std::size_t N, typename T>
+    bool cholesky(T* a, std::size_t ld, std::size_t n) {
+        constexpr std::size_t NB = EXPAND_SOLVE_BLOCK;
+        bool positive(true);
+        if (unrolledSolve<N>() || n <= NB) {
+            positive = choleskyUnblocked<N>(a, ld, n);
+        } else {
+            typedef Matrix<T, Dynamic, Dynamic, Mapped> View;
+            for (std::size_t k(0); positive && k < n; k += NB) {
+                std::size_t const b = std::min(NB, n - k);
+                std::size_t const rest = n - k - b;
+                positive = choleskyUnblocked<Dynamic>(a + k * ld + k, ld, b);
+                if (positive && rest > 0) {
+                    // L21 L11^T = A21
+                    for (std::size_t i(k + b); i < n; i++) {
+                        T* x = a + i * ld + k;
+                        for (std::size_t j(0); j < b; j++) {
+                            const T* lj = a + (k + j) * ld + k;
+                            T s(x[j]);
+                            for (std::size_t q(0); q < j; q++) {
+                                s -= x[q] * lj[q];
+                            }
+                            x[j] = s / lj[j];
+                        }
+                    }
+                    View const l21(a + (k + b) * ld + k, rest, b, ld);
+                    gemm<SubAssign, Dynamic, Dynamic, Dynamic>(a + (k + b) * ld + k + b, ld, l21, transpose(l21));
+                }
+            }
+        }
+        std::size_t const m = dimension<N>(n);
+        for (std::size_t i(0); i < m; i++) {
+            std::fill(a + i * ld + i + 1, a + i * ld + m, T(0));
+        }
+        return positive;
+    }
+    
+    // --------------------------------------------------------------------
+    // solutions
+    // --------------------------------------------------------------------
+    
+    // size of the square matrix expression \c E known at compile time,
+    // \c Dynamic otherwise
+    template <typename E>
+    struct SquareShape {
+        
+        static constexpr std::size_t rows = MatrixShape<E>::rows;
+        static constexpr std::size_t cols = MatrixShape<E>::cols;
+        
+        static_assert(rows == cols || rows == Dynamic || cols == Dynamic, "Matrix must be square");
+        
+        static constexpr std::size_t size = rows == Dynamic || cols == Dynamic ? Dynamic : rows;
+    };
+    
+    /**
+     *
+     * Vector or Matrix holding the solution X of A X = B, for a square
+     * matrix A of size \c N and right-hand side B of type \c E, and gives
+     * access to its elements as an \c n x \c r matrix.
+     *
+     */
+    template <typename T, std::size_t N, typename E, bool = IsVectorExpression<E>::value>
+    struct Solution {
+        
+        typedef Vector<T, N, 0, Packed> type;
+        
+        static constexpr std::size_t cols = 1;
+        
+        static T* data(type& x) {
+            return x.elements();
+        }
+        
+        static std::size_t height(type const& x) {
+            return x.size();
+        }
+        
+        static std::size_t stride(type const&) {
+            return 1;
+        }
+        
+        static std::size_t width(type const&) {
+            return 1;
+        }
+    };
+    
+    template <typename T, std::size_t N, typename E>
+    struct Solution<T, N, E, false> {
+        
+        static constexpr std::size_t cols = MatrixShape<E>::cols;
+        
+        static constexpr bool dynamic = N == Dynamic || cols == Dynamic;
+        
+        typedef Matrix<T, dynamic ? Dynamic : N, dynamic ? Dynamic : cols, Packed> type;
+        
+        static T* data(type& x) {
+            return x.data();
+        }
+        
+        static std::size_t height(type const& x) {
+            return x.rows();
+        }
+        
+        static std::size_t stride(type const& x) {
+            return x.stride();
+        }
+        
+        static std::size_t width(type const& x) {
+            return x.cols();
+        }
+    };
+    
+    /**
+     *
+     * LU factorization with partial pivoting P A = L U of a square matrix
+     * of size \c N, computed once to solve any number of systems and give
+     * the determinant and inverse.
+     *
+     * Matrices up to \c EXPAND_SOLVE_UNROLL_LIMIT rows are factorized by
+     * fully unrolled code, which stays in registers and L1, and larger
+     * ones by the blocked kernel.
+     *
+     * Singular matrices are factorized as well, \c invertible() telling
+     * them apart: solving with them gives non-finite elements.
+     *
+     */
+    template <typename T, std::size_t N>
+    class LU {
+        
+        static_assert(std::is_floating_point<T>::value, "LU factorization requires floating point elements");
+        
+    public:
+        
+        template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+        explicit LU(MatExpression const& a) : _lu(a), _piv(_lu.rows()) {
+            ASSERT(_lu.rows() == _lu.cols(), "LU factorization only defined for a square Matrix");
+            _invertible = lu<N>(_lu.data(), _lu.stride(), _lu.rows(), _piv.elements());
+        }
+        
+        // false when U has a zero on its diagonal
+        bool invertible() const {
+            return _invertible;
+        }
+        
+        // L of unit diagonal below the diagonal and U on and above it
+        Matrix<T, N, N, Packed> const& matrixLU() const {
+            return _lu;
+        }
+        
+        // row k of the matrix was swapped with row permutation()[k], k
+        // going increasing
+        Vector<std::size_t, N, 0, Packed> const& permutation() const {
+            return _piv;
+        }
+        
+        T determinant() const {
+            T det(1);
+            for (std::size_t k(0); k < _lu.rows(); k++) {
+                det *= _piv[k] == k ? _lu(k, k) : -_lu(k, k);
+            }
+            return det;
+        }
+        
+        // solution X of A X = B, B being a vector or matrix expression
+        template <typename E>
+        typename Solution<T, N, E>::type solve(E const& b) const {
+            typedef Solution<T, N, E> S;
+            typename S::type x(b);
+            ASSERT(_lu.rows() == S::height(x), "Matrix dimensions must agree");
+            solveInPlace<S::cols>(S::data(x), S::stride(x), S::width(x));
+            return x;
+        }
+        
+        Matrix<T, N, N, Packed> inverse() const {
+            Matrix<T, N, N, Packed> x(identity());
+            solveInPlace<N>(x.data(), x.stride(), x.cols());
+            return x;
+        }
+        
+    private:
+        
+        Matrix<T, N, N, Packed> _lu;
+        Vector<std::size_t, N, 0, Packed> _piv;
+        bool _invertible;
+        
+        Matrix<T, N, N, Packed> identity() const {
+            Matrix<T, N, N, Packed> id(_lu);
+            for (std::size_t i(0); i < id.rows(); i++) {
+                for (std::size_t j(0); j < id.cols(); j++) {
+                    id(i, j) = T(i == j);
+                }
+            }
+            return id;
+        }
+        
+        // solves A X = B in place for the \c n x \c r matrix at \c b
+        template <std::size_t R>
+        void solveInPlace(T* b, std::size_t ldb, std::size_t r) const {
+            std::size_t const n = dimension<N>(_lu.rows());
+            for (std::size_t k(0); k < n; k++) {
+                if (_piv[k] != k) {
+                    std::swap_ranges(b + k * ldb, b + k * ldb + r, b + _piv[k] * ldb);
+                }
+            }
+            trsm<true, true, N, R>(_lu.data(), _lu.stride(), 1, b, ldb, n, r);
+            trsm<false, false, N, R>(_lu.data(), _lu.stride(), 1, b, ldb, n, r);
+        }
+    };
+    
+    /**
+     *
+     * Cholesky factorization A = L L^T of a symmetric positive definite
+     * matrix of size \c N, of which only the lower triangle is read, twice
+     * cheaper than the LU factorization and stable without pivoting.
+     *
+     * Matrices up to \c EXPAND_SOLVE_UNROLL_LIMIT rows are factorized by
+     * fully unrolled code and larger ones by the blocked kernel. Matrices
+     * which are not positive definite are told apart by \c positive(), L
+     * then being incomplete.
+     *
+     */
+    template <typename T, std::size_t N>
+    class Cholesky {
+        
+        static_assert(std::is_floating_point<T>::value, "Cholesky factorization requires floating point elements");
+        
+    public:
+        
+        template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+        explicit Cholesky(MatExpression const& a) : _l(a) {
+            ASSERT(_l.rows() == _l.cols(), "Cholesky factorization only defined for a square Matrix");
+            _positive = cholesky<N>(_l.data(), _l.stride(), _l.rows());
+        }
+        
+        // false when the matrix is not positive definite
+        bool positive() const {
+            return _positive;
+        }
+        
+        // lower triangular factor
+        Matrix<T, N, N, Packed> const& matrixL() const {
+            return _l;
+        }
+        
+        T determinant() const {
+            T det(1);
+            for (std::size_t k(0); k < _l.rows(); k++) {
+                det *= _l(k, k);
+            }
+            return det * det;
+        }
+        
+        // solution X of A X = B, B being a vector or matrix expression
+        template <typename E>
+        typename Solution<T, N, E>::type solve(E const& b) const {
+            typedef Solution<T, N, E> S;
+            typename S::type x(b);
+            ASSERT(_l.rows() == S::height(x), "Matrix dimensions must agree");
+            solveInPlace<S::cols>(S::data(x), S::stride(x), S::width(x));
+            return x;
+        }
+        
+        Matrix<T, N, N, Packed> inverse() const {
+            Matrix<T, N, N, Packed> x(_l);
+            for (std::size_t i(0); i < x.rows(); i++) {
+                for (std::size_t j(0); j < x.cols(); j++) {
+                    x(i, j) = T(i == j);
+                }
+            }
+            solveInPlace<N>(x.data(), x.stride(), x.cols());
+            return x;
+        }
+        
+    private:
+        
+        Matrix<T, N, N, Packed> _l;
+        bool _positive;
+        
+        // solves L L^T X = B in place for the \c n x \c r matrix at \c b,
+        // L^T being read in place
+        template <std::size_t R>
+        void solveInPlace(T* b, std::size_t ldb, std::size_t r) const {
+            std::size_t const n = dimension<N>(_l.rows());
+            trsm<true, false, N, R>(_l.data(), _l.stride(), 1, b, ldb, n, r);
+            trsm<false, false, N, R>(_l.data(), 1, _l.stride(), b, ldb, n, r);
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // functions
+    // --------------------------------------------------------------------
+    
+    // LU factorization of a square matrix expression
+    template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+    auto lu(MatExpression const& a) {
+        return LU<typename MatExpression::value_type, SquareShape<MatExpression>::size>(a);
+    }
+    
+    // Cholesky factorization of a symmetric positive definite matrix
+    // expression
+    template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+    auto cholesky(MatExpression const& a) {
+        return Cholesky<typename MatExpression::value_type, SquareShape<MatExpression>::size>(a);
+    }
+    
+    // solution X of A X = B, B being a vector or matrix expression
+    template <typename MatExpression, typename E, EnableIfMatrixExpression<MatExpression> = 0>
+    auto solve(MatExpression const& a, E const& b) {
+        return lu(a).solve(b);
+    }
+    
+    // determinant, in closed form up to 3 x 3
+    template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+    auto determinant(MatExpression const& a) {
+        typedef typename MatExpression::value_type T;
+        constexpr std::size_t N = SquareShape<MatExpression>::size;
+        ASSERT(a.rows() == a.cols(), "Determinant only defined for a square Matrix");
+        if constexpr (N == 1) {
+            return T(a(0, 0));
+        } else if constexpr (N == 2) {
+            return T(a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0));
+        } else if constexpr (N == 3) {
+            return T(a(0, 0) * (a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1)) -
+                     a(0, 1) * (a(1, 0) * a(2, 2) - a(1, 2) * a(2, 0)) +
+                     a(0, 2) * (a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0)));
+        } else {
+            return LU<T, N>(a).determinant();
+        }
+    }
+    
+    // inverse, in closed form up to 3 x 3, singular matrices giving
+    // non-finite elements
+    template <typename MatExpression, EnableIfMatrixExpression<MatExpression> = 0>
+    auto inverse(MatExpression const& a) {
+        typedef typename MatExpression::value_type T;
+        constexpr std::size_t N = SquareShape<MatExpression>::size;
+        ASSERT(a.rows() == a.cols(), "Inverse only defined for a square Matrix");
+        if constexpr (N == 1) {
+            return Matrix<T, 1, 1, Packed>(T(1) / a(0, 0));
+        } else if constexpr (N == 2) {
+            T const inv = T(1) / determinant(a);
+            return Matrix<T, 2, 2, Packed>{a(1, 1) * inv, -a(0, 1) * inv,
+                                           -a(1, 0) * inv, a(0, 0) * inv};
+        } else if constexpr (N == 3) {
+            // transposed cofactors
+            T const c00 = a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1);
+            T const c01 = a(1, 2) * a(2, 0) - a(1, 0) * a(2, 2);
+            T const c02 = a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0);
+            T const inv = T(1) / (a(0, 0) * c00 + a(0, 1) * c01 + a(0, 2) * c02);
+            return Matrix<T, 3, 3, Packed>{
+                c00 * inv, (a(0, 2) * a(2, 1) - a(0, 1) * a(2, 2)) * inv, (a(0, 1) * a(1, 2) - a(0, 2) * a(1, 1)) * inv,
+                c01 * inv, (a(0, 0) * a(2, 2) - a(0, 2) * a(2, 0)) * inv, (a(0, 2) * a(1, 0) - a(0, 0) * a(1, 2)) * inv,
+                c02 * inv, (a(0, 1) * a(2, 0) - a(0, 0) * a(2, 1)) * inv, (a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0)) * inv};
+        } else {
+            return LU<T, N>(a).inverse();
+        }
+    }
+}
+
+#endif /* MatrixSolve_h */
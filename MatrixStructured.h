@@ -0,0 +1,1043 @@
+//
+//  MatrixStructured.h
+//  Expand
+//
+
+#ifndef MatrixStructured_h
+#define MatrixStructured_h
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Matrix.h"
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // triangles
+    // --------------------------------------------------------------------
+    
+    // elements on and below the diagonal
+    struct Lower {};
+    
+    // elements on and above the diagonal
+    struct Upper {};
+    
+    template <typename T, std::size_t N>
+    class SymmetricMatrix;
+    
+    template <typename T, std::size_t N, typename U = Lower>
+    class TriangularMatrix;
+    
+    template <typename T, std::size_t N>
+    class DiagonalMatrix;
+    
+    // --------------------------------------------------------------------
+    // storage
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Elements of a square matrix of size \c N stored by a structured
+     * matrix, a triangle of N * (N + 1) / 2 elements packed row by row when
+     * \c Triangle and the N diagonal elements otherwise, zero-initialized.
+     *
+     * Like Matrix, fixed sizes hold their elements and Dynamic ones
+     * allocate them on the heap.
+     *
+     */
+    template <typename T, std::size_t N, bool Triangle>
+    class StructuredMemory {
+        
+    protected:
+        
+        static constexpr std::size_t stored = Triangle ? N * (N + 1) / 2 : N;
+        
+        T _elements[stored > 0 ? stored : 1];
+        
+    public:
+        
+        constexpr StructuredMemory() : _elements() {}
+        
+        explicit constexpr StructuredMemory(std::size_t const&) : _elements() {}
+        
+        constexpr std::size_t rows() const {
+            return N;
+        }
+        
+        constexpr std::size_t cols() const {
+            return N;
+        }
+        
+        constexpr std::size_t size() const {
+            return N * N;
+        }
+        
+        // number of stored elements
+        constexpr std::size_t storedSize() const {
+            return stored;
+        }
+        
+        T* data() {
+            return _elements;
+        }
+        
+        const T* data() const {
+            return _elements;
+        }
+    };
+    
+    template <typename T, bool Triangle>
+    class StructuredMemory<T, Dynamic, Triangle> {
+        
+    protected:
+        
+        std::size_t _n;
+        std::vector<T> _elements;
+        
+    public:
+        
+        StructuredMemory() : _n(0) {}
+        
+        explicit StructuredMemory(std::size_t const& n) : _n(n), _elements(Triangle ? n * (n + 1) / 2 : n, T(0)) {}
+        
+        std::size_t rows() const {
+            return _n;
+        }
+        
+        std::size_t cols() const {
+            return _n;
+        }
+        
+        std::size_t size() const {
+            return _n * _n;
+        }
+        
+        std::size_t storedSize() const {
+            return _elements.size();
+        }
+        
+        T* data() {
+            return _elements.data();
+        }
+        
+        const T* data() const {
+            return _elements.data();
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // iterator
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Random-access iterator over the elements of a structured matrix \c E
+     * in row-major order, as those of a Matrix, elements which are not
+     * stored reading as their mirror or as 0. Elements are returned by
+     * value, and are changed through operator()(i, j).
+     *
+     */
+    template <typename E>
+    class StructuredIter {
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // STL-compatible type definitions
+        // --------------------------------------------------------------------
+        
+        typedef typename E::value_type          value_type;
+        typedef value_type                      reference;
+        typedef void                            pointer;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef std::random_access_iterator_tag iterator_category;
+        
+    private:
+        
+        E const* _matrix;
+        
+        // row-major index of the current element
+        difference_type _k;
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        StructuredIter() : _matrix(nullptr), _k(0) {}
+        
+        // first element of \c mat, or one past its last element for \c end
+        StructuredIter(E const& mat, bool const& end = false)
+            : _matrix(&mat), _k(end ? difference_type(mat.size()) : 0) {}
+        
+        // --------------------------------------------------------------------
+        // access
+        // --------------------------------------------------------------------
+        
+        value_type operator*() const {
+            return (*_matrix)[std::size_t(_k)];
+        }
+        
+        value_type operator[](difference_type const& i) const {
+            return (*_matrix)[std::size_t(_k + i)];
+        }
+        
+        // --------------------------------------------------------------------
+        // moves
+        // --------------------------------------------------------------------
+        
+        StructuredIter<E>& operator++() {
+            ++_k;
+            return *this;
+        }
+        
+        StructuredIter<E> operator++(int) {
+            StructuredIter<E> ret(*this);
+            ++_k;
+            return ret;
+        }
+        
+        StructuredIter<E>& operator--() {
+            --_k;
+            return *this;
+        }
+        
+        StructuredIter<E> operator--(int) {
+            StructuredIter<E> ret(*this);
+            --_k;
+            return ret;
+        }
+        
+        StructuredIter<E>& operator+=(difference_type const& n) {
+            _k += n;
+            return *this;
+        }
+        
+        StructuredIter<E>& operator-=(difference_type const& n) {
+            _k -= n;
+            return *this;
+        }
+        
+        StructuredIter<E> operator+(difference_type const& n) const {
+            StructuredIter<E> ret(*this);
+            return ret += n;
+        }
+        
+        friend StructuredIter<E> operator+(difference_type const& n, StructuredIter<E> const& it) {
+            return it + n;
+        }
+        
+        StructuredIter<E> operator-(difference_type const& n) const {
+            StructuredIter<E> ret(*this);
+            return ret -= n;
+        }
+        
+        difference_type operator-(StructuredIter<E> const& other) const {
+            return _k - other._k;
+        }
+        
+        void swap(StructuredIter<E>& rhs) {
+            std::swap(*this, rhs);
+        }
+        
+        // --------------------------------------------------------------------
+        // comparisons
+        // --------------------------------------------------------------------
+        
+        bool operator==(StructuredIter<E> const& other) const {
+            return _matrix == other._matrix && _k == other._k;
+        }
+        
+        bool operator!=(StructuredIter<E> const& other) const {
+            return !(*this == other);
+        }
+        
+        bool operator<(StructuredIter<E> const& other) const {
+            return _k < other._k;
+        }
+        
+        bool operator>(StructuredIter<E> const& other) const {
+            return other < *this;
+        }
+        
+        bool operator<=(StructuredIter<E> const& other) const {
+            return !(other < *this);
+        }
+        
+        bool operator>=(StructuredIter<E> const& other) const {
+            return !(*this < other);
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // kernels
+    // --------------------------------------------------------------------
+    
+    // sum of the products of the \c n contiguous elements at \c a and \c x,
+    // the elements left over by packets of \c W bytes being processed by
+    // packets half as wide, down to single elements; bounding the loop by the
+    // last whole packet keeps GCC from seeing reads past the unrolled rows
+    template <typename T, std::size_t W = EXPAND_SIMD_BYTES>
+    inline T packedDot(const T* a, const T* x, std::size_t const& n) {
+        typedef Packet<T, W> P;
+        typename P::type acc = P::set1(T(0));
+        std::size_t const m = n - n % P::size;
+        std::size_t k(0);
+        for (; k < m; k += P::size) {
+            acc = P::fma(P::load(a + k), P::load(x + k), acc);
+        }
+        if constexpr (P::size > 1) {
+            return P::sum(acc) + packedDot<T, W / 2>(a + k, x + k, n - k);
+        } else {
+            return acc;
+        }
+    }
+    
+    // adds \c s times the \c n contiguous elements at \c a to those at \c y,
+    // processing the leftover elements as \c packedDot
+    template <typename T, std::size_t W = EXPAND_SIMD_BYTES>
+    inline void packedAxpy(T* y, T const& s, const T* a, std::size_t const& n) {
+        typedef Packet<T, W> P;
+        typename P::type const ps = P::set1(s);
+        std::size_t const m = n - n % P::size;
+        std::size_t k(0);
+        for (; k < m; k += P::size) {
+            P::store(y + k, P::fma(ps, P::load(a + k), P::load(y + k)));
+        }
+        if constexpr (P::size > 1) {
+            packedAxpy<T, W / 2>(y + k, s, a + k, n - k);
+        }
+    }
+    
+    // position of the first element of packed row \c i of a triangle of
+    // size \c n, and number of elements of the row
+    template <typename U>
+    constexpr std::size_t packedRow(std::size_t const& i, std::size_t const& n) {
+        return std::is_same<U, Lower>::value ? i * (i + 1) / 2 : i * (2 * n - i + 1) / 2;
+    }
+    
+    template <typename U>
+    constexpr std::size_t packedLength(std::size_t const& i, std::size_t const& n) {
+        return std::is_same<U, Lower>::value ? i + 1 : n - i;
+    }
+    
+    /**
+     *
+     * Evaluates the product of the packed triangle \c a, of size \c n, by
+     * the contiguous vector at \c x into memory at \c y, consecutive
+     * elements being \c step apart, combining it with the current content
+     * through \c Op. Each row is a dot product over its stored elements;
+     * from \c EXPAND_PARALLEL_THRESHOLD stored elements on, rows are dealt
+     * to the thread pool.
+     *
+     */
+    template <typename Op, typename U, typename T, typename V>
+    void trmv(V* y, std::size_t const& step, const T* a, std::size_t const& n, const T* x) {
+        auto rows = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i(begin); i < end; i++) {
+                std::size_t const first = std::is_same<U, Lower>::value ? 0 : i;
+                T const sum = packedDot(a + packedRow<U>(i, n), x + first, packedLength<U>(i, n));
+                y[i * step] = Op::apply(y[i * step], static_cast<V>(sum));
+            }
+        };
+        if (n * (n + 1) / 2 >= EXPAND_PARALLEL_THRESHOLD) {
+            parallelFor(n, parallelGrain<T>(n * n, n) / n, rows);
+        } else {
+            rows(0, n);
+        }
+    }
+    
+    // adds the products of the \c R packed rows of a symmetric matrix
+    // starting with row \c i, of which the lower triangle is packed at \c a,
+    // by \c x to \c sum, every element being read once for both of its
+    // positions: as part of a row, through a dot product, and of a column,
+    // through an update of the previous elements of \c sum
+    template <std::size_t R, typename T>
+    void symvRows(const T* a, const T* x, T* sum, std::size_t const& i) {
+        typedef Packet<T> P;
+        const T* row[R];
+        typename P::type acc[R];
+        typename P::type xr[R];
+        T dot[R];
+        for (std::size_t r(0); r < R; r++) {
+            row[r] = a + (i + r) * (i + r + 1) / 2;
+            acc[r] = P::set1(T(0));
+            xr[r] = P::set1(x[i + r]);
+            dot[r] = T(0);
+        }
+        std::size_t k(0);
+        for (; k + P::size <= i; k += P::size) {
+            typename P::type const xk = P::load(x + k);
+            typename P::type yk = P::load(sum + k);
+#pragma GCC unroll 4
+            for (std::size_t r(0); r < R; r++) {
+                typename P::type const ak = P::load(row[r] + k);
+                acc[r] = P::fma(ak, xk, acc[r]);
+                yk = P::fma(xr[r], ak, yk);
+            }
+            P::store(sum + k, yk);
+        }
+        for (; k < i; k++) {
+            T const xk = x[k];
+            T sk = sum[k];
+            for (std::size_t r(0); r < R; r++) {
+                T const ak = row[r][k];
+                dot[r] += ak * xk;
+                sk += ak * x[i + r];
+            }
+            sum[k] = sk;
+        }
+        for (std::size_t r(0); r < R; r++) {
+            for (std::size_t c(0); c < r; c++) {
+                T const ac = row[r][i + c];
+                dot[r] += ac * x[i + c];
+                dot[c] += ac * x[i + r];
+            }
+        }
+        for (std::size_t r(0); r < R; r++) {
+            sum[i + r] += P::sum(acc[r]) + dot[r] + row[r][i + r] * x[i + r];
+        }
+    }
+    
+    /**
+     *
+     * Evaluates the product of the symmetric matrix whose lower triangle is
+     * packed at \c a, of size \c n, by the contiguous vector at \c x into
+     * memory at \c y, consecutive elements being \c step apart, combining
+     * it with the current content through \c Op.
+     *
+     * Each stored row is read once, both as a row, through a dot product,
+     * and as a column, through an update of the previous elements, four
+     * rows at a time, the product being accumulated in \c sum, of \c n
+     * elements, before it is combined with \c y.
+     *
+     */
+    template <typename Op, typename T, typename V>
+    void symv(V* y, std::size_t const& step, const T* a, std::size_t const& n, const T* x, T* sum) {
+        std::fill(sum, sum + n, T(0));
+        std::size_t i(0);
+        for (; i + 4 <= n; i += 4) {
+            symvRows<4>(a, x, sum, i);
+        }
+        for (; i < n; i++) {
+            symvRows<1>(a, x, sum, i);
+        }
+        for (std::size_t i(0); i < n; i++) {
+            y[i * step] = Op::apply(y[i * step], static_cast<V>(sum[i]));
+        }
+    }
+    
+    // --------------------------------------------------------------------
+    // expression nodes
+    // --------------------------------------------------------------------
+    
+    // vector operand of the products of structured matrices: a reference to
+    // it when its elements are contiguous, its evaluation otherwise
+    template <typename T, std::size_t N, typename T2>
+    using StructuredOperand = typename std::conditional<IsContiguousVector<T2, T>::value,
+        T2 const&, Vector<T, N, 0>>::type;
+    
+    /**
+     *
+     * Product of a packed triangular matrix by a vector (TRMV), evaluated
+     * one element at a time, each one being the dot product of the stored
+     * part of a row, so that it takes part in larger expressions without
+     * temporaries.
+     *
+     * Assigned on its own it runs \c trmv, first copying the operand when it
+     * is the destination. Within larger expressions the destination must
+     * differ from the operand.
+     *
+     */
+    template <typename T, std::size_t N, typename U, typename X>
+    struct TriangularVectorProduct {
+        
+        typedef T value_type;
+        
+        static constexpr bool vectorizable = false;
+        
+        TriangularMatrix<T, N, U> const& a;
+        X v;
+        
+        std::size_t size() const {
+            return a.rows();
+        }
+        
+        value_type operator[](std::size_t i) const {
+            std::size_t const first = std::is_same<U, Lower>::value ? 0 : i;
+            return packedDot(a.data() + packedRow<U>(i, a.rows()), v.elements() + first, packedLength<U>(i, a.rows()));
+        }
+        
+        template <typename Op, typename V>
+        void evaluateTo(V* dst, std::size_t step, std::size_t) const {
+            if (static_cast<const void*>(v.elements()) == static_cast<const void*>(dst)) {
+                Vector<T, N, 0> const x(v);
+                trmv<Op, U>(dst, step, a.data(), a.rows(), x.elements());
+                return;
+            }
+            trmv<Op, U>(dst, step, a.data(), a.rows(), v.elements());
+        }
+    };
+    
+    /**
+     *
+     * Product of a packed symmetric matrix by a vector (SYMV). Assigned to a
+     * Vector it is evaluated by \c symv, which reads the stored triangle
+     * once; used as an operand of another expression, each element is
+     * computed from a stored row and a stored column.
+     *
+     */
+    template <typename T, std::size_t N, typename X>
+    struct SymmetricVectorProduct {
+        
+        typedef T value_type;
+        
+        static constexpr bool vectorizable = false;
+        
+        SymmetricMatrix<T, N> const& a;
+        X v;
+        
+        std::size_t size() const {
+            return a.rows();
+        }
+        
+        value_type operator[](std::size_t i) const {
+            const T* x = v.elements();
+            T sum = packedDot(a.data() + i * (i + 1) / 2, x, i + 1);
+            for (std::size_t k(i + 1); k < a.rows(); k++) {
+                sum += a.data()[k * (k + 1) / 2 + i] * x[k];
+            }
+            return sum;
+        }
+        
+        // the product is accumulated apart, so that the destination may be
+        // the operand
+        template <typename Op, typename V>
+        void evaluateTo(V* dst, std::size_t step, std::size_t) const {
+            if constexpr (N == Dynamic) {
+                VectorX<T> sum(a.rows());
+                symv<Op>(dst, step, a.data(), a.rows(), v.elements(), sum.elements());
+            } else {
+                Vector<T, N> sum;
+                symv<Op>(dst, step, a.data(), a.rows(), v.elements(), sum.elements());
+            }
+        }
+    };
+    
+    // product of a diagonal matrix by a vector expression, element by
+    // element and packet by packet
+    template <typename T, std::size_t N, typename T2>
+    struct DiagonalVectorProduct {
+        
+        typedef decltype(std::declval<T>() * std::declval<T2>()[0]) value_type;
+        
+        static constexpr bool vectorizable = T2::vectorizable && std::is_same<typename T2::value_type, T>::value;
+        
+        DiagonalMatrix<T, N> const& d;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return d.rows();
+        }
+        
+        value_type operator[](std::size_t i) const {
+            return d.data()[i] * element(v, i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i) const {
+            return P::load(d.data() + i) * v.template packet<P>(i);
+        }
+    };
+    
+    /**
+     *
+     * Product of a diagonal matrix by a matrix expression, scaling its rows,
+     * or, when \c Right, of a matrix expression by a diagonal matrix,
+     * scaling its columns. Both are evaluated row by row, packet by packet.
+     *
+     */
+    template <typename T, std::size_t N, typename T2, bool Right>
+    struct DiagonalMatrixProduct {
+        
+        typedef decltype(std::declval<T>() * std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr bool vectorizable = T2::vectorizable && std::is_same<typename T2::value_type, T>::value;
+        
+        DiagonalMatrix<T, N> const& d;
+        T2 const& u;
+        
+        std::size_t rows() const {
+            return u.rows();
+        }
+        
+        std::size_t cols() const {
+            return u.cols();
+        }
+        
+        std::size_t size() const {
+            return u.rows() * u.cols();
+        }
+        
+        value_type operator()(std::size_t i, std::size_t j) const {
+            return d.data()[Right ? j : i] * element(u, i, j);
+        }
+        
+        value_type operator[](std::size_t i) const {
+            return (*this)(i / cols(), i % cols());
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i, std::size_t j) const {
+            if constexpr (Right) {
+                return u.template packet<P>(i, j) * P::load(d.data() + j);
+            } else {
+                return P::set1(d.data()[i]) * u.template packet<P>(i, j);
+            }
+        }
+    };
+    
+    template <typename T, std::size_t N, typename U, typename X>
+    struct IsVectorExpression<TriangularVectorProduct<T, N, U, X>> : std::true_type {};
+    
+    template <typename T, std::size_t N, typename U, typename X>
+    struct HasEvaluateTo<TriangularVectorProduct<T, N, U, X>> : std::true_type {};
+    
+    template <typename T, std::size_t N, typename U, typename X>
+    struct VectorShape<TriangularVectorProduct<T, N, U, X>> {
+        static constexpr std::size_t size = N;
+    };
+    
+    template <typename T, std::size_t N, typename X>
+    struct IsVectorExpression<SymmetricVectorProduct<T, N, X>> : std::true_type {};
+    
+    template <typename T, std::size_t N, typename X>
+    struct HasEvaluateTo<SymmetricVectorProduct<T, N, X>> : std::true_type {};
+    
+    template <typename T, std::size_t N, typename X>
+    struct VectorShape<SymmetricVectorProduct<T, N, X>> {
+        static constexpr std::size_t size = N;
+    };
+    
+    template <typename T, std::size_t N, typename T2>
+    struct IsVectorExpression<DiagonalVectorProduct<T, N, T2>> : std::true_type {};
+    
+    template <typename T, std::size_t N, typename T2>
+    struct VectorShape<DiagonalVectorProduct<T, N, T2>> {
+        static constexpr std::size_t size = N;
+    };
+    
+    template <typename T, std::size_t N, typename T2, bool Right>
+    struct IsMatrixExpression<DiagonalMatrixProduct<T, N, T2, Right>> : std::true_type {};
+    
+    template <typename T, std::size_t N, typename T2, bool Right>
+    struct MatrixShape<DiagonalMatrixProduct<T, N, T2, Right>> : MatrixShape<T2> {};
+    
+    // the diagonal is read by index, never over the padding of the operand
+    template <typename T, std::size_t N, typename T2, bool Right>
+    struct MatrixLayout<DiagonalMatrixProduct<T, N, T2, Right>> {
+        typedef void type;
+    };
+    
+    // --------------------------------------------------------------------
+    // structured matrices
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Symmetric matrix of size \c N storing its lower triangle, packed row by
+     * row, element (i, j) and (j, i) being the same stored element.
+     *
+     * Structured matrices are matrix expressions: they are assigned to, added
+     * to and multiplied by dense matrices, and read through operator()(i, j)
+     * and iterators like them. Their products by vectors only read the
+     * stored elements.
+     *
+     */
+    template <typename T, std::size_t N>
+    class SymmetricMatrix : public StructuredMemory<T, N, true> {
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // type definitions
+        // --------------------------------------------------------------------
+        
+        typedef T                                     value_type;
+        typedef StructuredIter<SymmetricMatrix<T, N>> iterator;
+        typedef StructuredIter<SymmetricMatrix<T, N>> const_iterator;
+        typedef std::size_t                           size_type;
+        
+        static constexpr bool vectorizable = false;
+        
+        using StructuredMemory<T, N, true>::rows;
+        using StructuredMemory<T, N, true>::cols;
+        using StructuredMemory<T, N, true>::size;
+        using StructuredMemory<T, N, true>::data;
+        
+    private:
+        
+        static constexpr std::size_t index(std::size_t const& i, std::size_t const& j) {
+            return i >= j ? i * (i + 1) / 2 + j : j * (j + 1) / 2 + i;
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // zero matrix
+        SymmetricMatrix() {}
+        
+        // dynamic zero matrix of size \c n
+        template <std::size_t D = N, typename std::enable_if<D == Dynamic, int>::type = 0>
+        explicit SymmetricMatrix(size_type const& n) : StructuredMemory<T, N, true>(n) {}
+        
+        // lower triangle of a square matrix expression, assumed symmetric
+        template <typename E, EnableIfMatrixExpression<E> = 0>
+        explicit SymmetricMatrix(E const& e) : StructuredMemory<T, N, true>(e.rows()) {
+            static_assert(SquareShape<E>::size == N || SquareShape<E>::size == Dynamic || N == Dynamic,
+                          "Matrix dimensions must agree");
+            ASSERT(e.rows() == e.cols() && (N == Dynamic || e.rows() == N), "Matrix dimensions must agree");
+            for (std::size_t i(0); i < rows(); i++) {
+                for (std::size_t j(0); j <= i; j++) {
+                    data()[index(i, j)] = static_cast<T>(element(e, i, j));
+                }
+            }
+        }
+        
+        // --------------------------------------------------------------------
+        // access
+        // --------------------------------------------------------------------
+        
+        T operator()(size_type const& i, size_type const& j) const {
+            ASSERT(i < rows() && j < cols(), "Index (" << i << ", " << j << ") out of bounds in SymmetricMatrix of size " << rows());
+            return data()[index(i, j)];
+        }
+        
+        T& operator()(size_type const& i, size_type const& j) {
+            ASSERT(i < rows() && j < cols(), "Index (" << i << ", " << j << ") out of bounds in SymmetricMatrix of size " << rows());
+            return data()[index(i, j)];
+        }
+        
+        // element at row-major index \c k
+        T operator[](size_type const& k) const {
+            return (*this)(k / cols(), k % cols());
+        }
+        
+        const_iterator begin() const {
+            return const_iterator(*this);
+        }
+        
+        const_iterator end() const {
+            return const_iterator(*this, true);
+        }
+        
+        const_iterator cbegin() const {
+            return begin();
+        }
+        
+        const_iterator cend() const {
+            return end();
+        }
+    };
+    
+    /**
+     *
+     * Triangular matrix of size \c N storing its \c U triangle, Lower or
+     * Upper, packed row by row, the other elements being 0.
+     *
+     */
+    template <typename T, std::size_t N, typename U>
+    class TriangularMatrix : public StructuredMemory<T, N, true> {
+        
+        static_assert(std::is_same<U, Lower>::value || std::is_same<U, Upper>::value, "Triangular matrices store their Lower or Upper triangle");
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // type definitions
+        // --------------------------------------------------------------------
+        
+        typedef T                                         value_type;
+        typedef U                                         triangle;
+        typedef StructuredIter<TriangularMatrix<T, N, U>> iterator;
+        typedef StructuredIter<TriangularMatrix<T, N, U>> const_iterator;
+        typedef std::size_t                               size_type;
+        
+        static constexpr bool vectorizable = false;
+        
+        using StructuredMemory<T, N, true>::rows;
+        using StructuredMemory<T, N, true>::cols;
+        using StructuredMemory<T, N, true>::size;
+        using StructuredMemory<T, N, true>::data;
+        
+        // true for the elements lying in the stored triangle
+        static constexpr bool stores(size_type const& i, size_type const& j) {
+            return std::is_same<U, Lower>::value ? j <= i : i <= j;
+        }
+        
+    private:
+        
+        std::size_t index(std::size_t const& i, std::size_t const& j) const {
+            return packedRow<U>(i, rows()) + j - (std::is_same<U, Lower>::value ? 0 : i);
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // zero matrix
+        TriangularMatrix() {}
+        
+        // dynamic zero matrix of size \c n
+        template <std::size_t D = N, typename std::enable_if<D == Dynamic, int>::type = 0>
+        explicit TriangularMatrix(size_type const& n) : StructuredMemory<T, N, true>(n) {}
+        
+        // \c U triangle of a square matrix expression
+        template <typename E, EnableIfMatrixExpression<E> = 0>
+        explicit TriangularMatrix(E const& e) : StructuredMemory<T, N, true>(e.rows()) {
+            static_assert(SquareShape<E>::size == N || SquareShape<E>::size == Dynamic || N == Dynamic,
+                          "Matrix dimensions must agree");
+            ASSERT(e.rows() == e.cols() && (N == Dynamic || e.rows() == N), "Matrix dimensions must agree");
+            for (std::size_t i(0); i < rows(); i++) {
+                for (std::size_t j(0); j < cols(); j++) {
+                    if (stores(i, j)) {
+                        data()[index(i, j)] = static_cast<T>(element(e, i, j));
+                    }
+                }
+            }
+        }
+        
+        // --------------------------------------------------------------------
+        // access
+        // --------------------------------------------------------------------
+        
+        T operator()(size_type const& i, size_type const& j) const {
+            ASSERT(i < rows() && j < cols(), "Index (" << i << ", " << j << ") out of bounds in TriangularMatrix of size " << rows());
+            return stores(i, j) ? data()[index(i, j)] : T(0);
+        }
+        
+        // only the elements of the stored triangle can be changed
+        T& operator()(size_type const& i, size_type const& j) {
+            ASSERT(i < rows() && j < cols() && stores(i, j), "Index (" << i << ", " << j << ") out of the stored triangle of TriangularMatrix of size " << rows());
+            return data()[index(i, j)];
+        }
+        
+        T operator[](size_type const& k) const {
+            return (*this)(k / cols(), k % cols());
+        }
+        
+        const_iterator begin() const {
+            return const_iterator(*this);
+        }
+        
+        const_iterator end() const {
+            return const_iterator(*this, true);
+        }
+        
+        const_iterator cbegin() const {
+            return begin();
+        }
+        
+        const_iterator cend() const {
+            return end();
+        }
+    };
+    
+    /**
+     *
+     * Diagonal matrix of size \c N storing its diagonal, which diagonal()
+     * views as a Vector, the other elements being 0.
+     *
+     */
+    template <typename T, std::size_t N>
+    class DiagonalMatrix : public StructuredMemory<T, N, false> {
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // type definitions
+        // --------------------------------------------------------------------
+        
+        typedef T                                    value_type;
+        typedef StructuredIter<DiagonalMatrix<T, N>> iterator;
+        typedef StructuredIter<DiagonalMatrix<T, N>> const_iterator;
+        typedef std::size_t                          size_type;
+        
+        static constexpr bool vectorizable = false;
+        
+        using StructuredMemory<T, N, false>::rows;
+        using StructuredMemory<T, N, false>::cols;
+        using StructuredMemory<T, N, false>::size;
+        using StructuredMemory<T, N, false>::data;
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // zero matrix
+        DiagonalMatrix() {}
+        
+        // dynamic zero matrix of size \c n
+        template <std::size_t D = N, typename std::enable_if<D == Dynamic, int>::type = 0>
+        explicit DiagonalMatrix(size_type const& n) : StructuredMemory<T, N, false>(n) {}
+        
+        // matrix whose diagonal is a vector expression
+        template <typename E, EnableIfVectorExpression<E> = 0>
+        explicit DiagonalMatrix(E const& e) : StructuredMemory<T, N, false>(e.size()) {
+            static_assert(VectorShape<E>::size == N || VectorShape<E>::size == Dynamic || N == Dynamic,
+                          "Vector dimensions must agree");
+            ASSERT(N == Dynamic || e.size() == N, "Vector dimensions must agree");
+            for (std::size_t i(0); i < rows(); i++) {
+                data()[i] = static_cast<T>(element(e, i));
+            }
+        }
+        
+        // --------------------------------------------------------------------
+        // access
+        // --------------------------------------------------------------------
+        
+        T operator()(size_type const& i, size_type const& j) const {
+            ASSERT(i < rows() && j < cols(), "Index (" << i << ", " << j << ") out of bounds in DiagonalMatrix of size " << rows());
+            return i == j ? data()[i] : T(0);
+        }
+        
+        // only the diagonal elements can be changed
+        T& operator()(size_type const& i, size_type const& j) {
+            ASSERT(i < rows() && i == j, "Index (" << i << ", " << j << ") off the diagonal of DiagonalMatrix of size " << rows());
+            return data()[i];
+        }
+        
+        T operator[](size_type const& k) const {
+            return (*this)(k / cols(), k % cols());
+        }
+        
+        Vector<T, N, 1> diagonal() {
+            return Vector<T, N, 1>(data(), rows());
+        }
+        
+        const_iterator begin() const {
+            return const_iterator(*this);
+        }
+        
+        const_iterator end() const {
+            return const_iterator(*this, true);
+        }
+        
+        const_iterator cbegin() const {
+            return begin();
+        }
+        
+        const_iterator cend() const {
+            return end();
+        }
+    };
+    
+    template <typename T, std::size_t N>
+    struct IsMatrixExpression<SymmetricMatrix<T, N>> : std::true_type {};
+    
+    template <typename T, std::size_t N, typename U>
+    struct IsMatrixExpression<TriangularMatrix<T, N, U>> : std::true_type {};
+    
+    template <typename T, std::size_t N>
+    struct IsMatrixExpression<DiagonalMatrix<T, N>> : std::true_type {};
+    
+    template <typename T, std::size_t N>
+    struct MatrixShape<SymmetricMatrix<T, N>> {
+        static constexpr std::size_t rows = N;
+        static constexpr std::size_t cols = N;
+    };
+    
+    template <typename T, std::size_t N, typename U>
+    struct MatrixShape<TriangularMatrix<T, N, U>> : MatrixShape<SymmetricMatrix<T, N>> {};
+    
+    template <typename T, std::size_t N>
+    struct MatrixShape<DiagonalMatrix<T, N>> : MatrixShape<SymmetricMatrix<T, N>> {};
+    
+    // the direct index of a structured matrix runs over all its elements,
+    // which are not all stored
+    template <typename T, std::size_t N>
+    struct MatrixLayout<SymmetricMatrix<T, N>> {
+        typedef void type;
+    };
+    
+    template <typename T, std::size_t N, typename U>
+    struct MatrixLayout<TriangularMatrix<T, N, U>> {
+        typedef void type;
+    };
+    
+    template <typename T, std::size_t N>
+    struct MatrixLayout<DiagonalMatrix<T, N>> {
+        typedef void type;
+    };
+    
+    // --------------------------------------------------------------------
+    // operators
+    // --------------------------------------------------------------------
+    
+    template <typename T, std::size_t N, typename T2, EnableIfVectorExpression<T2> = 0>
+    auto operator*(SymmetricMatrix<T, N> const& a, T2 const& v) {
+        static_assert(VectorShapes<Vector<T, N>, T2>::agree, "Matrix and Vector dimensions must agree");
+        ASSERT(a.cols() == v.size(), "Matrix and Vector dimensions must agree");
+        return SymmetricVectorProduct<T, N, StructuredOperand<T, N, T2>>{a, v};
+    }
+    
+    template <typename T, std::size_t N, typename U, typename T2, EnableIfVectorExpression<T2> = 0>
+    auto operator*(TriangularMatrix<T, N, U> const& a, T2 const& v) {
+        static_assert(VectorShapes<Vector<T, N>, T2>::agree, "Matrix and Vector dimensions must agree");
+        ASSERT(a.cols() == v.size(), "Matrix and Vector dimensions must agree");
+        return TriangularVectorProduct<T, N, U, StructuredOperand<T, N, T2>>{a, v};
+    }
+    
+    template <typename T, std::size_t N, typename T2, EnableIfVectorExpression<T2> = 0>
+    auto operator*(DiagonalMatrix<T, N> const& d, T2 const& v) {
+        static_assert(VectorShapes<Vector<T, N>, T2>::agree, "Matrix and Vector dimensions must agree");
+        ASSERT(d.cols() == v.size(), "Matrix and Vector dimensions must agree");
+        return DiagonalVectorProduct<T, N, T2>{d, v};
+    }
+    
+    // scaling of the rows of a matrix expression
+    template <typename T, std::size_t N, typename T2, EnableIfMatrixExpression<T2> = 0>
+    auto operator*(DiagonalMatrix<T, N> const& d, T2 const& u) {
+        static_assert(MatrixShape<T2>::rows == N || MatrixShape<T2>::rows == Dynamic || N == Dynamic,
+                      "Matrix dimensions must agree");
+        ASSERT(d.cols() == u.rows(), "Matrix dimensions must agree");
+        return DiagonalMatrixProduct<T, N, T2, false>{d, u};
+    }
+    
+    // scaling of the columns of a matrix expression
+    template <typename T1, typename T, std::size_t N, EnableIfMatrixExpression<T1> = 0>
+    auto operator*(T1 const& u, DiagonalMatrix<T, N> const& d) {
+        static_assert(MatrixShape<T1>::cols == N || MatrixShape<T1>::cols == Dynamic || N == Dynamic,
+                      "Matrix dimensions must agree");
+        ASSERT(u.cols() == d.rows(), "Matrix dimensions must agree");
+        return DiagonalMatrixProduct<T, N, T1, true>{d, u};
+    }
+    
+    // products of diagonal matrices are diagonal, and evaluated right away
+    template <typename T, std::size_t N>
+    DiagonalMatrix<T, N> operator*(DiagonalMatrix<T, N> const& d, DiagonalMatrix<T, N> const& e) {
+        ASSERT(d.cols() == e.rows(), "Matrix dimensions must agree");
+        DiagonalMatrix<T, N> r(d);
+        for (std::size_t i(0); i < r.rows(); i++) {
+            r.data()[i] *= e.data()[i];
+        }
+        return r;
+    }
+}
+
+EXPAND_PSABI_END
+
+#endif /* MatrixStructured_h */
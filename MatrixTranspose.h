@@ -0,0 +1,344 @@
+//
+//  MatrixTranspose.h
+//  Expand
+//
+
+#ifndef MatrixTranspose_h
+#define MatrixTranspose_h
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "MatrixOps.h"
+#include "ThreadPool.h"
+#include "VectorEval.h"
+
+// side in elements of the blocks transposed in cache, the recursion of the
+// transposition stopping there
+#ifndef EXPAND_TRANSPOSE_BLOCK
+#   define EXPAND_TRANSPOSE_BLOCK 64
+#endif
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // kernels
+    // --------------------------------------------------------------------
+    
+    // side of the blocks transposed in cache, a whole number of packets
+    template <typename T>
+    constexpr std::size_t transposeBlock() {
+        return std::max<std::size_t>(EXPAND_TRANSPOSE_BLOCK / Packet<T>::size, 1) * Packet<T>::size;
+    }
+    
+    // transposes the packet-sized square tile at \c src into \c dst in
+    // registers, combining it with the current content through \c Op
+    template <typename Op, typename T>
+    inline void transposeTile(T* dst, std::size_t ldd, const T* src, std::size_t lds) {
+        typedef Packet<T> P;
+        typename P::type r[P::size];
+#pragma GCC unroll 64
+        for (std::size_t k(0); k < P::size; k++) {
+            r[k] = P::load(src + k * lds);
+        }
+        P::transpose(r);
+#pragma GCC unroll 64
+        for (std::size_t k(0); k < P::size; k++) {
+            P::store(dst + k * ldd, Op::apply(P::load(dst + k * ldd), r[k]));
+        }
+    }
+    
+    /**
+     *
+     * Transposes the \c m x \c n matrix at \c src, rows being \c lds
+     * elements apart, into the \c n x \c m matrix at \c dst, rows being
+     * \c ldd elements apart, combining it with the current content through
+     * \c Op.
+     *
+     * The larger dimension is halved until the blocks fit in cache, whatever
+     * its size, and blocks are transposed a packet-sized tile at a time in
+     * registers, so that both matrices are walked along whole cache lines
+     * and pages.
+     *
+     */
+    template <typename Op, typename T>
+    void transposeRange(T* dst, std::size_t ldd, const T* src, std::size_t lds, std::size_t m, std::size_t n) {
+        typedef Packet<T> P;
+        constexpr std::size_t B = P::size;
+        constexpr std::size_t L = transposeBlock<T>();
+        if (m > L || n > L) {
+            if (m >= n) {
+                std::size_t const h = (m / 2 + B - 1) / B * B;
+                transposeRange<Op>(dst, ldd, src, lds, h, n);
+                transposeRange<Op>(dst + h, ldd, src + h * lds, lds, m - h, n);
+            } else {
+                std::size_t const h = (n / 2 + B - 1) / B * B;
+                transposeRange<Op>(dst, ldd, src, lds, m, h);
+                transposeRange<Op>(dst + h * ldd, ldd, src + h, lds, m, n - h);
+            }
+            return;
+        }
+        std::size_t const mt = m / B * B;
+        std::size_t const nt = n / B * B;
+        if (reinterpret_cast<std::uintptr_t>(dst) % 64 == 0 && ldd * sizeof(T) % 64 == 0) {
+            for (std::size_t j(0); j < nt; j += B) {
+                for (std::size_t i(0); i < mt; i += B) {
+                    transposeTile<Op>(dst + j * ldd + i, ldd, src + i * lds + j, lds);
+                }
+            }
+        } else {
+            // the packets of tiles stored straight into rows not starting on
+            // a cache line would straddle two lines each, so the tiles are
+            // gathered in cache and their rows copied whole
+            alignas(64) T block[L * L];
+            for (std::size_t j(0); j < nt; j += B) {
+                for (std::size_t i(0); i < mt; i += B) {
+                    transposeTile<Assign>(block + j * L + i, L, src + i * lds + j, lds);
+                }
+            }
+            for (std::size_t j(0); j < nt; j++) {
+                for (std::size_t i(0); i < mt; i += B) {
+                    T* d = dst + j * ldd + i;
+                    P::store(d, Op::apply(P::load(d), P::load(block + j * L + i)));
+                }
+            }
+        }
+        for (std::size_t j(0); j < n; j++) {
+            for (std::size_t i(j < nt ? mt : 0); i < m; i++) {
+                dst[j * ldd + i] = Op::apply(dst[j * ldd + i], src[i * lds + j]);
+            }
+        }
+    }
+    
+    /**
+     *
+     * Transposes the \c m x \c n matrix at \c src into the \c n x \c m
+     * matrix at \c dst, which must not overlap, from
+     * \c EXPAND_PARALLEL_THRESHOLD elements on by several threads, each
+     * writing its own rows of \c dst.
+     *
+     */
+    template <typename Op, typename T>
+    void transposeTo(T* dst, std::size_t ldd, const T* src, std::size_t lds, std::size_t m, std::size_t n) {
+        if (m * n >= EXPAND_PARALLEL_THRESHOLD) {
+            parallelFor(n, parallelGrain<T>(m * n, transposeBlock<T>() * m) / m, [&](std::size_t begin, std::size_t end) {
+                transposeRange<Op>(dst + begin * ldd, ldd, src + begin, lds, m, end - begin);
+            });
+        } else {
+            transposeRange<Op>(dst, ldd, src, lds, m, n);
+        }
+    }
+    
+    // swaps the \c m x \c n block at \c a with the transpose of the \c n x
+    // \c m block at \c b, both of at most transposeBlock() rows and columns
+    template <typename T>
+    void transposeSwap(T* a, T* b, std::size_t ld, std::size_t m, std::size_t n) {
+        typedef Packet<T> P;
+        constexpr std::size_t B = P::size;
+        std::size_t const mt = m / B * B;
+        std::size_t const nt = n / B * B;
+        for (std::size_t i(0); i < mt; i += B) {
+            for (std::size_t j(0); j < nt; j += B) {
+                typename P::type ra[B], rb[B];
+#pragma GCC unroll 64
+                for (std::size_t k(0); k < B; k++) {
+                    ra[k] = P::load(a + (i + k) * ld + j);
+                    rb[k] = P::load(b + (j + k) * ld + i);
+                }
+                P::transpose(ra);
+                P::transpose(rb);
+#pragma GCC unroll 64
+                for (std::size_t k(0); k < B; k++) {
+                    P::store(a + (i + k) * ld + j, rb[k]);
+                    P::store(b + (j + k) * ld + i, ra[k]);
+                }
+            }
+        }
+        for (std::size_t i(0); i < m; i++) {
+            for (std::size_t j(i < mt ? nt : 0); j < n; j++) {
+                std::swap(a[i * ld + j], b[j * ld + i]);
+            }
+        }
+    }
+    
+    // transposes in place the square block at \c a, of at most
+    // transposeBlock() rows
+    template <typename T>
+    void transposeDiagonal(T* a, std::size_t ld, std::size_t n) {
+        constexpr std::size_t B = Packet<T>::size;
+        std::size_t const nt = n / B * B;
+        for (std::size_t i(0); i < nt; i += B) {
+            transposeTile<Assign>(a + i * ld + i, ld, a + i * ld + i, ld);
+            transposeSwap(a + i * ld + i + B, a + (i + B) * ld + i, ld, B, nt - i - B);
+        }
+        for (std::size_t i(0); i < n; i++) {
+            for (std::size_t j(std::max(i + 1, nt)); j < n; j++) {
+                std::swap(a[i * ld + j], a[j * ld + i]);
+            }
+        }
+    }
+    
+    /**
+     *
+     * Transposes in place the \c n x \c n matrix at \c a, rows being \c ld
+     * elements apart.
+     *
+     * The matrix is cut into blocks fitting in cache: blocks on the diagonal
+     * are transposed in place and every other one is swapped with the
+     * transpose of its mirror. The pairs of blocks are dealt to the thread
+     * pool from \c EXPAND_PARALLEL_THRESHOLD elements on.
+     *
+     */
+    template <typename T>
+    void transposeInPlace(T* a, std::size_t ld, std::size_t n) {
+        constexpr std::size_t L = transposeBlock<T>();
+        std::size_t const blocks = (n + L - 1) / L;
+        auto pairs = [&](std::size_t begin, std::size_t end) {
+            // pair p is (r, c), r <= c, pairs being numbered row by row
+            std::size_t r(0), first(0);
+            while (first + blocks - r <= begin) {
+                first += blocks - r;
+                r++;
+            }
+            for (std::size_t p(begin); p < end; p++) {
+                std::size_t const c = r + p - first;
+                std::size_t const rows = std::min(L, n - r * L);
+                std::size_t const cols = std::min(L, n - c * L);
+                if (r == c) {
+                    transposeDiagonal(a + r * L * ld + r * L, ld, rows);
+                } else {
+                    transposeSwap(a + r * L * ld + c * L, a + c * L * ld + r * L, ld, rows, cols);
+                }
+                if (c + 1 == blocks) {
+                    first += blocks - r;
+                    r++;
+                }
+            }
+        };
+        std::size_t const count = blocks * (blocks + 1) / 2;
+        if (n * n >= EXPAND_PARALLEL_THRESHOLD) {
+            parallelFor(count, parallelGrain<T>(n * n, L * L) / (L * L), pairs);
+        } else {
+            pairs(0, count);
+        }
+    }
+    
+    // --------------------------------------------------------------------
+    // expression nodes
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Transpose of a matrix expression, a view reading the operand with its
+     * indices swapped, so that products by a transpose move no data.
+     *
+     * Assigned to a Matrix, the transpose of a Matrix is evaluated by the
+     * blocked kernel, and that of any other expression after evaluating the
+     * expression. Transposing in place the Matrix being assigned to is
+     * detected, so that \c A = transpose(A) is valid.
+     *
+     */
+    template <typename T1>
+    struct MatrixTranspose {
+        
+        typedef typename T1::value_type value_type;
+        
+        static constexpr bool vectorizable = false;
+        
+        T1 const& u;
+        
+        constexpr std::size_t rows() const {
+            return u.cols();
+        }
+        
+        constexpr std::size_t cols() const {
+            return u.rows();
+        }
+        
+        constexpr std::size_t size() const {
+            return u.size();
+        }
+        
+        constexpr auto operator()(std::size_t i, std::size_t j) const {
+            return element(u, j, i);
+        }
+        
+        constexpr auto operator[](std::size_t i) const {
+            return (*this)(i / cols(), i % cols());
+        }
+        
+        // evaluates the transpose into the row-major memory at \c dst, rows
+        // being \c ld elements apart
+        template <typename Op, typename T>
+        void evaluateTo(T* dst, std::size_t ld) const {
+            // copies are made on the heap, whatever the size of the operand
+            typedef Matrix<T, Dynamic, Dynamic, Packed> Evaluated;
+            if constexpr (IsMatrixStorage<T1, T>::value) {
+                const T* src = u.data();
+                std::less<const T*> const before;
+                if (before(dst, src + u.rows() * u.stride()) && before(src, dst + rows() * ld)) {
+                    if (std::is_same<Op, Assign>::value && dst == src && ld == u.stride() && rows() == cols()) {
+                        transposeInPlace(dst, ld, rows());
+                    } else {
+                        Evaluated const copy(u);
+                        transposeTo<Op>(dst, ld, copy.data(), copy.stride(), copy.rows(), copy.cols());
+                    }
+                } else {
+                    transposeTo<Op>(dst, ld, src, u.stride(), u.rows(), u.cols());
+                }
+            } else {
+                Evaluated const copy(u);
+                transposeTo<Op>(dst, ld, copy.data(), copy.stride(), copy.rows(), copy.cols());
+            }
+        }
+    };
+    
+    template <typename T1>
+    struct IsMatrixExpression<MatrixTranspose<T1>> : std::true_type {};
+    
+    // true for the transpose of a Matrix of scalar type \c T
+    template <typename E, typename T>
+    struct IsTransposedStorage : std::false_type {};
+    
+    template <typename T1, typename T>
+    struct IsTransposedStorage<MatrixTranspose<T1>, T> : IsMatrixStorage<T1, T> {};
+    
+    template <typename T1>
+    struct HasEvaluateTo<MatrixTranspose<T1>> : std::true_type {};
+    
+    template <typename T1>
+    struct MatrixShape<MatrixTranspose<T1>> {
+        static constexpr std::size_t rows = MatrixShape<T1>::cols;
+        static constexpr std::size_t cols = MatrixShape<T1>::rows;
+    };
+    
+    // the direct index of a transpose addresses none of its operand's
+    template <typename T1>
+    struct MatrixLayout<MatrixTranspose<T1>> {
+        typedef void type;
+    };
+    
+    // --------------------------------------------------------------------
+    // operators
+    // --------------------------------------------------------------------
+    
+    template <typename T1, EnableIfMatrixExpression<T1> = 0>
+    constexpr auto transpose(T1 const& u) {
+        return MatrixTranspose<T1>{u};
+    }
+    
+    // transposing twice gives back the operand
+    template <typename T1>
+    constexpr T1 const& transpose(MatrixTranspose<T1> const& t) {
+        return t.u;
+    }
+}
+
+EXPAND_PSABI_END
+
+#endif /* MatrixTranspose_h */
@@ -0,0 +1,395 @@
+//
+//  Packet.h
+//  Expand
+//
+
+#ifndef Packet_h
+#define Packet_h
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#   include <immintrin.h>
+#elif defined(__aarch64__)
+#   include <arm_neon.h>
+#endif
+
+// kernels are compiled for several instruction sets, one of them being
+// selected at runtime, on x86-64 unless the packet width is forced
+#ifndef EXPAND_DISPATCH
+#   if defined(__x86_64__) && defined(__GNUC__) && !defined(EXPAND_SIMD_BYTES)
+#       define EXPAND_DISPATCH 1
+#   else
+#       define EXPAND_DISPATCH 0
+#   endif
+#endif
+
+// width in bytes of the SIMD registers targeted by the packet evaluation
+// path, deduced from the instruction sets enabled at compile time
+#ifndef EXPAND_SIMD_BYTES
+#   if defined(__AVX512F__)
+#       define EXPAND_SIMD_BYTES 64
+#   elif defined(__AVX__)
+#       define EXPAND_SIMD_BYTES 32
+#   elif defined(__SSE2__) || defined(__ARM_NEON)
+#       define EXPAND_SIMD_BYTES 16
+#   else
+#       define EXPAND_SIMD_BYTES 0
+#   endif
+#endif
+
+// packets wider than those enabled at compile time are only passed to and
+// returned from functions inlined into the kernels of their instruction set,
+// whose calling convention hence never matters, but every expression node
+// handing them over would warn about it otherwise: the warning is turned
+// off between these markers, around the declarations of the library only
+#if EXPAND_DISPATCH
+#   define EXPAND_PSABI_BEGIN _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wpsabi\"")
+#   define EXPAND_PSABI_END _Pragma("GCC diagnostic pop")
+#else
+#   define EXPAND_PSABI_BEGIN
+#   define EXPAND_PSABI_END
+#endif
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    // scalar types which can be packed into SIMD registers
+    template <typename T>
+    struct IsPackable : std::integral_constant<bool,
+        std::is_arithmetic<T>::value &&
+        !std::is_same<T, bool>::value &&
+        !std::is_same<T, long double>::value> {};
+    
+    // scalar type in which expressions compute the elements stored as \c T:
+    // \c T itself, or \c float for the reduced-precision storage types
+    template <typename T>
+    struct Widened {
+        typedef T type;
+    };
+    
+    // true when the kernels of packets of \c W bytes have fused multiply-add
+    // instructions for \c T: those enabled at compile time, or the FMA ones
+    // of the AVX2 and AVX-512 kernels selected at runtime
+    template <typename T, std::size_t W = EXPAND_SIMD_BYTES>
+    constexpr bool hasFusedMultiplyAdd() {
+#ifdef __FP_FAST_FMAF
+        if constexpr (std::is_same<T, float>::value) {
+            return true;
+        }
+#endif
+#ifdef __FP_FAST_FMA
+        if constexpr (std::is_same<T, double>::value) {
+            return true;
+        }
+#endif
+        return EXPAND_DISPATCH && (W == 32 || W == 64) &&
+            (std::is_same<T, float>::value || std::is_same<T, double>::value);
+    }
+    
+    // a * b + c, rounded once where the kernels of packets of \c W bytes have
+    // fused multiply-add instructions and as a product and a sum elsewhere,
+    // so that every evaluation path of an expression rounds alike
+    template <typename T, std::size_t W = EXPAND_SIMD_BYTES>
+    constexpr T fusedMultiplyAdd(T const& a, T const& b, T const& c) {
+        if constexpr (hasFusedMultiplyAdd<T, W>() && std::is_same<T, float>::value) {
+            return __builtin_fmaf(a, b, c);
+        } else if constexpr (hasFusedMultiplyAdd<T, W>()) {
+            return __builtin_fma(a, b, c);
+        } else {
+            return a * b + c;
+        }
+    }
+    
+#if EXPAND_DISPATCH
+    // a * b + c by the FMA instructions of 32 and 64 bytes, inlined into the
+    // kernels of the instruction sets providing them
+    __attribute__((target("avx,fma"))) inline __m256 multiplyAdd(__m256 const& a, __m256 const& b, __m256 const& c) {
+        return _mm256_fmadd_ps(a, b, c);
+    }
+    
+    __attribute__((target("avx,fma"))) inline __m256d multiplyAdd(__m256d const& a, __m256d const& b, __m256d const& c) {
+        return _mm256_fmadd_pd(a, b, c);
+    }
+    
+    __attribute__((target("avx512f"))) inline __m512 multiplyAdd(__m512 const& a, __m512 const& b, __m512 const& c) {
+        return _mm512_fmadd_ps(a, b, c);
+    }
+    
+    __attribute__((target("avx512f"))) inline __m512d multiplyAdd(__m512d const& a, __m512d const& b, __m512d const& c) {
+        return _mm512_fmadd_pd(a, b, c);
+    }
+#endif
+    
+    /**
+     *
+     * A \c Packet holds as many lanes of \c T as fit in \c W bytes. Lanes are
+     * combined with the usual arithmetic operators, which the compiler lowers
+     * to packed SIMD instructions.
+     *
+     * This generic version is the scalar fallback, holding a single lane.
+     *
+     */
+    template <typename T, std::size_t W = EXPAND_SIMD_BYTES,
+              bool = IsPackable<T>::value && (W >= 2 * sizeof(T))>
+    struct Packet {
+        
+        typedef T type;
+        
+        static constexpr std::size_t size = 1;
+        
+        static type load(const T* p) {
+            return *p;
+        }
+        
+        template <typename S>
+        static type load(const S* p) {
+            return static_cast<T>(*p);
+        }
+        
+        static type gather(const T* p, std::size_t const&) {
+            return *p;
+        }
+        
+        template <typename S>
+        static type gather(const S* p, std::size_t const&) {
+            return static_cast<T>(*p);
+        }
+        
+        static void store(T* p, type const& x) {
+            *p = x;
+        }
+        
+        template <typename S>
+        static void store(S* p, type const& x) {
+            *p = static_cast<S>(x);
+        }
+        
+        static type set1(T const& t) {
+            return t;
+        }
+        
+        static T sum(type const& x) {
+            return x;
+        }
+        
+        static type fma(type const& a, type const& b, type const& c) {
+            return fusedMultiplyAdd<T, W>(a, b, c);
+        }
+        
+        static void transpose(type (&)[1]) {}
+    };
+    
+    
+    /**
+     *
+     * Specialization for SIMD-capable scalar types.
+     *
+     */
+    template <typename T, std::size_t W>
+    struct Packet<T, W, true> {
+        
+        typedef T type __attribute__((vector_size(W)));
+        
+        static constexpr std::size_t size = W / sizeof(T);
+        
+        // load \c size contiguous lanes from unaligned memory
+        static type load(const T* p) {
+            type x;
+            std::memcpy(&x, p, sizeof(type));
+            return x;
+        }
+        
+        // load \c size contiguous lanes stored as the reduced-precision type
+        // \c S, widened to \c T
+        template <typename S>
+        static type load(const S* p) {
+            return S::template widen<Packet>(p);
+        }
+        
+        // load \c size lanes located \c stride elements apart
+        template <typename S>
+        static type gather(const S* p, std::size_t const& stride) {
+            type x;
+            for (std::size_t k(0); k < size; k++) {
+                x[k] = static_cast<T>(p[k * stride]);
+            }
+            return x;
+        }
+        
+        // store \c size contiguous lanes to unaligned memory
+        static void store(T* p, type const& x) {
+            std::memcpy(p, &x, sizeof(type));
+        }
+        
+        // store \c size contiguous lanes narrowed to the reduced-precision
+        // type \c S
+        template <typename S>
+        static void store(S* p, type const& x) {
+            S::template narrow<Packet>(p, x);
+        }
+        
+        // broadcast \c t to all lanes
+        static type set1(T const& t) {
+            return type{} + t;
+        }
+        
+        // horizontal sum of the lanes
+        static T sum(type const& x) {
+            T s(x[0]);
+            for (std::size_t k(1); k < size; k++) {
+                s += x[k];
+            }
+            return s;
+        }
+        
+        // a * b + c lane by lane, as \c fusedMultiplyAdd, in a single
+        // instruction where the target has one for the width of the packet
+        static type fma(type const& a, type const& b, type const& c) {
+            if constexpr (!hasFusedMultiplyAdd<T, W>()) {
+                return a * b + c;
+            }
+#if defined(__FMA__)
+            else if constexpr (std::is_same<T, float>::value && W == 16) {
+                return (type)_mm_fmadd_ps((__m128)a, (__m128)b, (__m128)c);
+            } else if constexpr (std::is_same<T, float>::value && W == 32) {
+                return (type)_mm256_fmadd_ps((__m256)a, (__m256)b, (__m256)c);
+            } else if constexpr (std::is_same<T, double>::value && W == 16) {
+                return (type)_mm_fmadd_pd((__m128d)a, (__m128d)b, (__m128d)c);
+            } else if constexpr (std::is_same<T, double>::value && W == 32) {
+                return (type)_mm256_fmadd_pd((__m256d)a, (__m256d)b, (__m256d)c);
+            }
+#endif
+#if defined(__AVX512F__)
+            else if constexpr (std::is_same<T, float>::value && W == 64) {
+                return (type)_mm512_fmadd_ps((__m512)a, (__m512)b, (__m512)c);
+            } else if constexpr (std::is_same<T, double>::value && W == 64) {
+                return (type)_mm512_fmadd_pd((__m512d)a, (__m512d)b, (__m512d)c);
+            }
+#endif
+#if EXPAND_DISPATCH
+            else if constexpr (std::is_same<T, float>::value && W == 32) {
+                return (type)multiplyAdd((__m256)a, (__m256)b, (__m256)c);
+            } else if constexpr (std::is_same<T, double>::value && W == 32) {
+                return (type)multiplyAdd((__m256d)a, (__m256d)b, (__m256d)c);
+            } else if constexpr (std::is_same<T, float>::value && W == 64) {
+                return (type)multiplyAdd((__m512)a, (__m512)b, (__m512)c);
+            } else if constexpr (std::is_same<T, double>::value && W == 64) {
+                return (type)multiplyAdd((__m512d)a, (__m512d)b, (__m512d)c);
+            }
+#endif
+#if defined(__aarch64__)
+            else if constexpr (std::is_same<T, float>::value && W == 16) {
+                return (type)vfmaq_f32((float32x4_t)c, (float32x4_t)a, (float32x4_t)b);
+            } else if constexpr (std::is_same<T, double>::value && W == 16) {
+                return (type)vfmaq_f64((float64x2_t)c, (float64x2_t)a, (float64x2_t)b);
+            }
+#endif
+            else {
+                type r;
+                for (std::size_t k(0); k < size; k++) {
+                    r[k] = fusedMultiplyAdd<T, W>(a[k], b[k], c[k]);
+                }
+                return r;
+            }
+        }
+        
+        // transposes the \c size x \c size tile whose row k is held by r[k]
+        static void transpose(type (&r)[size]) {
+            transposeStage<size / 2>(r);
+        }
+        
+    private:
+        
+        // signed integers as wide as \c T, indexing the lanes of shuffles
+        typedef typename std::conditional<sizeof(T) == 1, signed char,
+                typename std::conditional<sizeof(T) == 2, short,
+                typename std::conditional<sizeof(T) == 4, int, long long>::type>::type>::type Index;
+        
+        typedef Index mask __attribute__((vector_size(W)));
+        
+        // swaps the blocks of \c H lanes of \c a and \c b lying off their
+        // diagonal, \c a keeping its even blocks and \c b its odd ones
+        template <std::size_t H, std::size_t... J>
+        static void interleave(type& a, type& b, std::index_sequence<J...>) {
+#ifdef __clang__
+            type const lo = __builtin_shufflevector(a, b, ((J & H) ? size + J - H : J)...);
+            type const hi = __builtin_shufflevector(a, b, ((J & H) ? size + J : J + H)...);
+#else
+            type const lo = __builtin_shuffle(a, b, mask{Index((J & H) ? size + J - H : J)...});
+            type const hi = __builtin_shuffle(a, b, mask{Index((J & H) ? size + J : J + H)...});
+#endif
+            a = lo;
+            b = hi;
+        }
+        
+        // transposes the blocks of \c H x \c H lanes, then the smaller ones
+        // within them
+        template <std::size_t H>
+        static void transposeStage(type (&r)[size]) {
+            if constexpr (H > 0) {
+#pragma GCC unroll 64
+                for (std::size_t i(0); i < size; i++) {
+                    if ((i & H) == 0) {
+                        interleave<H>(r[i], r[i + H], std::make_index_sequence<size>());
+                    }
+                }
+                transposeStage<H / 2>(r);
+            }
+        }
+    };
+    
+    // lanes of the packet \c x of type \c Q converted one by one to the
+    // scalar type of \c P, which holds as many
+    template <typename P, typename Q>
+    typename P::type convert(typename Q::type const& x) {
+        static_assert(P::size == Q::size, "Packets must hold as many lanes");
+        if constexpr (P::size == 1) {
+            return static_cast<typename P::type>(x);
+        } else {
+            return __builtin_convertvector(x, typename P::type);
+        }
+    }
+    
+    // true when the kernels handling packets of \c W bytes sign-extend 8-bit
+    // integers to 32 bits by single instructions: AVX2 ones for 32 bytes and
+    // AVX-512 ones for 64, enabled at compile time or selected at runtime
+    template <std::size_t W>
+    constexpr bool hasByteExtensions() {
+#if defined(__x86_64__) || defined(__i386__)
+#   if defined(__AVX2__)
+        if (W == 32) {
+            return true;
+        }
+#   endif
+#   if defined(__AVX512F__)
+        if (W == 64) {
+            return true;
+        }
+#   endif
+        return EXPAND_DISPATCH && (W == 32 || W == 64);
+#else
+        return false;
+#endif
+    }
+    
+#if defined(__x86_64__) || defined(__i386__)
+    // the 8 or 16 bytes at \c p sign-extended, inlined into the kernels of
+    // the instruction sets providing them
+    __attribute__((target("avx2"))) inline __m256i extendBytes8(const void* p) {
+        return _mm256_cvtepi8_epi32(_mm_loadl_epi64(static_cast<__m128i const*>(p)));
+    }
+    
+    __attribute__((target("avx512f"))) inline __m512i extendBytes16(const void* p) {
+        return _mm512_maskz_cvtepi8_epi32(0xffff, _mm_loadu_si128(static_cast<__m128i const*>(p)));
+    }
+#endif
+}
+
+EXPAND_PSABI_END
+
+#endif /* Packet_h */
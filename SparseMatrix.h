@@ -0,0 +1,515 @@
+//
+//  SparseMatrix.h
+//  Expand
+//
+
+#ifndef SparseMatrix_h
+#define SparseMatrix_h
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Matrix.h"
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // storage orders
+    // --------------------------------------------------------------------
+    
+    // compressed sparse rows: the non-zeros of each row are contiguous and
+    // sorted by column
+    struct CSR {};
+    
+    // compressed sparse columns: the non-zeros of each column are
+    // contiguous and sorted by row
+    struct CSC {};
+    
+    template <typename T, typename O = CSR>
+    class SparseMatrix;
+    
+    // --------------------------------------------------------------------
+    // triplet builder
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Non-zeros of a \c rows x \c cols sparse matrix, added in any order as
+     * (row, column, value) triplets, duplicates being summed once compressed
+     * by a SparseMatrix of either order.
+     *
+     */
+    template <typename T>
+    class SparseBuilder {
+        
+    public:
+        
+        struct Triplet {
+            std::size_t row;
+            std::size_t col;
+            T value;
+        };
+        
+        typedef T           value_type;
+        typedef std::size_t size_type;
+        
+    private:
+        
+        std::size_t _rows;
+        std::size_t _cols;
+        std::vector<Triplet> _triplets;
+        
+    public:
+        
+        SparseBuilder(size_type const& rows, size_type const& cols) : _rows(rows), _cols(cols) {}
+        
+        size_type rows() const {
+            return _rows;
+        }
+        
+        size_type cols() const {
+            return _cols;
+        }
+        
+        // number of triplets added so far, duplicates included
+        size_type size() const {
+            return _triplets.size();
+        }
+        
+        const Triplet* triplets() const {
+            return _triplets.data();
+        }
+        
+        void reserve(size_type const& n) {
+            _triplets.reserve(n);
+        }
+        
+        void add(size_type const& i, size_type const& j, T const& value) {
+            ASSERT(i < _rows && j < _cols, "Triplet (" << i << ", " << j << ") out of bounds in SparseMatrix of size " << _rows << " x " << _cols);
+            _triplets.push_back(Triplet{i, j, value});
+        }
+        
+        void clear() {
+            _triplets.clear();
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // kernels
+    // --------------------------------------------------------------------
+    
+    // sum of the products of the non-zeros of compressed row, or column,
+    // \c i with the elements of \c x at their indices
+    template <typename T, typename O>
+    inline T sparseDot(SparseMatrix<T, O> const& a, std::size_t const& i, const T* x) {
+        const std::size_t* indices = a.indices();
+        const T* values = a.values();
+        std::size_t const end = a.offsets()[i + 1];
+        T sum(0);
+        for (std::size_t k(a.offsets()[i]); k < end; k++) {
+            sum += values[k] * x[indices[k]];
+        }
+        return sum;
+    }
+    
+    /**
+     *
+     * Combines through \c Op the products of every compressed row, or
+     * column, of \c a with \c x into the corresponding element of \c dst,
+     * consecutive elements being \c step apart.
+     *
+     * From \c EXPAND_PARALLEL_THRESHOLD non-zeros on, rows are split into
+     * chunks run by the thread pool, each one writing its own elements.
+     *
+     */
+    template <typename Op, typename T, typename O, typename U>
+    void sparseGather(U* dst, std::size_t const& step, SparseMatrix<T, O> const& a, const T* x) {
+        auto rows = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i(begin); i < end; i++) {
+                dst[i * step] = Op::apply(dst[i * step], static_cast<U>(sparseDot(a, i, x)));
+            }
+        };
+        std::size_t const n = a.outerSize();
+        if (a.nonZeros() >= EXPAND_PARALLEL_THRESHOLD) {
+            parallelFor(n, parallelGrain<T>(n, 1), rows);
+            return;
+        }
+        rows(0, n);
+    }
+    
+    /**
+     *
+     * Combines through \c Op the transposed product of \c a with \c x into
+     * \c dst, that is the sums of the non-zeros of every compressed row, or
+     * column, \c j times x[j] into the elements at their indices.
+     *
+     * From \c EXPAND_PARALLEL_THRESHOLD non-zeros on, the destination is
+     * split into one range per thread, each one finding its indices in
+     * every row by binary search, so that no two threads write the same
+     * element and sums are accumulated in the same order whatever the
+     * number of threads.
+     *
+     */
+    template <typename Op, typename T, typename O, typename U>
+    void sparseScatter(U* dst, std::size_t const& step, SparseMatrix<T, O> const& a, const T* x) {
+        const std::size_t* offsets = a.offsets();
+        const std::size_t* indices = a.indices();
+        const T* values = a.values();
+        auto range = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i(begin); i < end; i++) {
+                dst[i * step] = Op::apply(dst[i * step], U(0));
+            }
+            for (std::size_t j(0); j < a.outerSize(); j++) {
+                std::size_t k = begin == 0 ? offsets[j] :
+                    std::lower_bound(indices + offsets[j], indices + offsets[j + 1], begin) - indices;
+                for (; k < offsets[j + 1] && indices[k] < end; k++) {
+                    U const p = static_cast<U>(values[k] * x[j]);
+                    if constexpr (std::is_same<Op, SubAssign>::value) {
+                        dst[indices[k] * step] -= p;
+                    } else {
+                        dst[indices[k] * step] += p;
+                    }
+                }
+            }
+        };
+        std::size_t const n = a.innerSize();
+        if (a.nonZeros() >= EXPAND_PARALLEL_THRESHOLD) {
+            parallelFor(n, n / maxThreads() + 1, range);
+            return;
+        }
+        range(0, n);
+    }
+    
+    // --------------------------------------------------------------------
+    // expression nodes
+    // --------------------------------------------------------------------
+    
+    // transposed view of a sparse matrix, operand of the transposed products
+    template <typename T, typename O>
+    struct SparseTranspose {
+        
+        SparseMatrix<T, O> const& a;
+        
+        std::size_t rows() const {
+            return a.cols();
+        }
+        
+        std::size_t cols() const {
+            return a.rows();
+        }
+    };
+    
+    /**
+     *
+     * Product of the compressed rows, or columns, of \c a with a vector,
+     * that is A * x for a CSR matrix and transpose(A) * x for a CSC one,
+     * evaluated one element at a time so that it takes part in larger
+     * expressions such as b - A * x without temporaries.
+     *
+     * \c X is a reference to the vector operand when its elements are
+     * contiguous, and a VectorX holding its evaluation otherwise.
+     *
+     * Assigned on its own, the product runs \c sparseGather, first copying
+     * the operand when it is the destination. Within larger expressions the
+     * destination must differ from the operand.
+     *
+     */
+    template <typename T, typename O, typename X>
+    struct SparseProduct {
+        
+        typedef T value_type;
+        
+        static constexpr bool vectorizable = false;
+        
+        SparseMatrix<T, O> const& a;
+        X v;
+        
+        std::size_t size() const {
+            return a.outerSize();
+        }
+        
+        value_type operator[](std::size_t i) const {
+            return sparseDot(a, i, v.elements());
+        }
+        
+        template <typename Op, typename U>
+        void evaluateTo(U* dst, std::size_t step, std::size_t) const {
+            if (static_cast<const void*>(v.elements()) == static_cast<const void*>(dst)) {
+                VectorX<T> const x(v);
+                sparseGather<Op>(dst, step, a, x.elements());
+                return;
+            }
+            sparseGather<Op>(dst, step, a, v.elements());
+        }
+    };
+    
+    template <typename T, typename O, typename X>
+    struct IsVectorExpression<SparseProduct<T, O, X>> : std::true_type {};
+    
+    template <typename T, typename O, typename X>
+    struct HasEvaluateTo<SparseProduct<T, O, X>> : std::true_type {};
+    
+    /**
+     *
+     * Sparse matrix in compressed sparse row (CSR) or column (CSC) order:
+     * the non-zeros of every row, or column, are stored contiguously and
+     * sorted by index, offsets()[i] being the position of the first one of
+     * row, or column, i and offsets()[i + 1] that of the first one of the
+     * next.
+     *
+     * Matrices are built from a SparseBuilder of triplets by two counting
+     * sorts, by inner then outer index, which only stream through memory,
+     * or converted from the other order.
+     *
+     * The products of the compressed rows, or columns, with a vector, A * x
+     * for CSR matrices and transpose(A) * x for CSC ones, are lazy
+     * expressions. The other products scatter their sums and are evaluated
+     * right away into a VectorX, like \c cross; a matrix converted to the
+     * other order makes them lazy as well.
+     *
+     */
+    template <typename T, typename O>
+    class SparseMatrix {
+        
+        static_assert(std::is_same<O, CSR>::value || std::is_same<O, CSC>::value, "Sparse matrices are stored in CSR or CSC order");
+        
+        template <typename, typename>
+        friend class SparseMatrix;
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // type definitions
+        // --------------------------------------------------------------------
+        
+        typedef T           value_type;
+        typedef O           order;
+        typedef std::size_t size_type;
+        
+    private:
+        
+        std::size_t _rows;
+        std::size_t _cols;
+        
+        // outerSize() + 1 positions of the first non-zero of every row, or
+        // column, in \c _indices and \c _values
+        std::vector<std::size_t> _offsets;
+        std::vector<std::size_t> _indices;
+        std::vector<T> _values;
+        
+        static constexpr bool rowMajor = std::is_same<O, CSR>::value;
+        
+        // counts the elements of \c n keys into \c offsets, turned into
+        // the positions of the first element of every key
+        template <typename K>
+        static void countingOffsets(std::vector<std::size_t>& offsets, std::size_t const& keys,
+                                    std::size_t const& n, K const& key) {
+            offsets.assign(keys + 1, 0);
+            for (std::size_t k(0); k < n; k++) {
+                offsets[key(k) + 1]++;
+            }
+            for (std::size_t i(0); i < keys; i++) {
+                offsets[i + 1] += offsets[i];
+            }
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // empty 0 x 0 matrix
+        SparseMatrix() : _rows(0), _cols(0), _offsets(1, 0) {}
+        
+        // \c rows x \c cols matrix without non-zeros
+        SparseMatrix(size_type const& rows, size_type const& cols) : _rows(rows), _cols(cols),
+            _offsets((rowMajor ? rows : cols) + 1, 0) {}
+        
+        // compression of the triplets of \c builder, duplicates being summed
+        explicit SparseMatrix(SparseBuilder<T> const& builder) : _rows(builder.rows()), _cols(builder.cols()) {
+            typedef typename SparseBuilder<T>::Triplet Triplet;
+            const Triplet* triplets = builder.triplets();
+            std::size_t const n = builder.size();
+            auto outer = [&](std::size_t k) { return rowMajor ? triplets[k].row : triplets[k].col; };
+            auto inner = [&](std::size_t k) { return rowMajor ? triplets[k].col : triplets[k].row; };
+            
+            // triplets ordered by inner index, then stably by outer index,
+            // leave every row, or column, sorted
+            std::vector<std::size_t> positions;
+            countingOffsets(positions, innerSize(), n, inner);
+            std::vector<std::size_t> byInner(n);
+            for (std::size_t k(0); k < n; k++) {
+                byInner[positions[inner(k)]++] = k;
+            }
+            
+            countingOffsets(_offsets, outerSize(), n, outer);
+            positions.assign(_offsets.begin(), _offsets.end() - 1);
+            _indices.resize(n);
+            _values.resize(n);
+            for (std::size_t k : byInner) {
+                std::size_t const p = positions[outer(k)]++;
+                _indices[p] = inner(k);
+                _values[p] = triplets[k].value;
+            }
+            
+            // duplicates, now next to each other, are summed in place
+            std::size_t p(0);
+            for (std::size_t i(0); i < outerSize(); i++) {
+                std::size_t const begin = _offsets[i];
+                std::size_t const end = _offsets[i + 1];
+                _offsets[i] = p;
+                for (std::size_t k(begin); k < end; k++) {
+                    if (p > _offsets[i] && _indices[p - 1] == _indices[k]) {
+                        _values[p - 1] += _values[k];
+                    } else {
+                        _indices[p] = _indices[k];
+                        _values[p++] = _values[k];
+                    }
+                }
+            }
+            _offsets[outerSize()] = p;
+            _indices.resize(p);
+            _values.resize(p);
+        }
+        
+        // same matrix stored in the other order, by a counting sort of its
+        // non-zeros by inner index
+        template <typename O2, typename std::enable_if<!std::is_same<O, O2>::value, int>::type = 0>
+        explicit SparseMatrix(SparseMatrix<T, O2> const& other) : _rows(other.rows()), _cols(other.cols()) {
+            std::size_t const n = other.nonZeros();
+            countingOffsets(_offsets, outerSize(), n, [&](std::size_t k) { return other._indices[k]; });
+            std::vector<std::size_t> positions(_offsets.begin(), _offsets.end() - 1);
+            _indices.resize(n);
+            _values.resize(n);
+            for (std::size_t j(0); j < other.outerSize(); j++) {
+                for (std::size_t k(other._offsets[j]); k < other._offsets[j + 1]; k++) {
+                    std::size_t const p = positions[other._indices[k]]++;
+                    _indices[p] = j;
+                    _values[p] = other._values[k];
+                }
+            }
+        }
+        
+        // --------------------------------------------------------------------
+        // accessors
+        // --------------------------------------------------------------------
+        
+        size_type rows() const {
+            return _rows;
+        }
+        
+        size_type cols() const {
+            return _cols;
+        }
+        
+        size_type nonZeros() const {
+            return _values.size();
+        }
+        
+        // number of compressed rows, or columns
+        size_type outerSize() const {
+            return rowMajor ? _rows : _cols;
+        }
+        
+        // size of the compressed rows, or columns
+        size_type innerSize() const {
+            return rowMajor ? _cols : _rows;
+        }
+        
+        const std::size_t* offsets() const {
+            return _offsets.data();
+        }
+        
+        const std::size_t* indices() const {
+            return _indices.data();
+        }
+        
+        // values may be changed in place, the structure may not
+        T* values() {
+            return _values.data();
+        }
+        
+        const T* values() const {
+            return _values.data();
+        }
+        
+        // element (i, j), 0 for elements which are not stored
+        T operator()(size_type const& i, size_type const& j) const {
+            ASSERT(i < _rows && j < _cols, "Index (" << i << ", " << j << ") out of bounds in SparseMatrix of size " << _rows << " x " << _cols);
+            std::size_t const outer = rowMajor ? i : j;
+            std::size_t const inner = rowMajor ? j : i;
+            const std::size_t* begin = _indices.data() + _offsets[outer];
+            const std::size_t* end = _indices.data() + _offsets[outer + 1];
+            const std::size_t* k = std::lower_bound(begin, end, inner);
+            return k != end && *k == inner ? _values[k - _indices.data()] : T(0);
+        }
+        
+        SparseTranspose<T, O> transpose() const {
+            return SparseTranspose<T, O>{*this};
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // operators
+    // --------------------------------------------------------------------
+    
+    template <typename T, typename O>
+    SparseTranspose<T, O> transpose(SparseMatrix<T, O> const& a) {
+        return SparseTranspose<T, O>{a};
+    }
+    
+    template <typename T, typename O>
+    SparseMatrix<T, O> const& transpose(SparseTranspose<T, O> const& t) {
+        return t.a;
+    }
+    
+    // product of the compressed rows, or columns, of \c a with \c v, lazy
+    // when the elements of \c v are contiguous, or \c v evaluated first
+    template <typename T, typename O, typename T2>
+    auto sparseProduct(SparseMatrix<T, O> const& a, T2 const& v) {
+        if constexpr (IsContiguousVector<T2, T>::value) {
+            return SparseProduct<T, O, T2 const&>{a, v};
+        } else {
+            return SparseProduct<T, O, VectorX<T>>{a, VectorX<T>(v)};
+        }
+    }
+    
+    // transposed product of the compressed rows, or columns, of \c a with
+    // \c v, evaluated right away
+    template <typename T, typename O, typename T2>
+    VectorX<T> sparseTransposedProduct(SparseMatrix<T, O> const& a, T2 const& v) {
+        VectorX<T> y(a.innerSize());
+        if constexpr (IsContiguousVector<T2, T>::value) {
+            sparseScatter<Assign>(y.elements(), 1, a, v.elements());
+        } else {
+            VectorX<T> const x(v);
+            sparseScatter<Assign>(y.elements(), 1, a, x.elements());
+        }
+        return y;
+    }
+    
+    template <typename T, typename O, typename T2, EnableIfVectorExpression<T2> = 0>
+    auto operator*(SparseMatrix<T, O> const& a, T2 const& v) {
+        ASSERT(a.cols() == v.size(), "Matrix and Vector dimensions must agree");
+        if constexpr (std::is_same<O, CSR>::value) {
+            return sparseProduct(a, v);
+        } else {
+            return sparseTransposedProduct(a, v);
+        }
+    }
+    
+    template <typename T, typename O, typename T2, EnableIfVectorExpression<T2> = 0>
+    auto operator*(SparseTranspose<T, O> const& t, T2 const& v) {
+        ASSERT(t.cols() == v.size(), "Matrix and Vector dimensions must agree");
+        if constexpr (std::is_same<O, CSC>::value) {
+            return sparseProduct(t.a, v);
+        } else {
+            return sparseTransposedProduct(t.a, v);
+        }
+    }
+}
+
+#endif /* SparseMatrix_h */
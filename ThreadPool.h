@@ -0,0 +1,279 @@
+//
+//  ThreadPool.h
+//  Expand
+//
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// largest number of threads evaluating an expression, the calling one
+// included; 0 uses every hardware thread and 1 disables multithreading
+#ifndef EXPAND_MAX_THREADS
+#   define EXPAND_MAX_THREADS 0
+#endif
+
+// number of elements from which an element-wise assignment is split
+// across threads
+#ifndef EXPAND_PARALLEL_THRESHOLD
+#   define EXPAND_PARALLEL_THRESHOLD 65536
+#endif
+
+// number of multiply-adds from which a matrix product is split across
+// threads
+#ifndef EXPAND_PARALLEL_GEMM_THRESHOLD
+#   define EXPAND_PARALLEL_GEMM_THRESHOLD 2097152
+#endif
+
+// bytes of destination written by each chunk of a split assignment, small
+// enough for the chunk and its operands to stay in cache
+#ifndef EXPAND_PARALLEL_CHUNK_BYTES
+#   define EXPAND_PARALLEL_CHUNK_BYTES 65536
+#endif
+
+namespace expand {
+    
+    /**
+     *
+     * Work-stealing pool running the chunks of large evaluations.
+     *
+     * Each worker owns a queue of chunks, taking from its back and stealing
+     * from the front of the other queues once it is empty. The thread which
+     * submits a loop steals chunks as well until the whole loop is done, so
+     * that a pool of \c n threads has \c n - 1 workers.
+     *
+     * Chunks started from within a chunk run on the current thread, hence
+     * nested evaluations never wait for one another.
+     *
+     */
+    class ThreadPool {
+        
+    public:
+        
+        // the pool shared by all evaluations, started on first use
+        static ThreadPool& instance() {
+            static ThreadPool pool(EXPAND_MAX_THREADS);
+            return pool;
+        }
+        
+        explicit ThreadPool(std::size_t const& threads) {
+            resize(threads);
+        }
+        
+        ThreadPool(ThreadPool const&) = delete;
+        
+        ThreadPool& operator=(ThreadPool const&) = delete;
+        
+        ~ThreadPool() {
+            stop();
+        }
+        
+        // number of threads running a loop, the calling one included
+        std::size_t threads() const {
+            return _queues.size() + 1;
+        }
+        
+        // restarts the pool with \c threads threads, every hardware thread
+        // for 0; must not be called while a loop is running
+        void resize(std::size_t threads) {
+            stop();
+            if (threads == 0) {
+                threads = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+            _stopping = false;
+            for (std::size_t i(1); i < threads; i++) {
+                _queues.emplace_back(new Queue());
+            }
+            for (std::size_t i(0); i < _queues.size(); i++) {
+                _workers.emplace_back([this, i] { work(i); });
+            }
+        }
+        
+        /**
+         *
+         * Calls \c f(begin, end) over consecutive chunks of \c grain indices
+         * covering [0, \c n), the last one being shorter, and returns once
+         * every chunk is done.
+         *
+         */
+        template <typename F>
+        void parallelFor(std::size_t const& n, std::size_t grain, F const& f) {
+            grain = std::max(grain, std::size_t(1));
+            if (_queues.empty() || inTask() || n <= grain) {
+                for (std::size_t i(0); i < n; i += grain) {
+                    f(i, std::min(i + grain, n));
+                }
+                return;
+            }
+            
+            Loop loop;
+            loop.body = &f;
+            loop.run = [](const void* body, std::size_t begin, std::size_t end) {
+                (*static_cast<F const*>(body))(begin, end);
+            };
+            std::size_t const chunks = (n + grain - 1) / grain;
+            loop.pending = chunks;
+            
+            // chunks are counted before being queued so that the count never
+            // drops below zero, and dealt round-robin, the workers balancing
+            // the load by stealing
+            {
+                std::lock_guard<std::mutex> lock(_sleepMutex);
+                _queued += chunks;
+            }
+            for (std::size_t c(0); c < chunks; c++) {
+                Queue& queue = *_queues[c % _queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.chunks.push_back(Chunk{&loop, c * grain, std::min((c + 1) * grain, n)});
+            }
+            _wake.notify_all();
+            
+            while (loop.pending.load(std::memory_order_acquire) > 0) {
+                Chunk chunk;
+                if (steal(_queues.size(), chunk)) {
+                    run(chunk);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        
+    private:
+        
+        // a loop being run, whose body is type-erased
+        struct Loop {
+            void (*run)(const void*, std::size_t, std::size_t);
+            const void* body;
+            std::atomic<std::size_t> pending;
+        };
+        
+        struct Chunk {
+            Loop* loop;
+            std::size_t begin;
+            std::size_t end;
+        };
+        
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Chunk> chunks;
+        };
+        
+        std::vector<std::unique_ptr<Queue>> _queues;
+        std::vector<std::thread> _workers;
+        
+        // workers sleep while no chunk is queued
+        std::mutex _sleepMutex;
+        std::condition_variable _wake;
+        std::size_t _queued = 0;
+        bool _stopping = false;
+        
+        // true on a thread currently running a chunk
+        static bool& inTask() {
+            static thread_local bool flag = false;
+            return flag;
+        }
+        
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(_sleepMutex);
+                _stopping = true;
+            }
+            _wake.notify_all();
+            for (std::thread& worker : _workers) {
+                worker.join();
+            }
+            _workers.clear();
+            _queues.clear();
+        }
+        
+        // takes a chunk from the back of queue \c self, if any, then from the
+        // front of the others
+        bool steal(std::size_t const& self, Chunk& chunk) {
+            std::size_t const count = _queues.size();
+            for (std::size_t k(0); k < count; k++) {
+                std::size_t const i = (self + k) % count;
+                Queue& queue = *_queues[i];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.chunks.empty()) {
+                    if (i == self) {
+                        chunk = queue.chunks.back();
+                        queue.chunks.pop_back();
+                    } else {
+                        chunk = queue.chunks.front();
+                        queue.chunks.pop_front();
+                    }
+                    std::lock_guard<std::mutex> sleep(_sleepMutex);
+                    _queued--;
+                    return true;
+                }
+            }
+            return false;
+        }
+        
+        void run(Chunk const& chunk) {
+            inTask() = true;
+            chunk.loop->run(chunk.loop->body, chunk.begin, chunk.end);
+            inTask() = false;
+            chunk.loop->pending.fetch_sub(1, std::memory_order_release);
+        }
+        
+        void work(std::size_t const& self) {
+            for (;;) {
+                Chunk chunk;
+                if (steal(self, chunk)) {
+                    run(chunk);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(_sleepMutex);
+                _wake.wait(lock, [this] { return _queued > 0 || _stopping; });
+                if (_stopping) {
+                    return;
+                }
+            }
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // thread count
+    // --------------------------------------------------------------------
+    
+    // largest number of threads evaluating an expression
+    inline std::size_t maxThreads() {
+        return ThreadPool::instance().threads();
+    }
+    
+    // caps the number of threads evaluating an expression, 0 for every
+    // hardware thread and 1 to evaluate on the calling thread only; must not
+    // be called while an expression is being evaluated
+    inline void setMaxThreads(std::size_t const& threads) {
+        ThreadPool::instance().resize(threads);
+    }
+    
+    // runs \c f over chunks of \c grain indices of [0, \c n) on the pool
+    template <typename F>
+    void parallelFor(std::size_t const& n, std::size_t const& grain, F const& f) {
+        ThreadPool::instance().parallelFor(n, grain, f);
+    }
+    
+    // number of elements of \c T evaluated by each chunk of a split
+    // assignment of \c n elements, a multiple of \c multiple, leaving
+    // several chunks per thread to balance the load
+    template <typename T>
+    std::size_t parallelGrain(std::size_t const& n, std::size_t const& multiple) {
+        std::size_t const cached = std::max(EXPAND_PARALLEL_CHUNK_BYTES / sizeof(T), std::size_t(1));
+        std::size_t const balanced = n / (4 * maxThreads()) + 1;
+        std::size_t const grain = std::min(cached, balanced);
+        return (grain + multiple - 1) / multiple * multiple;
+    }
+}
+
+#endif /* ThreadPool_h */
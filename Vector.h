@@ -12,28 +12,75 @@
 #include "VectorIterConst.h"
 
 #include "VectorOps.h"
+#include "VectorEval.h"
+#include "VectorReduce.h"
 
 namespace expand {
     
-    template <typename T, std::size_t N, std::size_t S = 0>
-    class Vector : public VectorMemory<T, N, S> {
+    template <typename T, std::size_t N, std::size_t S = 0, typename A = Packed>
+    class Vector : public VectorMemory<T, N, S, A> {
         
-        friend class VectorIter<T, N, S>;
-        friend class VectorIterConst<T, N, S>;
+        friend class VectorIter<T, N, S, A>;
+        friend class VectorIterConst<T, N, S, A>;
+        
+    public:
         
         // --------------------------------------------------------------------
         // STL-compatible type definitions
         // --------------------------------------------------------------------
         
         typedef T                           value_type;
-        typedef VectorIter<T, N,  S>        iterator;
-        typedef VectorIterConst<T, N, S>    const_iterator;
+        typedef VectorIter<T, N, S, A>      iterator;
+        typedef VectorIterConst<T, N, S, A> const_iterator;
         typedef T&                          reference;
         typedef const T&                    const_reference;
         typedef std::ptrdiff_t              difference_type;
         typedef std::size_t                 size_type;
         
-        size_type const _size = N;
+    private:
+        
+        // policy of the bounds and dimension checks
+        typedef typename VectorMemory<T, N, S, A>::Check Check;
+        
+        // dimensions of the expressions assigned to this Vector must agree
+        // with its own when both are known at compile time
+        template <typename E>
+        static constexpr bool agrees = VectorShapes<Vector<T, N, S, A>, E>::agree;
+        
+        // small fixed-size Vectors are evaluated fully unrolled
+        static constexpr bool unrolled = N != Dynamic && S != Dynamic && N > 0 && N <= EXPAND_UNROLL_LIMIT;
+        
+        // distance between two consecutive elements in memory
+        constexpr std::size_t step() const {
+            if constexpr (S == Dynamic) {
+                return this->stride();
+            } else {
+                return S == 0 ? 1 : S;
+            }
+        }
+        
+        // number of elements evaluated from \c e, padded vectors being
+        // evaluated a whole number of packets at a time when every operand
+        // is padded alike
+        template <typename E>
+        constexpr size_type evaluatedSize(E const&) const {
+            if constexpr (S == 0 && E::vectorizable && std::is_same<WidenedType<E>, typename Widened<T>::type>::value &&
+                          std::is_same<typename VectorLayout<E>::type, A>::value) {
+                return A::template padded<T>(size());
+            } else {
+                return size();
+            }
+        }
+        
+        // evaluates \c e into this Vector through \c Op
+        template <typename Op, typename E>
+        constexpr void evaluateFrom(E const& e) {
+            if constexpr (unrolled) {
+                evaluateUnrolled<Op, (S == 0 ? 1 : S)>(this->_elements, e, std::make_index_sequence<N>());
+            } else {
+                evaluate<Op>(this->_elements, step(), evaluatedSize(e), e);
+            }
+        }
         
     public:
         
@@ -44,31 +91,51 @@ namespace expand {
         // default constructor
         Vector() { }
         
-        // copy constructor
-        Vector(Vector<T, N, S> const& rhs) : VectorMemory<T, N, S>(rhs) {}
+        // copies and moves are those of the storage, hence trivial for
+        // fixed-size Vectors, deep for dynamic ones and referencing the same
+        // memory for references
+        Vector(Vector<T, N, S, A> const& rhs) = default;
+        
+        Vector(Vector<T, N, S, A>&& rhs) = default;
         
         // foreign memory
-        Vector(T* const t) : VectorMemory<T, N, S>(t) {}
+        Vector(T* const t) : VectorMemory<T, N, S, A>(t) {}
+        
+        // foreign memory holding \c n elements, or whose elements are \c n
+        // apart for a Dynamic stride
+        Vector(T* const t, size_type const& n) : VectorMemory<T, N, S, A>(t, n) {}
         
         // a Vector can be constructed from any VectorExpression, forcing its
         // evaluation
         // templated Vector constructor
-        template <typename VecExpression>
-        Vector(VecExpression const& vec) {
-            for (std::size_t i(0); i < _size; i++) {
-                (*this)[i] = vec[i];
-            }
+        template <typename VecExpression, EnableIfVectorExpression<VecExpression> = 0>
+        constexpr Vector(VecExpression const& vec) : VectorMemory<T, N, S, A>(vec.size()) {
+            static_assert(agrees<VecExpression>, "Vector dimensions must agree");
+            evaluateFrom<Assign>(vec);
         }
         
         // fill with provided value
-        Vector(const T val) {
-            for (std::size_t i(0); i < _size; i++) {
-                (*this)[i] = val;
+        template <std::size_t D = N, typename std::enable_if<D != Dynamic, int>::type = 0>
+        constexpr Vector(const T val) : VectorMemory<T, N, S, A>(N) {
+            for (std::size_t i(0); i < size(); i++) {
+                this->unchecked(i) = val;
+            }
+        }
+        
+        // dynamic Vector of \c n uninitialized elements
+        template <std::size_t D = N, typename std::enable_if<D == Dynamic, int>::type = 0>
+        explicit Vector(size_type const& n) : VectorMemory<T, N, S, A>(n) {}
+        
+        // dynamic Vector of \c n elements filled with provided value
+        template <std::size_t D = N, typename std::enable_if<D == Dynamic, int>::type = 0>
+        Vector(size_type const& n, const T val) : VectorMemory<T, N, S, A>(n) {
+            for (std::size_t i(0); i < size(); i++) {
+                this->unchecked(i) = val;
             }
         }
         
         // fill with provided values
-        Vector(std::initializer_list<T> const& elements) {
+        constexpr Vector(std::initializer_list<T> const& elements) : VectorMemory<T, N, S, A>(N == Dynamic ? elements.size() : N) {
             std::size_t i(0);
             for (auto it = elements.begin(); it != elements.end(); it++) {
                 (*this)[i++] = *it;
@@ -80,103 +147,136 @@ namespace expand {
         // --------------------------------------------------------------------
         
         iterator begin() {
-            return VectorIter<T, N, S>(*this);
+            return VectorIter<T, N, S, A>(*this);
         }
         
         const_iterator begin() const {
-            return VectorIterConst<T, N, S>(*this);
+            return VectorIterConst<T, N, S, A>(*this);
         }
         
         iterator end() {
-            return VectorIter<T, N, S>(*this, true);
+            return VectorIter<T, N, S, A>(*this, true);
         }
         
         const_iterator end() const {
-            return VectorIterConst<T, N, S>(*this, true);
+            return VectorIterConst<T, N, S, A>(*this, true);
+        }
+        
+        const_iterator cbegin() const {
+            return begin();
         }
         
-        size_type const& size() const {
-            return _size;
+        const_iterator cend() const {
+            return end();
         }
         
-        size_type const& max_size() const {
-            return _size;
+        constexpr size_type size() const {
+            return VectorMemory<T, N, S, A>::size();
         }
         
-        inline static bool empty() {
-            return false;
+        constexpr size_type max_size() const {
+            return size();
+        }
+        
+        constexpr bool empty() const {
+            return size() == 0;
         }
         
         // --------------------------------------------------------------------
         // operators
         // --------------------------------------------------------------------
         
-        Vector<T, N, S>& operator=(Vector<T, N, S> const& rhs) {
-            ASSERT(size() == rhs.size(), "Vector dimensions must agree");
-            for (std::size_t i = 0; i < _size; i++) {
-                (*this)[i] = rhs[i];
-            }
-            return *this;
-        }
+        // dynamic Vectors are resized to match the assigned Vector, while
+        // references copy the elements they reference
+        Vector<T, N, S, A>& operator=(Vector<T, N, S, A> const& rhs) = default;
         
-        Vector<T, N, S>& operator+=(T const& t);
+        Vector<T, N, S, A>& operator=(Vector<T, N, S, A>&& rhs) = default;
         
-        template <typename VectorExpression>
-        Vector<T, N, S>& operator+=(VectorExpression const& rhs) {
-            ASSERT(size() == rhs.size(), "Vector dimensions must agree");
-            for (std::size_t i = 0; i < _size; i++) {
-                (*this)[i] += rhs[i];
+        template <typename VectorExpression, EnableIfVectorExpression<VectorExpression> = 0>
+        constexpr Vector<T, N, S, A>& operator=(VectorExpression const& rhs) {
+            static_assert(agrees<VectorExpression>, "Vector dimensions must agree");
+            if constexpr (N == Dynamic && S == 0) {
+                if (size() != rhs.size()) {
+                    // resizing first would release memory the expression may read
+                    return *this = Vector<T, N, S, A>(rhs);
+                }
             }
+            EXPAND_CHECK(Check, size() == rhs.size(), "Vector dimensions must agree");
+            evaluateFrom<Assign>(rhs);
             return *this;
         }
         
-        Vector<T, N, S>& operator-=(T const& t);
+        constexpr Vector<T, N, S, A>& operator+=(T const& t) {
+            evaluateFrom<Assign>(VectorBroadcast<Vector<T, N, S, A>, Plus>{*this, t});
+            return *this;
+        }
         
-        template <typename VectorExpression>
-        Vector<T, N, S>& operator-=(VectorExpression const& rhs) {
-            ASSERT(size() == rhs.size(), "Vector dimensions must agree");
-            for (std::size_t i = 0; i < _size; i++) {
-                (*this)[i] -= rhs[i];
-            }
+        template <typename VectorExpression, EnableIfVectorExpression<VectorExpression> = 0>
+        constexpr Vector<T, N, S, A>& operator+=(VectorExpression const& rhs) {
+            static_assert(agrees<VectorExpression>, "Vector dimensions must agree");
+            EXPAND_CHECK(Check, size() == rhs.size(), "Vector dimensions must agree");
+            evaluateFrom<AddAssign>(rhs);
             return *this;
         }
         
-        // --------------------------------------------------------------------
-        // friend operators
-        // --------------------------------------------------------------------
+        constexpr Vector<T, N, S, A>& operator-=(T const& t) {
+            evaluateFrom<Assign>(VectorBroadcast<Vector<T, N, S, A>, Minus>{*this, t});
+            return *this;
+        }
         
-        // addition
-        template<typename T1, typename T2>
-        friend auto operator+(T1 const& u, T2 const& v) {
-            ASSERT(u.size() == v.size(), "Vector dimensions must agree");
-            return VectorSum<T1, T2>{u, v};
+        template <typename VectorExpression, EnableIfVectorExpression<VectorExpression> = 0>
+        constexpr Vector<T, N, S, A>& operator-=(VectorExpression const& rhs) {
+            static_assert(agrees<VectorExpression>, "Vector dimensions must agree");
+            EXPAND_CHECK(Check, size() == rhs.size(), "Vector dimensions must agree");
+            evaluateFrom<SubAssign>(rhs);
+            return *this;
         }
         
-        // substraction
-        template<typename T1, typename T2>
-        friend auto operator-(T1 const& u, T2 const& v) {
-            ASSERT(u.size() == v.size(), "Vector dimensions must agree");
-            return VectorDif<T1, T2>{u, v};
+        constexpr Vector<T, N, S, A>& operator*=(T const& t) {
+            evaluateFrom<Assign>(VectorBroadcast<Vector<T, N, S, A>, Multiplies>{*this, t});
+            return *this;
         }
         
-        // element-wise multiplication
-        template<typename T1, typename T2>
-        friend auto operator*(T1 const& u, T2 const& v) {
-            ASSERT(u.size() == v.size(), "Vector dimensions must agree");
-            return VectorMul<T1, T2>{u, v};
+        constexpr Vector<T, N, S, A>& operator/=(T const& t) {
+            evaluateFrom<Assign>(VectorBroadcast<Vector<T, N, S, A>, Divides>{*this, t});
+            return *this;
         }
         
+        // --------------------------------------------------------------------
+        // friend operators
+        // --------------------------------------------------------------------
+        
         // output
-        friend std::ostream& operator<<(std::ostream& os, Vector<T, N, S> const& vec) {
-            os << "Vec(" << vec._size << ")<" << typeid(T).name() << ">" << std::endl;
+        friend std::ostream& operator<<(std::ostream& os, Vector<T, N, S, A> const& vec) {
+            os << "Vec(" << vec.size() << ")<" << typeid(T).name() << ">" << std::endl;
             os << "[ ";
-            for (std::size_t i(0); i < vec._size; i++) {
+            for (std::size_t i(0); i < vec.size(); i++) {
                 os << vec[i] << " ";
             }
             os << "]";
             return os;
         }
     };
+    
+    // Vector whose size is only known at runtime
+    template <typename T>
+    using VectorX = Vector<T, Dynamic>;
+    
+    // cross product of two vectors of size 3, evaluated right away so that
+    // the result may be assigned to one of its operands
+    template <typename T1, typename T2, EnableIfVectorExpressions<T1, T2> = 0>
+    constexpr auto cross(T1 const& u, T2 const& v) {
+        static_assert((VectorShape<T1>::size == 3 || VectorShape<T1>::size == Dynamic) &&
+                      (VectorShape<T2>::size == 3 || VectorShape<T2>::size == Dynamic),
+                      "Cross product only defined for vectors of size 3");
+        ASSERT(u.size() == 3 && v.size() == 3, "Cross product only defined for vectors of size 3");
+        typedef decltype(u[0] * v[0] - u[0] * v[0]) value_type;
+        return Vector<value_type, 3>{
+            element(u, 1) * element(v, 2) - element(u, 2) * element(v, 1),
+            element(u, 2) * element(v, 0) - element(u, 0) * element(v, 2),
+            element(u, 0) * element(v, 1) - element(u, 1) * element(v, 0)
+        };
+    }
 }
 
 #endif /* Vector_h */
@@ -0,0 +1,616 @@
+//
+//  VectorBatch.h
+//  Expand
+//
+
+#ifndef VectorBatch_h
+#define VectorBatch_h
+
+#include <type_traits>
+#include <utility>
+
+#include "Vector.h"
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    template <typename T, std::size_t N>
+    class VectorBatch;
+    
+    // --------------------------------------------------------------------
+    // expression traits
+    // --------------------------------------------------------------------
+    
+    // true for every type which can be used as an operand of the batch
+    // operators: VectorBatch instances and expression nodes
+    template <typename E>
+    struct IsBatchExpression : std::false_type {};
+    
+    template <typename T, std::size_t N>
+    struct IsBatchExpression<VectorBatch<T, N>> : std::true_type {};
+    
+    // --------------------------------------------------------------------
+    // expression nodes
+    // --------------------------------------------------------------------
+    
+    // Batch expressions are indexed by (component, vector) and evaluated
+    // across the vectors of the batch, one SIMD lane per vector; \c size is
+    // the number of vectors and \c components the size of each of them
+    
+    template <typename T1, typename T2>
+    struct BatchSum {
+        
+        static_assert(T1::components == T2::components, "Vector dimensions must agree");
+        
+        typedef decltype(std::declval<T1>()(0, 0) + std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr std::size_t components = T2::components;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            return u(k, i) + v(k, i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            return u.template packet<P>(k, i) + v.template packet<P>(k, i);
+        }
+    };
+    
+    
+    template <typename T1, typename T2>
+    struct BatchDif {
+        
+        static_assert(T1::components == T2::components, "Vector dimensions must agree");
+        
+        typedef decltype(std::declval<T1>()(0, 0) - std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr std::size_t components = T2::components;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            return u(k, i) - v(k, i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            return u.template packet<P>(k, i) - v.template packet<P>(k, i);
+        }
+    };
+    
+    
+    // element-wise multiplication
+    template <typename T1, typename T2>
+    struct BatchMul {
+        
+        static_assert(T1::components == T2::components, "Vector dimensions must agree");
+        
+        typedef decltype(std::declval<T1>()(0, 0) * std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr std::size_t components = T2::components;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            return u(k, i) * v(k, i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            return u.template packet<P>(k, i) * v.template packet<P>(k, i);
+        }
+    };
+    
+    
+    // scaling of every vector by a scalar, captured by value
+    template <typename T1>
+    struct BatchScale {
+        
+        typedef typename T1::value_type value_type;
+        
+        static constexpr std::size_t components = T1::components;
+        
+        static constexpr bool vectorizable = T1::vectorizable;
+        
+        T1 const& u;
+        value_type s;
+        
+        std::size_t size() const {
+            return u.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            return u(k, i) * s;
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            return u.template packet<P>(k, i) * P::set1(s);
+        }
+    };
+    
+    
+    // cross product of every pair of vectors of size 3
+    template <typename T1, typename T2>
+    struct BatchCross {
+        
+        static_assert(T1::components == 3 && T2::components == 3, "Cross product only defined for vectors of size 3");
+        
+        typedef decltype(std::declval<T1>()(0, 0) * std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr std::size_t components = 3;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator()(std::size_t k, std::size_t i) const {
+            std::size_t const k1 = k == 2 ? 0 : k + 1;
+            std::size_t const k2 = k == 0 ? 2 : k - 1;
+            return u(k1, i) * v(k2, i) - u(k2, i) * v(k1, i);
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t k, std::size_t i) const {
+            std::size_t const k1 = k == 2 ? 0 : k + 1;
+            std::size_t const k2 = k == 0 ? 2 : k - 1;
+            return u.template packet<P>(k1, i) * v.template packet<P>(k2, i)
+                - u.template packet<P>(k2, i) * v.template packet<P>(k1, i);
+        }
+    };
+    
+    
+    // dot product of every pair of vectors, a vector expression holding one
+    // element per vector of the batch
+    template <typename T1, typename T2>
+    struct BatchDot {
+        
+        static_assert(T1::components == T2::components, "Vector dimensions must agree");
+        
+        typedef decltype(std::declval<T1>()(0, 0) * std::declval<T2>()(0, 0)) value_type;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
+        T1 const& u;
+        T2 const& v;
+        
+        std::size_t size() const {
+            return v.size();
+        }
+        
+        auto operator[](std::size_t i) const {
+            value_type result = u(0, i) * v(0, i);
+            for (std::size_t k(1); k < T2::components; k++) {
+                result += u(k, i) * v(k, i);
+            }
+            return result;
+        }
+        
+        template <typename P>
+        typename P::type packet(std::size_t i) const {
+            typename P::type result = u.template packet<P>(0, i) * v.template packet<P>(0, i);
+            for (std::size_t k(1); k < T2::components; k++) {
+                result += u.template packet<P>(k, i) * v.template packet<P>(k, i);
+            }
+            return result;
+        }
+    };
+    
+    template <typename T1, typename T2>
+    struct IsBatchExpression<BatchSum<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsBatchExpression<BatchDif<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsBatchExpression<BatchMul<T1, T2>> : std::true_type {};
+    
+    template <typename T1>
+    struct IsBatchExpression<BatchScale<T1>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsBatchExpression<BatchCross<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsVectorExpression<BatchDot<T1, T2>> : std::true_type {};
+    
+    // --------------------------------------------------------------------
+    // operators
+    // --------------------------------------------------------------------
+    
+    // only participate in overload resolution for batch expressions
+    template <typename T1>
+    using EnableIfBatchExpression = typename std::enable_if<IsBatchExpression<T1>::value, int>::type;
+    
+    template <typename T1, typename T2>
+    using EnableIfBatchExpressions = typename std::enable_if<
+        IsBatchExpression<T1>::value && IsBatchExpression<T2>::value, int>::type;
+    
+    // addition
+    template <typename T1, typename T2, EnableIfBatchExpressions<T1, T2> = 0>
+    auto operator+(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return BatchSum<T1, T2>{u, v};
+    }
+    
+    // substraction
+    template <typename T1, typename T2, EnableIfBatchExpressions<T1, T2> = 0>
+    auto operator-(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return BatchDif<T1, T2>{u, v};
+    }
+    
+    // element-wise multiplication
+    template <typename T1, typename T2, EnableIfBatchExpressions<T1, T2> = 0>
+    auto operator*(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return BatchMul<T1, T2>{u, v};
+    }
+    
+    // scaling
+    template <typename T1, EnableIfBatchExpression<T1> = 0>
+    auto operator*(T1 const& u, typename T1::value_type const& s) {
+        return BatchScale<T1>{u, s};
+    }
+    
+    template <typename T1, EnableIfBatchExpression<T1> = 0>
+    auto operator*(typename T1::value_type const& s, T1 const& u) {
+        return BatchScale<T1>{u, s};
+    }
+    
+    // dot products
+    template <typename T1, typename T2, EnableIfBatchExpressions<T1, T2> = 0>
+    auto dot(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return BatchDot<T1, T2>{u, v};
+    }
+    
+    // cross products
+    template <typename T1, typename T2, EnableIfBatchExpressions<T1, T2> = 0>
+    auto cross(T1 const& u, T2 const& v) {
+        ASSERT(u.size() == v.size(), "Batch sizes must agree");
+        return BatchCross<T1, T2>{u, v};
+    }
+    
+    
+    /**
+     *
+     * Collection of vectors of size \c N stored as a structure of arrays:
+     * component \c k of every vector is contiguous in memory, so that
+     * element-wise operations over the whole batch map each vector to one
+     * SIMD lane.
+     *
+     * Each component array starts on a \c DynamicAlignment boundary. The
+     * vectors themselves are accessed through strided views, which work
+     * with every vector operator.
+     *
+     */
+    template <typename T, std::size_t N>
+    class VectorBatch {
+        
+        static_assert(N != Dynamic, "The size of the vectors of a batch must be known at compile time");
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // type definitions
+        // --------------------------------------------------------------------
+        
+        typedef T                           value_type;
+        typedef Vector<T, N>                vector_type;
+        typedef Vector<T, N, Dynamic>       reference;
+        typedef Vector<T, Dynamic, 1>       component_type;
+        typedef std::size_t                 size_type;
+        
+        static constexpr std::size_t components = N;
+        
+    private:
+        
+        // component arrays, \c _stride elements apart
+        T* _elements;
+        
+        // number of vectors
+        std::size_t _size;
+        
+        // number of vectors rounded up to keep component arrays aligned
+        std::size_t _stride;
+        
+        static std::size_t strideFor(std::size_t const& n) {
+            constexpr std::size_t A = DynamicAlignment / sizeof(T) > 0 ? DynamicAlignment / sizeof(T) : 1;
+            return (n + A - 1) / A * A;
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // default constructor, no vector
+        VectorBatch() : _elements(nullptr), _size(0), _stride(0) {}
+        
+        // batch of \c n uninitialized vectors
+        explicit VectorBatch(size_type const& n)
+            : _elements(alignedAllocate<T>(N * strideFor(n))), _size(n), _stride(strideFor(n)) {}
+        
+        // batch of \c n copies of \c value
+        VectorBatch(size_type const& n, vector_type const& value) : VectorBatch(n) {
+            for (std::size_t k(0); k < N; k++) {
+                T* c = _elements + k * _stride;
+                for (std::size_t i(0); i < _size; i++) {
+                    c[i] = value[k];
+                }
+            }
+        }
+        
+        // gathers \c n vectors stored contiguously at \c t
+        VectorBatch(vector_type const* t, size_type const& n) : VectorBatch(n) {
+            for (std::size_t i(0); i < _size; i++) {
+                for (std::size_t k(0); k < N; k++) {
+                    _elements[k * _stride + i] = t[i][k];
+                }
+            }
+        }
+        
+        // copy constructor
+        VectorBatch(VectorBatch<T, N> const& rhs) : VectorBatch(rhs._size) {
+            copy(rhs);
+        }
+        
+        // move constructor, stealing the storage of \c rhs
+        VectorBatch(VectorBatch<T, N>&& rhs) noexcept
+            : _elements(rhs._elements), _size(rhs._size), _stride(rhs._stride) {
+            rhs._elements = nullptr;
+            rhs._size = 0;
+            rhs._stride = 0;
+        }
+        
+        // a VectorBatch can be constructed from any batch expression, forcing
+        // its evaluation
+        template <typename BatchExpression, EnableIfBatchExpression<BatchExpression> = 0>
+        VectorBatch(BatchExpression const& rhs) : VectorBatch(rhs.size()) {
+            static_assert(BatchExpression::components == N, "Vector dimensions must agree");
+            evaluateBatch<Assign>(rhs);
+        }
+        
+        ~VectorBatch() {
+            alignedFree(_elements, N * _stride);
+        }
+        
+        // --------------------------------------------------------------------
+        // size
+        // --------------------------------------------------------------------
+        
+        // number of vectors
+        size_type size() const {
+            return _size;
+        }
+        
+        bool empty() const {
+            return _size == 0;
+        }
+        
+        // distance between two consecutive components of a vector
+        size_type stride() const {
+            return _stride;
+        }
+        
+        // reallocates the storage when the number of vectors changes, the
+        // vectors being left uninitialized
+        void resize(size_type const& n) {
+            if (strideFor(n) != _stride) {
+                alignedFree(_elements, N * _stride);
+                _elements = alignedAllocate<T>(N * strideFor(n));
+                _stride = strideFor(n);
+            }
+            _size = n;
+        }
+        
+        // --------------------------------------------------------------------
+        // methods
+        // --------------------------------------------------------------------
+        
+        // view of the \c i-th vector
+        reference operator[](size_type const& i) {
+            ASSERT(i < _size, "Index (" << i << ") out of bounds in VectorBatch of size " << _size);
+            return reference(_elements + i, _stride);
+        }
+        
+        vector_type operator[](size_type const& i) const {
+            ASSERT(i < _size, "Index (" << i << ") out of bounds in VectorBatch of size " << _size);
+            vector_type result;
+            for (std::size_t k(0); k < N; k++) {
+                result[k] = _elements[k * _stride + i];
+            }
+            return result;
+        }
+        
+        // view of the \c k-th component of every vector
+        component_type component(size_type const& k) {
+            ASSERT(k < N, "Component (" << k << ") out of bounds in VectorBatch of vectors of size " << N);
+            return component_type(_elements + k * _stride, _size);
+        }
+        
+        // scatters the vectors to contiguous memory at \c t
+        void scatter(vector_type* t) const {
+            for (std::size_t i(0); i < _size; i++) {
+                for (std::size_t k(0); k < N; k++) {
+                    t[i][k] = _elements[k * _stride + i];
+                }
+            }
+        }
+        
+        // pointer to the data
+        T* data() {
+            return _elements;
+        }
+        
+        // const pointer to the data
+        const T* data() const {
+            return _elements;
+        }
+        
+        // --------------------------------------------------------------------
+        // operators
+        // --------------------------------------------------------------------
+        
+        // component \c k of the \c i-th vector
+        T operator()(size_type const& k, size_type const& i) const {
+            return _elements[k * _stride + i];
+        }
+        
+        T& operator()(size_type const& k, size_type const& i) {
+            return _elements[k * _stride + i];
+        }
+        
+        VectorBatch<T, N>& operator=(VectorBatch<T, N> const& rhs) {
+            if (this != &rhs) {
+                resize(rhs._size);
+                copy(rhs);
+            }
+            return *this;
+        }
+        
+        VectorBatch<T, N>& operator=(VectorBatch<T, N>&& rhs) noexcept {
+            std::swap(_elements, rhs._elements);
+            std::swap(_size, rhs._size);
+            std::swap(_stride, rhs._stride);
+            return *this;
+        }
+        
+        template <typename BatchExpression, EnableIfBatchExpression<BatchExpression> = 0>
+        VectorBatch<T, N>& operator=(BatchExpression const& rhs) {
+            static_assert(BatchExpression::components == N, "Vector dimensions must agree");
+            if (rhs.size() != _size) {
+                // resizing first would release memory the expression may read
+                return *this = VectorBatch<T, N>(rhs);
+            }
+            evaluateBatch<Assign>(rhs);
+            return *this;
+        }
+        
+        template <typename BatchExpression, EnableIfBatchExpression<BatchExpression> = 0>
+        VectorBatch<T, N>& operator+=(BatchExpression const& rhs) {
+            static_assert(BatchExpression::components == N, "Vector dimensions must agree");
+            ASSERT(rhs.size() == _size, "Batch sizes must agree");
+            evaluateBatch<AddAssign>(rhs);
+            return *this;
+        }
+        
+        template <typename BatchExpression, EnableIfBatchExpression<BatchExpression> = 0>
+        VectorBatch<T, N>& operator-=(BatchExpression const& rhs) {
+            static_assert(BatchExpression::components == N, "Vector dimensions must agree");
+            ASSERT(rhs.size() == _size, "Batch sizes must agree");
+            evaluateBatch<SubAssign>(rhs);
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // packet evaluation
+        // --------------------------------------------------------------------
+        
+        static constexpr bool vectorizable = Packet<T>::size > 1;
+        
+        // component \c k of vectors i to i + P::size - 1
+        template <typename P>
+        typename P::type packet(size_type const& k, size_type const& i) const {
+            return P::load(_elements + k * _stride + i);
+        }
+        
+    private:
+        
+        // copies the vectors of a batch of the same size, leaving the padding
+        // at the end of each component array untouched
+        void copy(VectorBatch<T, N> const& rhs) {
+            for (std::size_t k(0); k < N; k++) {
+                for (std::size_t i(0); i < _size; i++) {
+                    _elements[k * _stride + i] = rhs._elements[k * _stride + i];
+                }
+            }
+        }
+        
+        /**
+         *
+         * Evaluates \c e into the batch through \c Op, a packet of vectors at
+         * a time, from \c EXPAND_PARALLEL_THRESHOLD elements on by several
+         * threads.
+         *
+         * Every component of the packet is computed before any is stored,
+         * so that \c e may read the vectors it is assigned to, as in
+         * \c u = cross(u, v).
+         *
+         */
+        template <typename Op, typename E>
+        void evaluateBatch(E const& e) {
+            if (N * _size >= EXPAND_PARALLEL_THRESHOLD) {
+                parallelFor(_size, parallelGrain<T>(N * _size, N * Packet<T>::size) / N, [&](std::size_t begin, std::size_t end) {
+                    evaluateBatchRange<Op>(e, begin, end);
+                });
+            } else {
+                evaluateBatchRange<Op>(e, 0, _size);
+            }
+        }
+        
+        // evaluates vectors [\c begin, \c end) of \c e
+        template <typename Op, typename E>
+        void evaluateBatchRange(E const& e, std::size_t const& begin, std::size_t const& end) {
+            std::size_t i(begin);
+            if constexpr (E::vectorizable && std::is_same<typename E::value_type, T>::value) {
+                typedef Packet<T> P;
+                for (; i + P::size <= end; i += P::size) {
+                    typename P::type r[N];
+                    for (std::size_t k(0); k < N; k++) {
+                        r[k] = e.template packet<P>(k, i);
+                    }
+                    for (std::size_t k(0); k < N; k++) {
+                        T* d = _elements + k * _stride + i;
+                        P::store(d, Op::apply(P::load(d), r[k]));
+                    }
+                }
+            }
+            for (; i < end; i++) {
+                T r[N];
+                for (std::size_t k(0); k < N; k++) {
+                    r[k] = static_cast<T>(e(k, i));
+                }
+                for (std::size_t k(0); k < N; k++) {
+                    T* d = _elements + k * _stride + i;
+                    *d = Op::apply(*d, r[k]);
+                }
+            }
+        }
+    };
+}
+
+EXPAND_PSABI_END
+
+#endif /* VectorBatch_h */
@@ -0,0 +1,171 @@
+//
+//  VectorEval.h
+//  Expand
+//
+
+#ifndef VectorEval_h
+#define VectorEval_h
+
+#include <type_traits>
+#include <utility>
+
+#include "Check.h"
+#include "Dispatch.h"
+#include "Packet.h"
+#include "ThreadPool.h"
+
+// largest number of elements of the fixed-size vectors and matrices whose
+// evaluation is fully unrolled at compile time
+#ifndef EXPAND_UNROLL_LIMIT
+#   define EXPAND_UNROLL_LIMIT 16
+#endif
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // assignment operators
+    // --------------------------------------------------------------------
+    
+    // applied to both scalars and packets: \c d is the current content of
+    // the destination and \c s the evaluated expression
+    struct Assign {
+        template <typename X>
+        static constexpr X apply(X const&, X const& s) {
+            return s;
+        }
+    };
+    
+    struct AddAssign {
+        template <typename X>
+        static constexpr X apply(X const& d, X const& s) {
+            return d + s;
+        }
+    };
+    
+    struct SubAssign {
+        template <typename X>
+        static constexpr X apply(X const& d, X const& s) {
+            return d - s;
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // evaluation kernels
+    // --------------------------------------------------------------------
+    
+    // true for expressions evaluated as a whole by a dedicated kernel,
+    // exposed as evaluateTo<Op>(dst, step, n) by vector expressions and as
+    // evaluateTo<Op>(dst, ld) by matrix expressions, rather than element-wise
+    template <typename E>
+    struct HasEvaluateTo : std::false_type {};
+    
+    // true for expressions holding a sum or difference evaluated as a fused
+    // multiply-add anywhere in their tree
+    template <typename E>
+    struct HasFusedNode : std::false_type {};
+    
+    // element \c i of expression \c e as evaluated by the kernels of packets
+    // of \c W bytes: where these fuse the multiply-adds of \c e the scalar
+    // path does not, as a packet of a single lane, so that the elements left
+    // over by the packets round alike
+    template <std::size_t W, typename E>
+    inline auto kernelElement(E const& e, std::size_t const& i) {
+        typedef typename Widened<typename E::value_type>::type C;
+        if constexpr (E::vectorizable && HasFusedNode<E>::value &&
+                      hasFusedMultiplyAdd<C, W>() != hasFusedMultiplyAdd<C>()) {
+            return e.template packet<Packet<C, W, false>>(i);
+        } else {
+            return element(e, i);
+        }
+    }
+    
+    // evaluates elements [\c begin, \c end) of expression \c e into memory at
+    // \c dst, which holds element 0, in packets of \c W bytes, elements of
+    // reduced precision being widened when loaded and rounded once stored
+    template <typename Op, std::size_t W, typename T, typename E>
+    inline void evaluateRange(T* dst, std::size_t const& step, std::size_t const& begin,
+                              std::size_t const& end, E const& e) {
+        typedef typename Widened<T>::type C;
+        std::size_t i(begin);
+        if constexpr (E::vectorizable && std::is_same<C, typename Widened<typename E::value_type>::type>::value) {
+            typedef Packet<C, W> P;
+            if (step == 1) {
+                for (; i + P::size <= end; i += P::size) {
+                    P::store(dst + i, Op::apply(P::load(dst + i), e.template packet<P>(i)));
+                }
+            }
+        }
+        // counted from a local bound, which keeps the compiler from
+        // reasoning about the overflow of i * step
+        std::size_t const n = end - i;
+        T* const d = dst + i * step;
+        for (std::size_t k(0); k < n; k++) {
+            d[k * step] = static_cast<T>(Op::apply(static_cast<C>(d[k * step]), static_cast<C>(kernelElement<W>(e, i + k))));
+        }
+    }
+    
+    // the same, in code compiled for the instruction set selected at runtime
+    template <typename Op, typename T, typename E>
+    inline void evaluateRange(T* dst, std::size_t const& step, std::size_t const& begin,
+                              std::size_t const& end, E const& e) {
+        dispatch([&](auto w) {
+            evaluateRange<Op, decltype(w)::value>(dst, step, begin, end, e);
+        });
+    }
+    
+    /**
+     *
+     * Evaluates the \c n elements of expression \c e into memory at \c dst,
+     * consecutive elements being \c step apart, combining them with the
+     * current content through \c Op.
+     *
+     * Contiguous destinations are processed one packet at a time when the
+     * whole expression tree is vectorizable, remaining elements being
+     * evaluated one by one, by a kernel compiled for the instruction set
+     * selected at runtime.
+     *
+     * From \c EXPAND_PARALLEL_THRESHOLD elements on, the evaluation is split
+     * into cache-sized chunks run by the thread pool. Chunks start on whole
+     * packets, and each element only depends on the operands at the same
+     * index, so they can be evaluated in any order.
+     *
+     */
+    template <typename Op, typename T, typename E>
+    inline void evaluate(T* dst, std::size_t const& step, std::size_t const& n, E const& e) {
+        if constexpr (HasEvaluateTo<E>::value) {
+            e.template evaluateTo<Op>(dst, step, n);
+            return;
+        }
+        if (n >= EXPAND_PARALLEL_THRESHOLD) {
+            parallelFor(n, parallelGrain<T>(n, Packet<typename Widened<T>::type>::size), [&](std::size_t begin, std::size_t end) {
+                evaluateRange<Op>(dst, step, begin, end, e);
+            });
+            return;
+        }
+        evaluateRange<Op>(dst, step, 0, n, e);
+    }
+    
+    /**
+     *
+     * Evaluates the elements \c I of expression \c e into memory at \c dst,
+     * consecutive elements being \c S apart, combining them with the
+     * current content through \c Op.
+     *
+     * The evaluation is fully unrolled and can take place at compile time.
+     * Every element is computed before any is stored, so that \c e may read
+     * the memory it is assigned to.
+     *
+     */
+    template <typename Op, std::size_t S, typename T, typename E, std::size_t... I>
+    constexpr void evaluateUnrolled(T* dst, E const& e, std::index_sequence<I...>) {
+        typedef typename Widened<T>::type C;
+        C const r[] = {static_cast<C>(element(e, I))...};
+        ((dst[I * S] = static_cast<T>(Op::apply(static_cast<C>(dst[I * S]), r[I]))), ...);
+    }
+}
+
+EXPAND_PSABI_END
+
+#endif /* VectorEval_h */
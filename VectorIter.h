@@ -6,181 +6,203 @@
 #ifndef VectorIter_h
 #define VectorIter_h
 
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "VectorMemory.h"
+
 namespace expand {
     
-    template <typename T, std::size_t N, std::size_t S>
+    template <typename T, std::size_t N, std::size_t S, typename A>
     class Vector;
     
-    template <typename T, std::size_t N, std::size_t S>
-    class VectorIter {
+    template <typename T, std::size_t N, std::size_t S, typename A>
+    class VectorIterConst;
+    
+    /**
+     *
+     * Distance between the consecutive elements of a Vector of stride \c S
+     * as seen by its iterators, only held by the iterators of views whose
+     * stride is known at runtime.
+     *
+     */
+    template <std::size_t S>
+    class IterStride {
+        
+    public:
+        
+        constexpr IterStride(std::ptrdiff_t const&) {}
+        
+        static constexpr std::ptrdiff_t stride() {
+            return S == 0 ? 1 : std::ptrdiff_t(S);
+        }
+    };
+    
+    template <>
+    class IterStride<Dynamic> {
+        
+        std::ptrdiff_t _stride;
+        
+    public:
+        
+        constexpr IterStride(std::ptrdiff_t const& stride) : _stride(stride) {}
+        
+        constexpr std::ptrdiff_t stride() const {
+            return _stride;
+        }
+    };
+    
+    /**
+     *
+     * Random-access iterator over the elements of a Vector, contiguous for
+     * a stride \c S of 0 or 1.
+     *
+     */
+    template <typename T, std::size_t N, std::size_t S, typename A>
+    class VectorIter : private IterStride<S> {
+        
+        friend class VectorIterConst<T, N, S, A>;
+        
+    public:
         
         // --------------------------------------------------------------------
         // STL-compatible type definitions
         // --------------------------------------------------------------------
         
-        typedef typename Vector<T, N, S>::value_type        value_type;
-        typedef typename Vector<T, N, S>::reference         reference;
-        typedef typename Vector<T, N, S>::const_reference   const_reference;
-        typedef typename Vector<T, N, S>::difference_type   difference_type;
-        typedef typename Vector<T, N, S>::size_type         size_type;
-        
-        typedef std::forward_iterator_tag                   iterator_category;
+        typedef T                               value_type;
+        typedef T&                              reference;
+        typedef T*                              pointer;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef std::random_access_iterator_tag iterator_category;
+#if __cplusplus > 201703L
+        typedef typename std::conditional<S == 0 || S == 1, std::contiguous_iterator_tag,
+                                          std::random_access_iterator_tag>::type iterator_concept;
+#endif
         
     protected:
         
         T* _elements;
         
+        using IterStride<S>::stride;
+        
     public:
         
         // --------------------------------------------------------------------
         // constructors
         // --------------------------------------------------------------------
         
-        VectorIter(Vector<T, N, S>& vec, bool const& end = false) : _elements(vec._elements) {
+        VectorIter() : IterStride<S>(0), _elements(nullptr) {}
+        
+        // first element of \c vec, or one past its last element for \c end
+        VectorIter(Vector<T, N, S, A>& vec, bool const& end = false)
+            : IterStride<S>(std::ptrdiff_t(vec.step())), _elements(vec._elements) {
             if (end) {
-                _elements += vec.size() * S;
+                _elements += std::ptrdiff_t(vec.size()) * stride();
             }
         }
         
         // --------------------------------------------------------------------
-        // needed methods for STL container conformance
+        // access
         // --------------------------------------------------------------------
         
-        // iterator
-        
-        VectorIter<T, N, S>& operator=(VectorIter<T, N, S> const& other) {}
-        
-        // prefix increment
-        VectorIter<T, N, S>& operator++() {
-            _elements += S;
-            return *this;
-        }
-        
-        T& operator*() {
+        T& operator*() const {
             return *_elements;
         }
         
-        void swap(VectorIter<T, N, S>& rhs) {
-            (*this) = rhs;
+        T* operator->() const {
+            return _elements;
         }
         
-        // input iterator
-        
-        // postfix increment
-        VectorIter<T, N, S> operator++(int) {
-            VectorIter<T, N, S> ret(*this);
-            _elements += S;
-            return ret;
-        }
-        
-        T operator*() const {
-            return *_elements;
+        T& operator[](difference_type const& i) const {
+            return _elements[i * stride()];
         }
         
         // --------------------------------------------------------------------
-        // operators
+        // moves
         // --------------------------------------------------------------------
         
-        T operator[](std::size_t const& i) const {
-            return _elements[i * S];
+        VectorIter<T, N, S, A>& operator++() {
+            _elements += stride();
+            return *this;
         }
         
-        T& operator[](std::size_t const& i) {
-            return _elements[i * S];
+        VectorIter<T, N, S, A> operator++(int) {
+            VectorIter<T, N, S, A> ret(*this);
+            ++(*this);
+            return ret;
         }
         
-        bool operator==(VectorIter<T, N, S> const& other) const {
-            return other._elements == _elements;
+        VectorIter<T, N, S, A>& operator--() {
+            _elements -= stride();
+            return *this;
         }
         
-        bool operator!=(VectorIter<T, N, S> const& other) const {
-            return other._elements != _elements;
+        VectorIter<T, N, S, A> operator--(int) {
+            VectorIter<T, N, S, A> ret(*this);
+            --(*this);
+            return ret;
         }
-    };
-    
-    /**
-     *
-     * Specialization.
-     *
-     */
-    template <typename T, std::size_t N>
-    class VectorIter<T, N, 0> {
-        
-        // STL-compatible type definitions
-        
-        typedef typename Vector<T, N, 0>::value_type        value_type;
-        typedef typename Vector<T, N, 0>::reference         reference;
-        typedef typename Vector<T, N, 0>::const_reference   const_reference;
-        typedef typename Vector<T, N, 0>::difference_type   difference_type;
-        typedef typename Vector<T, N, 0>::size_type         size_type;
-        
-        typedef std::forward_iterator_tag                   iterator_category;
-        
-    protected:
         
-        T* _elements;
-        
-    public:
-        
-        VectorIter(Vector<T, N, 0>& vec, bool const& end = false) : _elements(vec._elements) {
-            if (end) {
-                _elements += vec.size();
-            }
+        VectorIter<T, N, S, A>& operator+=(difference_type const& n) {
+            _elements += n * stride();
+            return *this;
         }
         
-        T operator[](std::size_t const& i) const {
-            return _elements[i];
+        VectorIter<T, N, S, A>& operator-=(difference_type const& n) {
+            _elements -= n * stride();
+            return *this;
         }
         
-        T& operator[](std::size_t const& i) {
-            return _elements[i];
+        VectorIter<T, N, S, A> operator+(difference_type const& n) const {
+            VectorIter<T, N, S, A> ret(*this);
+            return ret += n;
         }
         
-        // needed methods for STL iterator conformance
-        
-        // iterator
-        
-        VectorIter<T, N, 0>& operator=(VectorIter<T, N, 0> const& other) {
-            
+        friend VectorIter<T, N, S, A> operator+(difference_type const& n, VectorIter<T, N, S, A> const& it) {
+            return it + n;
         }
         
-        // prefix increment
-        VectorIter<T, N, 0>& operator++() {
-            _elements++;
-            return *this;
+        VectorIter<T, N, S, A> operator-(difference_type const& n) const {
+            VectorIter<T, N, S, A> ret(*this);
+            return ret -= n;
         }
         
-        T& operator*() {
-            return *_elements;
+        difference_type operator-(VectorIter<T, N, S, A> const& other) const {
+            return (_elements - other._elements) / stride();
         }
         
-        void swap(VectorIter<T, N, 0>& rhs) {
-            (*this) = rhs;
+        void swap(VectorIter<T, N, S, A>& rhs) {
+            std::swap(*this, rhs);
         }
         
-        // input iterator
+        // --------------------------------------------------------------------
+        // comparisons
+        // --------------------------------------------------------------------
         
-        // postfix increment
-        VectorIter<T, N, 0> operator++(int) {
-            VectorIter<T, N, 0> ret(*this);
-            _elements++;
-            return ret;
+        bool operator==(VectorIter<T, N, S, A> const& other) const {
+            return _elements == other._elements;
         }
         
-        T operator*() const {
-            return *_elements;
+        bool operator!=(VectorIter<T, N, S, A> const& other) const {
+            return _elements != other._elements;
+        }
+        
+        bool operator<(VectorIter<T, N, S, A> const& other) const {
+            return *this - other < 0;
         }
         
-        // pointer operator->() const;
+        bool operator>(VectorIter<T, N, S, A> const& other) const {
+            return other < *this;
+        }
         
-        template <std::size_t S>
-        bool operator==(VectorIter<T, N, S> const& other) const {
-            return other._elements == _elements;
+        bool operator<=(VectorIter<T, N, S, A> const& other) const {
+            return !(other < *this);
         }
         
-        template <std::size_t S>
-        bool operator!=(VectorIter<T, N, S> const& other) const {
-            return other._elements != _elements;
+        bool operator>=(VectorIter<T, N, S, A> const& other) const {
+            return !(*this < other);
         }
     };
 }
@@ -6,30 +6,51 @@
 #ifndef VectorIterConst_h
 #define VectorIterConst_h
 
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "VectorIter.h"
+
 namespace expand {
     
-    template <typename T, std::size_t N, std::size_t S>
+    template <typename T, std::size_t N, std::size_t S, typename A>
     class Vector;
     
-    template <typename T, std::size_t N, std::size_t S>
-    class VectorIterConst {
+    template <typename T, std::size_t N, std::size_t S, typename A>
+    class VectorIter;
+    
+    /**
+     *
+     * Random-access iterator over the constant elements of a Vector,
+     * contiguous for a stride \c S of 0 or 1.
+     *
+     */
+    template <typename T, std::size_t N, std::size_t S, typename A>
+    class VectorIterConst : private IterStride<S> {
+        
+    public:
         
         // --------------------------------------------------------------------
         // STL-compatible type definitions
         // --------------------------------------------------------------------
         
-        typedef typename Vector<T, N, S>::value_type        value_type;
-        typedef typename Vector<T, N, S>::reference         reference;
-        typedef typename Vector<T, N, S>::const_reference   const_reference;
-        typedef typename Vector<T, N, S>::difference_type   difference_type;
-        typedef typename Vector<T, N, S>::size_type         size_type;
-        
-        typedef std::forward_iterator_tag                   iterator_category;
+        typedef T                               value_type;
+        typedef const T&                        reference;
+        typedef const T*                        pointer;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef std::random_access_iterator_tag iterator_category;
+#if __cplusplus > 201703L
+        typedef typename std::conditional<S == 0 || S == 1, std::contiguous_iterator_tag,
+                                          std::random_access_iterator_tag>::type iterator_concept;
+#endif
         
     protected:
         
-        // data
-        T* _elements;
+        const T* _elements;
+        
+        using IterStride<S>::stride;
         
     public:
         
@@ -37,158 +58,119 @@ namespace expand {
         // constructors
         // --------------------------------------------------------------------
         
-        VectorIterConst(Vector<T, N, S>& vec, bool const& end = false) {
+        VectorIterConst() : IterStride<S>(0), _elements(nullptr) {}
+        
+        // first element of \c vec, or one past its last element for \c end
+        VectorIterConst(Vector<T, N, S, A> const& vec, bool const& end = false)
+            : IterStride<S>(std::ptrdiff_t(vec.step())), _elements(vec._elements) {
             if (end) {
-                _elements = const_cast<T*>(vec._elements + vec.size() * S);
-            } else {
-                _elements = const_cast<T*>(vec._elements);
+                _elements += std::ptrdiff_t(vec.size()) * stride();
             }
         }
         
+        // iterators convert to constant iterators
+        VectorIterConst(VectorIter<T, N, S, A> const& it) : IterStride<S>(it.stride()), _elements(it._elements) {}
+        
         // --------------------------------------------------------------------
-        // needed methods for STL container conformance
+        // access
         // --------------------------------------------------------------------
         
-        // iterator
-        
-        VectorIterConst<T, N, S>& operator=(VectorIterConst<T, N, S> const& other) {}
-        
-        // prefix increment
-        VectorIterConst<T, N, S>& operator++() {
-            _elements += S;
-            return *this;
+        const T& operator*() const {
+            return *_elements;
         }
         
-        T& operator*() {
-            return *_elements;
+        const T* operator->() const {
+            return _elements;
         }
         
-        void swap(VectorIterConst<T, N, S>& rhs) {
-            (*this) = rhs;
+        const T& operator[](difference_type const& i) const {
+            return _elements[i * stride()];
         }
         
-        // input iterator
+        // --------------------------------------------------------------------
+        // moves
+        // --------------------------------------------------------------------
         
-        // postfix increment
-        VectorIterConst<T, N, S> operator++(int) {
-            VectorIterConst<T, N, S> ret(*this);
-            _elements += S;
-            return ret;
+        VectorIterConst<T, N, S, A>& operator++() {
+            _elements += stride();
+            return *this;
         }
         
-        T operator*() const {
-            return *_elements;
+        VectorIterConst<T, N, S, A> operator++(int) {
+            VectorIterConst<T, N, S, A> ret(*this);
+            ++(*this);
+            return ret;
         }
         
-        // pointer operator->() const;
-        
-        bool operator==(VectorIterConst<T, N, S> const& other) const {
-            return other._elements == _elements;
+        VectorIterConst<T, N, S, A>& operator--() {
+            _elements -= stride();
+            return *this;
         }
         
-        bool operator!=(VectorIterConst<T, N, S> const& other) const {
-            return other._elements != _elements;
+        VectorIterConst<T, N, S, A> operator--(int) {
+            VectorIterConst<T, N, S, A> ret(*this);
+            --(*this);
+            return ret;
         }
         
-        T operator[](std::size_t const& i) const {
-            return _elements[i * S];
+        VectorIterConst<T, N, S, A>& operator+=(difference_type const& n) {
+            _elements += n * stride();
+            return *this;
         }
         
-        T& operator[](std::size_t const& i) {
-            return _elements[i * S];
+        VectorIterConst<T, N, S, A>& operator-=(difference_type const& n) {
+            _elements -= n * stride();
+            return *this;
         }
-    };
-    
-    /**
-     *
-     * Specialization.
-     *
-     */
-    template <typename T, std::size_t N>
-    class VectorIterConst<T, N, 0> {
         
-        // --------------------------------------------------------------------
-        // STL-compatible type definitions
-        // --------------------------------------------------------------------
-        
-        typedef typename Vector<T, N, 0>::value_type        value_type;
-        typedef typename Vector<T, N, 0>::reference         reference;
-        typedef typename Vector<T, N, 0>::const_reference   const_reference;
-        typedef typename Vector<T, N, 0>::difference_type   difference_type;
-        typedef typename Vector<T, N, 0>::size_type         size_type;
-        
-        typedef std::forward_iterator_tag                   iterator_category;
-        
-    protected:
-        
-        // data
-        T* _elements;
-        
-    public:
-        
-        VectorIterConst(Vector<T, N, 0>& vec, bool const& end = false) {
-            if (end) {
-                _elements = const_cast<T*>(vec._elements + vec.size());
-            } else {
-                _elements = const_cast<T*>(vec._elements);
-            }
+        VectorIterConst<T, N, S, A> operator+(difference_type const& n) const {
+            VectorIterConst<T, N, S, A> ret(*this);
+            return ret += n;
         }
         
-        // --------------------------------------------------------------------
-        // needed methods for STL iterator conformance
-        // --------------------------------------------------------------------
-        
-        // iterator
-        
-        VectorIterConst<T, N, 0>& operator=(VectorIterConst<T, N, 0> const& other) {
-            
+        friend VectorIterConst<T, N, S, A> operator+(difference_type const& n, VectorIterConst<T, N, S, A> const& it) {
+            return it + n;
         }
         
-        // prefix increment
-        VectorIterConst<T, N, 0>& operator++() {
-            _elements++;
-            return *this;
+        VectorIterConst<T, N, S, A> operator-(difference_type const& n) const {
+            VectorIterConst<T, N, S, A> ret(*this);
+            return ret -= n;
         }
         
-        T& operator*() {
-            return *_elements;
+        difference_type operator-(VectorIterConst<T, N, S, A> const& other) const {
+            return (_elements - other._elements) / stride();
         }
         
-        void swap(VectorIterConst<T, N, 0>& rhs) {
-            (*this) = rhs;
+        void swap(VectorIterConst<T, N, S, A>& rhs) {
+            std::swap(*this, rhs);
         }
         
-        // input iterator
+        // --------------------------------------------------------------------
+        // comparisons
+        // --------------------------------------------------------------------
         
-        // postfix increment
-        VectorIterConst<T, N, 0> operator++(int) {
-            VectorIterConst<T, N, 0> ret(*this);
-            _elements++;
-            return ret;
+        bool operator==(VectorIterConst<T, N, S, A> const& other) const {
+            return _elements == other._elements;
         }
         
-        T operator*() const {
-            return *_elements;
+        bool operator!=(VectorIterConst<T, N, S, A> const& other) const {
+            return _elements != other._elements;
         }
         
-        // pointer operator->() const;
-        
-        template <std::size_t S>
-        bool operator==(VectorIterConst<T, N, S> const& other) const {
-            return other._elements == _elements;
+        bool operator<(VectorIterConst<T, N, S, A> const& other) const {
+            return *this - other < 0;
         }
         
-        template <std::size_t S>
-        bool operator!=(VectorIterConst<T, N, S> const& other) const {
-            return other._elements != _elements;
+        bool operator>(VectorIterConst<T, N, S, A> const& other) const {
+            return other < *this;
         }
         
-        T operator[](std::size_t const& i) const {
-            return _elements[i];
+        bool operator<=(VectorIterConst<T, N, S, A> const& other) const {
+            return !(other < *this);
         }
         
-        T& operator[](std::size_t const& i) {
-            return _elements[i];
+        bool operator>=(VectorIterConst<T, N, S, A> const& other) const {
+            return !(*this < other);
         }
     };
 }
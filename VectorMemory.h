@@ -6,13 +6,143 @@
 #ifndef Mem_h
 #define Mem_h
 
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "Check.h"
+#include "Half.h"
+#include "Packet.h"
+#include "VectorEval.h"
+
+EXPAND_PSABI_BEGIN
+
 namespace expand {
     
-    template <typename T, std::size_t N, std::size_t S>
+    // size of the Vector and Matrix instances whose dimensions are only
+    // known at runtime
+    constexpr std::size_t Dynamic = std::size_t(-1);
+    
+    // alignment in bytes of the heap storage of dynamic instances, a whole
+    // cache line which also suits the widest SIMD registers
+    constexpr std::size_t DynamicAlignment = 64;
+    
+    // width in bytes of the widest packets evaluated, those of AVX-512 when
+    // the instruction set is selected at runtime, on which the Aligned policy
+    // aligns and pads the storage
+    constexpr std::size_t AlignedBytes = EXPAND_DISPATCH && EXPAND_SIMD_BYTES < 64 ? 64 : EXPAND_SIMD_BYTES;
+    
+    // allocates storage for \c n elements aligned on \c DynamicAlignment
+    template <typename T>
+    T* alignedAllocate(std::size_t const& n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        T* pointer = static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(DynamicAlignment)));
+        std::uninitialized_default_construct_n(pointer, n);
+        return pointer;
+    }
+    
+    // releases storage obtained from \c alignedAllocate
+    template <typename T>
+    void alignedFree(T* const pointer, std::size_t const& n) {
+        if (pointer) {
+            std::destroy_n(pointer, n);
+            ::operator delete(pointer, std::align_val_t(DynamicAlignment));
+        }
+    }
+    
+    // --------------------------------------------------------------------
+    // storage policies
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Storage policies of the Vector and Matrix instances owning their
+     * elements, given as their last template parameter.
+     *
+     * \c Packed, the default, stores the elements back to back with their
+     * natural alignment.
+     *
+     * \c Aligned aligns the storage on the SIMD width and pads vectors and
+     * matrix rows to a whole number of packets, so that their evaluation
+     * needs no scalar tail, whichever the packets selected at runtime (see
+     * \c AlignedBytes). Rows spanning a multiple of 1024 bytes get one more
+     * packet of padding, as successive rows would otherwise map to the same
+     * cache sets. Padding never counts in the size of an instance.
+     *
+     */
+    struct Packed {
+        
+        // alignment in bytes of the storage
+        template <typename T>
+        static constexpr std::size_t alignment() {
+            return alignof(T);
+        }
+        
+        // number of elements stored for a vector of \c n elements
+        template <typename T>
+        static constexpr std::size_t padded(std::size_t const& n) {
+            return n;
+        }
+        
+        // distance between two consecutive rows of \c n elements
+        template <typename T>
+        static constexpr std::size_t leading(std::size_t const& n) {
+            return n;
+        }
+    };
+    
+    struct Aligned {
+        
+        template <typename T>
+        static constexpr std::size_t alignment() {
+            return alignof(T) > AlignedBytes ? alignof(T) : AlignedBytes;
+        }
+        
+        template <typename T>
+        static constexpr std::size_t padded(std::size_t const& n) {
+            return n == Dynamic ? Dynamic : (n + lanes<T>() - 1) / lanes<T>() * lanes<T>();
+        }
+        
+        template <typename T>
+        static constexpr std::size_t leading(std::size_t const& n) {
+            return n == Dynamic || n == 0 || padded<T>(n) * sizeof(typename Widened<T>::type) % 1024 != 0
+                ? padded<T>(n) : padded<T>(n) + lanes<T>();
+        }
+        
+    private:
+        
+        // elements evaluated at a time, reduced-precision ones being
+        // widened into packets, and hence padded like their widened type so
+        // that expressions mixing both address the same elements
+        template <typename T>
+        static constexpr std::size_t lanes() {
+            return Packet<typename Widened<T>::type, AlignedBytes>::size;
+        }
+    };
+    
+    template <typename T, std::size_t N, std::size_t S, typename A>
+    class Vector;
+    
+    template <typename T, std::size_t N, std::size_t S, typename A = Packed>
+    class VectorMemory;
+    
+    /**
+     *
+     * Storage of the elements of a Vector, referencing memory \c S elements
+     * apart unless \c S is 0, the storage policy \c A only applying to
+     * owning instances.
+     *
+     */
+    template <typename T, std::size_t N, std::size_t S, typename A>
     class VectorMemory {
         
     protected:
         
+        // policy of the bounds checks
+        typedef typename CheckPolicy<Vector<T, N, S, A>>::type Check;
+        
         // data
         T* _elements;
         
@@ -28,30 +158,78 @@ namespace expand {
         // construct as a reference to the memory pointed by \c pointer
         VectorMemory(T* const pointer) : _elements(pointer) {}
         
+        // construct as a reference to the \c n elements pointed by \c pointer
+        VectorMemory(T* const pointer, std::size_t const& n) : _elements(pointer) {
+            EXPAND_CHECK(Check, n == N, "Vector of size " << N << " cannot reference " << n << " elements");
+        }
+        
+        // copy constructor, referencing the same memory
+        VectorMemory(VectorMemory<T, N, S, A> const& rhs) = default;
+        
+        // assigning to a reference copies the referenced elements
+        VectorMemory<T, N, S, A>& operator=(VectorMemory<T, N, S, A> const& rhs) {
+            for (std::size_t i(0); i < N; i++) {
+                (*this)[i] = rhs[i];
+            }
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // size
+        // --------------------------------------------------------------------
+        
+        static constexpr std::size_t size() {
+            return N;
+        }
+        
+        // a reference cannot be resized
+        static void resize(std::size_t const& n) {
+            EXPAND_CHECK(Check, n == N, "Vector of size " << N << " cannot be resized to " << n);
+        }
+        
         // --------------------------------------------------------------------
         // operators
         // --------------------------------------------------------------------
         
         T operator[](std::size_t const& i) const {
-            ASSERT(i >= 0 && i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
+            EXPAND_CHECK(Check, i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
             return _elements[i * S];
         }
         
         T& operator[](std::size_t const& i) {
-            ASSERT(i >= 0 && i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
+            EXPAND_CHECK(Check, i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
             return _elements[i * S];
         }
         
         T operator()(std::size_t const& i) const {
-            ASSERT(i >= 0 && i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
             return (*this)[i];
         }
         
         T& operator()(std::size_t const& i) {
-            ASSERT(i >= 0 && i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
             return (*this)[i];
         }
         
+        // element \c i, without bounds checks
+        T unchecked(std::size_t const& i) const {
+            return _elements[i * S];
+        }
+        
+        T& unchecked(std::size_t const& i) {
+            return _elements[i * S];
+        }
+        
+        // --------------------------------------------------------------------
+        // packet evaluation
+        // --------------------------------------------------------------------
+        
+        static constexpr bool vectorizable = Packet<typename Widened<T>::type>::size > 1;
+        
+        // lanes i to i + P::size - 1
+        template <typename P>
+        typename P::type packet(std::size_t const& i) const {
+            return S == 1 ? P::load(_elements + i) : P::gather(_elements + i * S, S);
+        }
+        
         // --------------------------------------------------------------------
         // getters
         // --------------------------------------------------------------------
@@ -71,13 +249,23 @@ namespace expand {
      * Specialization for \c VectorMemory instances having their own memory.
      *
      */
-    template <typename T, std::size_t N>
-    class VectorMemory<T, N, 0> {
+    template <typename T, std::size_t N, typename A>
+    class VectorMemory<T, N, 0, A> {
         
     protected:
         
-        // data
-        T _elements[N];
+        // policy of the bounds checks
+        typedef typename CheckPolicy<Vector<T, N, 0, A>>::type Check;
+        
+        // data, followed by the padding required by \c A
+        alignas(A::template alignment<T>()) T _elements[A::template padded<T>(N)];
+        
+        // padding elements are zeroed so that evaluating them is harmless
+        void clearPadding() {
+            for (std::size_t i(N); i < A::template padded<T>(N); i++) {
+                _elements[i] = T();
+            }
+        }
         
     public:
 
@@ -86,19 +274,429 @@ namespace expand {
         // --------------------------------------------------------------------
         
         // default constructor
-        VectorMemory() {}
+        VectorMemory() {
+            clearPadding();
+        }
         
-        // copy constructor
-        VectorMemory(VectorMemory<T, N, 0> const& rhs) {
+        // copy elements from memory
+        VectorMemory(const T* pointer) {
+            for (std::size_t i = 0; i < N; i++) {
+                (*this)[i] = pointer[i];
+            }
+            clearPadding();
+        }
+        
+        // storage for \c n elements, which must be \c N; small vectors are
+        // value-initialized so that they can be built at compile time
+        constexpr explicit VectorMemory(std::size_t const& n)
+            : VectorMemory(n, std::integral_constant<bool, N <= EXPAND_UNROLL_LIMIT>()) {}
+        
+    private:
+        
+        constexpr VectorMemory(std::size_t const& n, std::true_type) : _elements() {
+            resize(n);
+        }
+        
+        VectorMemory(std::size_t const& n, std::false_type) {
+            resize(n);
+            clearPadding();
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // size
+        // --------------------------------------------------------------------
+        
+        static constexpr std::size_t size() {
+            return N;
+        }
+        
+        // fixed-size storage cannot be resized
+        static constexpr void resize(std::size_t const& n) {
+            EXPAND_CHECK(Check, n == N, "Vector of size " << N << " cannot be resized to " << n);
+        }
+        
+        // --------------------------------------------------------------------
+        // operators
+        // --------------------------------------------------------------------
+        
+        constexpr T operator[](std::size_t const& i) const {
+            EXPAND_CHECK(Check, i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
+            return _elements[i];
+        }
+        
+        constexpr T& operator[](std::size_t const& i) {
+            EXPAND_CHECK(Check, i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
+            return _elements[i];
+        }
+        
+        constexpr T operator()(std::size_t const& i) const {
+            return (*this)[i];
+        }
+        
+        constexpr T& operator()(std::size_t const& i) {
+            return (*this)[i];
+        }
+        
+        // element \c i, without bounds checks
+        constexpr T unchecked(std::size_t const& i) const {
+            return _elements[i];
+        }
+        
+        constexpr T& unchecked(std::size_t const& i) {
+            return _elements[i];
+        }
+        
+        // --------------------------------------------------------------------
+        // packet evaluation
+        // --------------------------------------------------------------------
+        
+        static constexpr bool vectorizable = Packet<typename Widened<T>::type>::size > 1;
+        
+        // lanes i to i + P::size - 1
+        template <typename P>
+        typename P::type packet(std::size_t const& i) const {
+            return P::load(_elements + i);
+        }
+        
+        // --------------------------------------------------------------------
+        // getters
+        // --------------------------------------------------------------------
+        
+        T* elements() {
+            return _elements;
+        }
+        
+        T* elements() const {
+            return const_cast<T*>(_elements);
+        }
+    };
+    
+    
+    /**
+     *
+     * Specialization for \c VectorMemory instances referencing elements
+     * whose distance in memory is only known at runtime.
+     *
+     */
+    template <typename T, std::size_t N, typename A>
+    class VectorMemory<T, N, Dynamic, A> {
+        
+    protected:
+        
+        // policy of the bounds checks
+        typedef typename CheckPolicy<Vector<T, N, Dynamic, A>>::type Check;
+        
+        // data
+        T* _elements;
+        
+        // distance between two consecutive elements
+        std::size_t _stride;
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // default constructor
+        VectorMemory() : _elements(nullptr), _stride(1) {}
+        
+        // construct as a reference to the memory pointed by \c pointer, with
+        // elements \c stride apart
+        VectorMemory(T* const pointer, std::size_t const& stride) : _elements(pointer), _stride(stride) {}
+        
+        // copy constructor, referencing the same memory
+        VectorMemory(VectorMemory<T, N, Dynamic, A> const& rhs) = default;
+        
+        // assigning to a reference copies the referenced elements
+        VectorMemory<T, N, Dynamic, A>& operator=(VectorMemory<T, N, Dynamic, A> const& rhs) {
             for (std::size_t i(0); i < N; i++) {
                 (*this)[i] = rhs[i];
             }
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // size
+        // --------------------------------------------------------------------
+        
+        static constexpr std::size_t size() {
+            return N;
+        }
+        
+        // a reference cannot be resized
+        static void resize(std::size_t const& n) {
+            EXPAND_CHECK(Check, n == N, "Vector of size " << N << " cannot be resized to " << n);
+        }
+        
+        std::size_t stride() const {
+            return _stride;
+        }
+        
+        // --------------------------------------------------------------------
+        // operators
+        // --------------------------------------------------------------------
+        
+        T operator[](std::size_t const& i) const {
+            EXPAND_CHECK(Check, i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
+            return _elements[i * _stride];
+        }
+        
+        T& operator[](std::size_t const& i) {
+            EXPAND_CHECK(Check, i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
+            return _elements[i * _stride];
+        }
+        
+        T operator()(std::size_t const& i) const {
+            return (*this)[i];
+        }
+        
+        T& operator()(std::size_t const& i) {
+            return (*this)[i];
+        }
+        
+        // element \c i, without bounds checks
+        T unchecked(std::size_t const& i) const {
+            return _elements[i * _stride];
+        }
+        
+        T& unchecked(std::size_t const& i) {
+            return _elements[i * _stride];
+        }
+        
+        // --------------------------------------------------------------------
+        // packet evaluation
+        // --------------------------------------------------------------------
+        
+        static constexpr bool vectorizable = Packet<typename Widened<T>::type>::size > 1;
+        
+        // lanes i to i + P::size - 1
+        template <typename P>
+        typename P::type packet(std::size_t const& i) const {
+            return P::gather(_elements + i * _stride, _stride);
+        }
+        
+        // --------------------------------------------------------------------
+        // getters
+        // --------------------------------------------------------------------
+        
+        T* elements() {
+            return _elements;
+        }
+        
+        T* elements() const {
+            return _elements;
+        }
+    };
+    
+    
+    /**
+     *
+     * Specialization for \c VectorMemory instances referencing a number of
+     * elements known at runtime.
+     *
+     */
+    template <typename T, std::size_t S, typename A>
+    class VectorMemory<T, Dynamic, S, A> {
+        
+    protected:
+        
+        // policy of the bounds checks
+        typedef typename CheckPolicy<Vector<T, Dynamic, S, A>>::type Check;
+        
+        // data
+        T* _elements;
+        
+        // number of elements
+        std::size_t _size;
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // default constructor
+        VectorMemory() : _elements(nullptr), _size(0) {}
+        
+        // construct as a reference to the \c n elements pointed by \c pointer
+        VectorMemory(T* const pointer, std::size_t const& n) : _elements(pointer), _size(n) {}
+        
+        // copy constructor, referencing the same memory
+        VectorMemory(VectorMemory<T, Dynamic, S, A> const& rhs) = default;
+        
+        // assigning to a reference copies the referenced elements
+        VectorMemory<T, Dynamic, S, A>& operator=(VectorMemory<T, Dynamic, S, A> const& rhs) {
+            resize(rhs._size);
+            for (std::size_t i(0); i < _size; i++) {
+                (*this)[i] = rhs[i];
+            }
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // size
+        // --------------------------------------------------------------------
+        
+        std::size_t size() const {
+            return _size;
+        }
+        
+        // a reference cannot be resized
+        void resize(std::size_t const& n) const {
+            EXPAND_CHECK(Check, n == _size, "Vector of size " << _size << " cannot be resized to " << n);
+        }
+        
+        // --------------------------------------------------------------------
+        // operators
+        // --------------------------------------------------------------------
+        
+        T operator[](std::size_t const& i) const {
+            EXPAND_CHECK(Check, i < _size, "Index (" << i << ") out of bounds in Vector of size " << _size);
+            return _elements[i * S];
+        }
+        
+        T& operator[](std::size_t const& i) {
+            EXPAND_CHECK(Check, i < _size, "Index (" << i << ") out of bounds in Vector of size " << _size);
+            return _elements[i * S];
+        }
+        
+        T operator()(std::size_t const& i) const {
+            return (*this)[i];
         }
         
+        T& operator()(std::size_t const& i) {
+            return (*this)[i];
+        }
+        
+        // element \c i, without bounds checks
+        T unchecked(std::size_t const& i) const {
+            return _elements[i * S];
+        }
+        
+        T& unchecked(std::size_t const& i) {
+            return _elements[i * S];
+        }
+        
+        // --------------------------------------------------------------------
+        // packet evaluation
+        // --------------------------------------------------------------------
+        
+        static constexpr bool vectorizable = Packet<typename Widened<T>::type>::size > 1;
+        
+        // lanes i to i + P::size - 1
+        template <typename P>
+        typename P::type packet(std::size_t const& i) const {
+            return S == 1 ? P::load(_elements + i) : P::gather(_elements + i * S, S);
+        }
+        
+        // --------------------------------------------------------------------
+        // getters
+        // --------------------------------------------------------------------
+        
+        T* elements() {
+            return _elements;
+        }
+        
+        T* elements() const {
+            return _elements;
+        }
+    };
+    
+    
+    /**
+     *
+     * Specialization for \c VectorMemory instances owning a number of
+     * elements known at runtime, stored on the heap.
+     *
+     */
+    template <typename T, typename A>
+    class VectorMemory<T, Dynamic, 0, A> {
+        
+    protected:
+        
+        // policy of the bounds checks
+        typedef typename CheckPolicy<Vector<T, Dynamic, 0, A>>::type Check;
+        
+        // data, aligned on \c DynamicAlignment and followed by the padding
+        // required by \c A
+        T* _elements;
+        
+        // number of elements
+        std::size_t _size;
+        
+        // storage for \c n elements, padding elements being zeroed
+        static T* allocate(std::size_t const& n) {
+            T* pointer = alignedAllocate<T>(A::template padded<T>(n));
+            for (std::size_t i(n); i < A::template padded<T>(n); i++) {
+                pointer[i] = T();
+            }
+            return pointer;
+        }
+        
+    public:
+        
+        // --------------------------------------------------------------------
+        // constructors
+        // --------------------------------------------------------------------
+        
+        // default constructor, no element
+        VectorMemory() : _elements(nullptr), _size(0) {}
+        
+        // storage for \c n elements
+        explicit VectorMemory(std::size_t const& n) : _elements(allocate(n)), _size(n) {}
+        
         // copy elements from memory
-        VectorMemory(const T* pointer) {
-            for (std::size_t i = 0; i < N; i++) {
-                (*this)[i] = pointer[i];
+        VectorMemory(const T* pointer, std::size_t const& n) : VectorMemory(n) {
+            for (std::size_t i = 0; i < n; i++) {
+                _elements[i] = pointer[i];
+            }
+        }
+        
+        // copy constructor
+        VectorMemory(VectorMemory<T, Dynamic, 0, A> const& rhs) : VectorMemory(rhs._elements, rhs._size) {}
+        
+        // move constructor, stealing the storage of \c rhs
+        VectorMemory(VectorMemory<T, Dynamic, 0, A>&& rhs) noexcept : _elements(rhs._elements), _size(rhs._size) {
+            rhs._elements = nullptr;
+            rhs._size = 0;
+        }
+        
+        ~VectorMemory() {
+            alignedFree(_elements, A::template padded<T>(_size));
+        }
+        
+        VectorMemory<T, Dynamic, 0, A>& operator=(VectorMemory<T, Dynamic, 0, A> const& rhs) {
+            resize(rhs._size);
+            for (std::size_t i = 0; i < _size; i++) {
+                _elements[i] = rhs._elements[i];
+            }
+            return *this;
+        }
+        
+        VectorMemory<T, Dynamic, 0, A>& operator=(VectorMemory<T, Dynamic, 0, A>&& rhs) noexcept {
+            std::swap(_elements, rhs._elements);
+            std::swap(_size, rhs._size);
+            return *this;
+        }
+        
+        // --------------------------------------------------------------------
+        // size
+        // --------------------------------------------------------------------
+        
+        std::size_t size() const {
+            return _size;
+        }
+        
+        // reallocates the storage when the number of elements changes, the
+        // elements being left uninitialized
+        void resize(std::size_t const& n) {
+            if (n != _size) {
+                alignedFree(_elements, A::template padded<T>(_size));
+                _elements = allocate(n);
+                _size = n;
             }
         }
         
@@ -107,25 +705,44 @@ namespace expand {
         // --------------------------------------------------------------------
         
         T operator[](std::size_t const& i) const {
-            ASSERT(i >= 0 && i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
+            EXPAND_CHECK(Check, i < _size, "Index (" << i << ") out of bounds in Vector of size " << _size);
             return _elements[i];
         }
         
         T& operator[](std::size_t const& i) {
-            ASSERT(i >= 0 && i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
+            EXPAND_CHECK(Check, i < _size, "Index (" << i << ") out of bounds in Vector of size " << _size);
             return _elements[i];
         }
         
         T operator()(std::size_t const& i) const {
-            ASSERT(i >= 0 && i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
             return (*this)[i];
         }
         
         T& operator()(std::size_t const& i) {
-            ASSERT(i >= 0 && i < N, "Index (" << i << ") out of bounds in Vector of size " << N);
             return (*this)[i];
         }
         
+        // element \c i, without bounds checks
+        T unchecked(std::size_t const& i) const {
+            return _elements[i];
+        }
+        
+        T& unchecked(std::size_t const& i) {
+            return _elements[i];
+        }
+        
+        // --------------------------------------------------------------------
+        // packet evaluation
+        // --------------------------------------------------------------------
+        
+        static constexpr bool vectorizable = Packet<typename Widened<T>::type>::size > 1;
+        
+        // lanes i to i + P::size - 1
+        template <typename P>
+        typename P::type packet(std::size_t const& i) const {
+            return P::load(_elements + i);
+        }
+        
         // --------------------------------------------------------------------
         // getters
         // --------------------------------------------------------------------
@@ -140,4 +757,6 @@ namespace expand {
     };
 }
 
+EXPAND_PSABI_END
+
 #endif /* VectorMemory_h */
@@ -6,20 +6,145 @@
 #ifndef VectorOps_h
 #define VectorOps_h
 
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "Packet.h"
+#include "VectorMemory.h"
+
+EXPAND_PSABI_BEGIN
+
 namespace expand {
     
+    template <typename T, std::size_t N, std::size_t S, typename A>
+    class Vector;
+    
+    // --------------------------------------------------------------------
+    // expression traits
+    // --------------------------------------------------------------------
+    
+    // true for every type which can be used as an operand of the vector
+    // operators: Vector instances and expression nodes
+    template <typename E>
+    struct IsVectorExpression : std::false_type {};
+    
+    template <typename T, std::size_t N, std::size_t S, typename A>
+    struct IsVectorExpression<Vector<T, N, S, A>> : std::true_type {};
+    
+    // true for Vector instances of scalar type \c T whose elements are
+    // contiguous in memory
+    template <typename E, typename T>
+    struct IsContiguousVector : std::false_type {};
+    
+    template <typename T, std::size_t N, typename A>
+    struct IsContiguousVector<Vector<T, N, 0, A>, T> : std::true_type {};
+    
+    template <typename T, std::size_t N, typename A>
+    struct IsContiguousVector<Vector<T, N, 1, A>, T> : std::true_type {};
+    
+    // size of a vector expression known at compile time, \c Dynamic
+    // otherwise
+    template <typename E>
+    struct VectorShape {
+        static constexpr std::size_t size = Dynamic;
+    };
+    
+    template <typename T, std::size_t N, std::size_t S, typename A>
+    struct VectorShape<Vector<T, N, S, A>> {
+        static constexpr std::size_t size = N;
+    };
+    
+    template <typename T1, typename T2>
+    struct VectorShapes {
+        static constexpr std::size_t size = VectorShape<T1>::size != Dynamic ? VectorShape<T1>::size : VectorShape<T2>::size;
+        
+        // false when both sizes are known at compile time and differ
+        static constexpr bool agree = VectorShape<T1>::size == Dynamic || VectorShape<T2>::size == Dynamic ||
+            VectorShape<T1>::size == VectorShape<T2>::size;
+    };
+    
+    // storage policy shared by every Vector read by an expression, \c void
+    // when they differ or some of them do not own their elements
+    template <typename E>
+    struct VectorLayout {
+        typedef void type;
+    };
+    
+    template <typename T, std::size_t N, typename A>
+    struct VectorLayout<Vector<T, N, 0, A>> {
+        typedef A type;
+    };
+    
+    template <typename T1, typename T2>
+    struct VectorLayouts {
+        typedef typename std::conditional<
+            std::is_same<typename VectorLayout<T1>::type, typename VectorLayout<T2>::type>::value,
+            typename VectorLayout<T1>::type, void>::type type;
+    };
+    
+    // scalar type in which the elements of expression \c E are computed,
+    // reduced-precision elements being widened
+    template <typename E>
+    using WidenedType = typename Widened<typename E::value_type>::type;
+    
+    // an expression node can be evaluated packet by packet when both its
+    // operands can and they are computed in the same scalar type
+    template <typename T1, typename T2>
+    struct IsVectorizable : std::integral_constant<bool,
+        T1::vectorizable && T2::vectorizable &&
+        std::is_same<WidenedType<T1>, WidenedType<T2>>::value> {};
+    
+    // --------------------------------------------------------------------
+    // expression nodes
+    // --------------------------------------------------------------------
+    
+    // factors of the products which sums and differences evaluate as fused
+    // multiply-adds, \c fusable being false for other expressions
+    template <typename E>
+    struct Factors {
+        static constexpr bool fusable = false;
+    };
+    
+    // sums and differences of which one operand is a product, as in a * b + c
+    // or alpha * x + y, are evaluated as fused multiply-adds (see
+    // \c fusedMultiplyAdd), rounding once instead of twice
+    
     template <typename T1, typename T2>
     struct VectorSum {
         
+        typedef decltype(std::declval<T1>()[0] + std::declval<T2>()[0]) value_type;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
         T1 const& u;
         T2 const& v;
         
-        std::size_t size() const {
+        constexpr std::size_t size() const {
             return v.size();
         }
         
-        auto operator[](size_t i) const {
-            return u[i] + v[i];
+        constexpr auto operator[](size_t i) const {
+            if constexpr (Factors<T1>::fusable) {
+                return fusedMultiplyAdd<value_type>(Factors<T1>::first(u, i), Factors<T1>::second(u, i), element(v, i));
+            } else if constexpr (Factors<T2>::fusable) {
+                return fusedMultiplyAdd<value_type>(Factors<T2>::first(v, i), Factors<T2>::second(v, i), element(u, i));
+            } else {
+                return element(u, i) + element(v, i);
+            }
+        }
+        
+        template <typename P>
+        typename P::type packet(size_t i) const {
+            if constexpr (Factors<T1>::fusable) {
+                return P::fma(Factors<T1>::template first<P>(u, i), Factors<T1>::template second<P>(u, i),
+                              v.template packet<P>(i));
+            } else if constexpr (Factors<T2>::fusable) {
+                return P::fma(Factors<T2>::template first<P>(v, i), Factors<T2>::template second<P>(v, i),
+                              u.template packet<P>(i));
+            } else {
+                return u.template packet<P>(i) + v.template packet<P>(i);
+            }
         }
     };
     
@@ -27,32 +152,495 @@ namespace expand {
     template <typename T1, typename T2>
     struct VectorDif {
         
+        typedef decltype(std::declval<T1>()[0] - std::declval<T2>()[0]) value_type;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
         T1 const& u;
         T2 const& v;
         
-        std::size_t size() const {
+        constexpr std::size_t size() const {
             return v.size();
         }
         
-        auto operator[](size_t i) const {
-            return u[i] - v[i];
+        constexpr auto operator[](size_t i) const {
+            if constexpr (Factors<T1>::fusable) {
+                return fusedMultiplyAdd<value_type>(Factors<T1>::first(u, i), Factors<T1>::second(u, i), -element(v, i));
+            } else if constexpr (Factors<T2>::fusable) {
+                return fusedMultiplyAdd<value_type>(-Factors<T2>::first(v, i), Factors<T2>::second(v, i), element(u, i));
+            } else {
+                return element(u, i) - element(v, i);
+            }
+        }
+        
+        template <typename P>
+        typename P::type packet(size_t i) const {
+            if constexpr (Factors<T1>::fusable) {
+                return P::fma(Factors<T1>::template first<P>(u, i), Factors<T1>::template second<P>(u, i),
+                              -v.template packet<P>(i));
+            } else if constexpr (Factors<T2>::fusable) {
+                return P::fma(-Factors<T2>::template first<P>(v, i), Factors<T2>::template second<P>(v, i),
+                              u.template packet<P>(i));
+            } else {
+                return u.template packet<P>(i) - v.template packet<P>(i);
+            }
         }
     };
     
     template <typename T1, typename T2>
     struct VectorMul {
         
+        typedef decltype(std::declval<T1>()[0] * std::declval<T2>()[0]) value_type;
+        
+        static constexpr bool vectorizable = IsVectorizable<T1, T2>::value;
+        
         T1 const& u;
         T2 const& v;
         
-        std::size_t size() const {
+        constexpr std::size_t size() const {
             return v.size();
         }
         
-        auto operator[](size_t i) const {
-            return u[i] * v[i];
+        constexpr auto operator[](size_t i) const {
+            return element(u, i) * element(v, i);
+        }
+        
+        template <typename P>
+        typename P::type packet(size_t i) const {
+            return u.template packet<P>(i) * v.template packet<P>(i);
+        }
+    };
+    
+    
+    // operations between the elements of an expression and a scalar
+    
+    struct Plus {
+        template <typename X, typename Y>
+        static constexpr auto apply(X const& x, Y const& y) {
+            return x + y;
+        }
+    };
+    
+    struct Minus {
+        template <typename X, typename Y>
+        static constexpr auto apply(X const& x, Y const& y) {
+            return x - y;
+        }
+    };
+    
+    struct Multiplies {
+        template <typename X, typename Y>
+        static constexpr auto apply(X const& x, Y const& y) {
+            return x * y;
+        }
+    };
+    
+    struct Divides {
+        template <typename X, typename Y>
+        static constexpr auto apply(X const& x, Y const& y) {
+            return x / y;
+        }
+    };
+    
+    /**
+     *
+     * Operation \c Op between every element of \c u and a scalar captured
+     * by value and broadcast to every packet, the scalar being the left
+     * operand when \c Left, as in s - u or s / u.
+     *
+     * Products offset by a scalar, as in a * b + s, are evaluated as fused
+     * multiply-adds.
+     *
+     */
+    template <typename T1, typename Op, bool Left = false>
+    struct VectorBroadcast {
+        
+        typedef WidenedType<T1> value_type;
+        
+        static constexpr bool vectorizable = T1::vectorizable;
+        
+        T1 const& u;
+        value_type s;
+        
+        constexpr std::size_t size() const {
+            return u.size();
+        }
+        
+        constexpr auto operator[](size_t i) const {
+            if constexpr (fused) {
+                return fusedMultiplyAdd<value_type>(negated ? -Factors<T1>::first(u, i) : Factors<T1>::first(u, i),
+                                                    Factors<T1>::second(u, i), subtracted ? -s : s);
+            } else if constexpr (Left) {
+                return Op::apply(s, element(u, i));
+            } else {
+                return Op::apply(element(u, i), s);
+            }
+        }
+        
+        template <typename P>
+        typename P::type packet(size_t i) const {
+            if constexpr (fused) {
+                typename P::type const first = Factors<T1>::template first<P>(u, i);
+                return P::fma(negated ? -first : first, Factors<T1>::template second<P>(u, i),
+                              P::set1(subtracted ? -s : s));
+            } else if constexpr (Left) {
+                return Op::apply(P::set1(s), u.template packet<P>(i));
+            } else {
+                return Op::apply(u.template packet<P>(i), P::set1(s));
+            }
         }
+        
+    private:
+        
+        static constexpr bool fused = Factors<T1>::fusable &&
+            (std::is_same<Op, Plus>::value || std::is_same<Op, Minus>::value);
+        
+        // s - a * b negates the product, a * b - s the scalar
+        static constexpr bool negated = std::is_same<Op, Minus>::value && Left;
+        static constexpr bool subtracted = std::is_same<Op, Minus>::value && !Left;
     };
+    
+    template <typename T1, typename T2>
+    struct Factors<VectorMul<T1, T2>> {
+        
+        static constexpr bool fusable = true;
+        
+        static constexpr auto first(VectorMul<T1, T2> const& e, size_t i) {
+            return element(e.u, i);
+        }
+        
+        static constexpr auto second(VectorMul<T1, T2> const& e, size_t i) {
+            return element(e.v, i);
+        }
+        
+        template <typename P>
+        static typename P::type first(VectorMul<T1, T2> const& e, size_t i) {
+            return e.u.template packet<P>(i);
+        }
+        
+        template <typename P>
+        static typename P::type second(VectorMul<T1, T2> const& e, size_t i) {
+            return e.v.template packet<P>(i);
+        }
+    };
+    
+    template <typename T1>
+    struct Factors<VectorBroadcast<T1, Multiplies>> {
+        
+        static constexpr bool fusable = true;
+        
+        static constexpr auto first(VectorBroadcast<T1, Multiplies> const& e, size_t i) {
+            return element(e.u, i);
+        }
+        
+        static constexpr auto second(VectorBroadcast<T1, Multiplies> const& e, size_t) {
+            return e.s;
+        }
+        
+        template <typename P>
+        static typename P::type first(VectorBroadcast<T1, Multiplies> const& e, size_t i) {
+            return e.u.template packet<P>(i);
+        }
+        
+        template <typename P>
+        static typename P::type second(VectorBroadcast<T1, Multiplies> const& e, size_t) {
+            return P::set1(e.s);
+        }
+    };
+    
+    // quantized expressions hold 8-bit integers standing for their product
+    // by a scale, in single precision
+    
+    // \c x, already divided by the scale, rounded to the nearest integer,
+    // ties to even, and saturated to [-128, 127], scalar or packet alike
+    template <typename X>
+    X quantizeRound(X const& x) {
+        X const low = x >= -128.0f ? x : X{} - 128.0f;
+        X const clamped = low <= 127.0f ? low : X{} + 127.0f;
+        // adding and subtracting 1.5 * 2^23 drops the fractional part
+        return (clamped + 12582912.0f) - 12582912.0f;
+    }
+    
+    // packet \c P of floats converted from the integers \c x, narrower ones
+    // being first extended to 32 bits: bytes by single instructions where
+    // the kernel has them, other integers one size at a time, which
+    // compilers lower to a few instructions rather than lane by lane
+    template <typename P, typename T>
+    typename P::type dequantizePacket(typename Packet<T, P::size * sizeof(T)>::type const& x) {
+        typedef Packet<T, P::size * sizeof(T)> Q;
+        typedef Packet<std::int32_t, P::size * sizeof(std::int32_t)> I;
+        constexpr bool bytes = std::is_same<T, std::int8_t>::value && hasByteExtensions<I::size * sizeof(std::int32_t)>();
+        if constexpr (bytes && I::size == 8) {
+            return convert<P, I>((typename I::type)extendBytes8(&x));
+        } else if constexpr (bytes && I::size == 16) {
+            return convert<P, I>((typename I::type)extendBytes16(&x));
+        } else if constexpr (sizeof(T) < sizeof(std::int32_t)) {
+            typedef typename std::conditional<sizeof(T) == 1 && std::is_unsigned<T>::value, std::uint16_t,
+                typename std::conditional<sizeof(T) == 1, std::int16_t, std::int32_t>::type>::type U;
+            return dequantizePacket<P, U>(convert<Packet<U, P::size * sizeof(U)>, Q>(x));
+        } else {
+            return convert<P, Q>(x);
+        }
+    }
+    
+    // packet \c P of 8-bit integers quantized from the product by \c r of
+    // the packets of floats \c load(Q(), k) holding its lanes from \c k on,
+    // a quarter of \c P at a time, so that no packet is wider than those of
+    // the kernel and their conversions use its instruction set
+    template <typename P, typename F>
+    typename P::type quantizePacket(F const& load, float const& r) {
+        constexpr std::size_t W = sizeof(typename P::type);
+        typedef Packet<float, W> Q;
+        typedef Packet<std::int32_t, W> I;
+        typedef Packet<std::int8_t, W / 4> N;
+        alignas(64) std::int8_t q[P::size];
+        for (std::size_t k(0); k < P::size; k += Q::size) {
+            N::store(q + k, convert<N, I>(convert<I, Q>(quantizeRound(load(Q(), k) * Q::set1(r)))));
+        }
+        return P::load(q);
+    }
+    
+    /**
+     *
+     * Integer expression \c u times the scale \c s: the values of a
+     * quantized vector, widened to \c float packet by packet.
+     *
+     */
+    template <typename T1>
+    struct VectorDequantize {
+        
+        static_assert(std::is_integral<typename T1::value_type>::value, "Only integer expressions are dequantized");
+        
+        typedef float value_type;
+        
+        static constexpr bool vectorizable = T1::vectorizable;
+        
+        T1 const& u;
+        float s;
+        
+        constexpr std::size_t size() const {
+            return u.size();
+        }
+        
+        constexpr float operator[](size_t i) const {
+            return static_cast<float>(element(u, i)) * s;
+        }
+        
+        template <typename P>
+        typename P::type packet(size_t i) const {
+            typedef Packet<typename T1::value_type, P::size * sizeof(typename T1::value_type)> Q;
+            return dequantizePacket<P, typename T1::value_type>(u.template packet<Q>(i)) * P::set1(s);
+        }
+    };
+    
+    /**
+     *
+     * Expression \c u quantized to 8-bit integers with a scale, by the
+     * product with its inverse \c r (see \c quantizeRound), packets of
+     * integers being narrowed from as many floats (see \c quantizePacket).
+     *
+     */
+    template <typename T1>
+    struct VectorQuantize {
+        
+        typedef std::int8_t value_type;
+        
+        static constexpr bool vectorizable = T1::vectorizable && std::is_same<WidenedType<T1>, float>::value;
+        
+        T1 const& u;
+        float r;
+        
+        constexpr std::size_t size() const {
+            return u.size();
+        }
+        
+        value_type operator[](size_t i) const {
+            return static_cast<value_type>(quantizeRound(static_cast<float>(element(u, i)) * r));
+        }
+        
+        template <typename P>
+        typename P::type packet(size_t i) const {
+            return quantizePacket<P>([&](auto q, std::size_t k) {
+                return u.template packet<decltype(q)>(i + k);
+            }, r);
+        }
+    };
+    
+    template <typename T1, typename T2>
+    struct IsVectorExpression<VectorSum<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsVectorExpression<VectorDif<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct IsVectorExpression<VectorMul<T1, T2>> : std::true_type {};
+    
+    template <typename T1, typename Op, bool Left>
+    struct IsVectorExpression<VectorBroadcast<T1, Op, Left>> : std::true_type {};
+    
+    template <typename T1>
+    struct IsVectorExpression<VectorDequantize<T1>> : std::true_type {};
+    
+    template <typename T1>
+    struct IsVectorExpression<VectorQuantize<T1>> : std::true_type {};
+    
+    template <typename T1, typename T2>
+    struct VectorShape<VectorSum<T1, T2>> : VectorShapes<T1, T2> {};
+    
+    template <typename T1, typename T2>
+    struct VectorShape<VectorDif<T1, T2>> : VectorShapes<T1, T2> {};
+    
+    template <typename T1, typename T2>
+    struct VectorShape<VectorMul<T1, T2>> : VectorShapes<T1, T2> {};
+    
+    template <typename T1, typename Op, bool Left>
+    struct VectorShape<VectorBroadcast<T1, Op, Left>> : VectorShape<T1> {};
+    
+    template <typename T1>
+    struct VectorShape<VectorDequantize<T1>> : VectorShape<T1> {};
+    
+    template <typename T1>
+    struct VectorShape<VectorQuantize<T1>> : VectorShape<T1> {};
+    
+    template <typename T1, typename T2>
+    struct VectorLayout<VectorSum<T1, T2>> : VectorLayouts<T1, T2> {};
+    
+    template <typename T1, typename T2>
+    struct VectorLayout<VectorDif<T1, T2>> : VectorLayouts<T1, T2> {};
+    
+    template <typename T1, typename T2>
+    struct VectorLayout<VectorMul<T1, T2>> : VectorLayouts<T1, T2> {};
+    
+    // only the broadcasts keeping zeros at zero may be evaluated over the
+    // padding of their operand, which must stay zeroed
+    template <typename T1, typename Op, bool Left>
+    struct VectorLayout<VectorBroadcast<T1, Op, Left>> {
+        typedef void type;
+    };
+    
+    template <typename T1, bool Left>
+    struct VectorLayout<VectorBroadcast<T1, Multiplies, Left>> : VectorLayout<T1> {};
+    
+    template <typename T1>
+    struct VectorLayout<VectorBroadcast<T1, Divides>> : VectorLayout<T1> {};
+    
+    // quantization changes the size of the elements, hence their padding,
+    // so that neither node has a layout
+    
+    // sums and differences with a product operand fuse their multiply-adds,
+    // as do the broadcasts offsetting one (see \c kernelElement)
+    template <typename T1, typename T2>
+    struct HasFusedNode<VectorSum<T1, T2>> : std::integral_constant<bool,
+        Factors<T1>::fusable || Factors<T2>::fusable || HasFusedNode<T1>::value || HasFusedNode<T2>::value> {};
+    
+    template <typename T1, typename T2>
+    struct HasFusedNode<VectorDif<T1, T2>> : HasFusedNode<VectorSum<T1, T2>> {};
+    
+    template <typename T1, typename T2>
+    struct HasFusedNode<VectorMul<T1, T2>> : std::integral_constant<bool,
+        HasFusedNode<T1>::value || HasFusedNode<T2>::value> {};
+    
+    template <typename T1, typename Op, bool Left>
+    struct HasFusedNode<VectorBroadcast<T1, Op, Left>> : std::integral_constant<bool,
+        (Factors<T1>::fusable && (std::is_same<Op, Plus>::value || std::is_same<Op, Minus>::value)) ||
+        HasFusedNode<T1>::value> {};
+    
+    template <typename T1>
+    struct HasFusedNode<VectorDequantize<T1>> : HasFusedNode<T1> {};
+    
+    template <typename T1>
+    struct HasFusedNode<VectorQuantize<T1>> : HasFusedNode<T1> {};
+    
+    // --------------------------------------------------------------------
+    // operators
+    // --------------------------------------------------------------------
+    
+    // only participate in overload resolution for vector expressions
+    template <typename T1>
+    using EnableIfVectorExpression = typename std::enable_if<IsVectorExpression<T1>::value, int>::type;
+    
+    template <typename T1, typename T2>
+    using EnableIfVectorExpressions = typename std::enable_if<
+        IsVectorExpression<T1>::value && IsVectorExpression<T2>::value, int>::type;
+    
+    // addition
+    template <typename T1, typename T2, EnableIfVectorExpressions<T1, T2> = 0>
+    constexpr auto operator+(T1 const& u, T2 const& v) {
+        static_assert(VectorShapes<T1, T2>::agree, "Vector dimensions must agree");
+        ASSERT(u.size() == v.size(), "Vector dimensions must agree");
+        return VectorSum<T1, T2>{u, v};
+    }
+    
+    // substraction
+    template <typename T1, typename T2, EnableIfVectorExpressions<T1, T2> = 0>
+    constexpr auto operator-(T1 const& u, T2 const& v) {
+        static_assert(VectorShapes<T1, T2>::agree, "Vector dimensions must agree");
+        ASSERT(u.size() == v.size(), "Vector dimensions must agree");
+        return VectorDif<T1, T2>{u, v};
+    }
+    
+    // element-wise multiplication
+    template <typename T1, typename T2, EnableIfVectorExpressions<T1, T2> = 0>
+    constexpr auto operator*(T1 const& u, T2 const& v) {
+        static_assert(VectorShapes<T1, T2>::agree, "Vector dimensions must agree");
+        ASSERT(u.size() == v.size(), "Vector dimensions must agree");
+        return VectorMul<T1, T2>{u, v};
+    }
+    
+    // operations with a scalar, broadcast to every element
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto operator+(T1 const& u, WidenedType<T1> const& s) {
+        return VectorBroadcast<T1, Plus>{u, s};
+    }
+    
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto operator+(WidenedType<T1> const& s, T1 const& u) {
+        return VectorBroadcast<T1, Plus>{u, s};
+    }
+    
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto operator-(T1 const& u, WidenedType<T1> const& s) {
+        return VectorBroadcast<T1, Minus>{u, s};
+    }
+    
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto operator-(WidenedType<T1> const& s, T1 const& u) {
+        return VectorBroadcast<T1, Minus, true>{u, s};
+    }
+    
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto operator*(T1 const& u, WidenedType<T1> const& s) {
+        return VectorBroadcast<T1, Multiplies>{u, s};
+    }
+    
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto operator*(WidenedType<T1> const& s, T1 const& u) {
+        return VectorBroadcast<T1, Multiplies>{u, s};
+    }
+    
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto operator/(T1 const& u, WidenedType<T1> const& s) {
+        return VectorBroadcast<T1, Divides>{u, s};
+    }
+    
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto operator/(WidenedType<T1> const& s, T1 const& u) {
+        return VectorBroadcast<T1, Divides, true>{u, s};
+    }
+    
+    // values of the integer expression \c u quantized with the scale \c s
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto dequantize(T1 const& u, float const& s) {
+        return VectorDequantize<T1>{u, s};
+    }
+    
+    // expression \c u quantized to 8-bit integers with the scale \c s
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr auto quantize(T1 const& u, float const& s) {
+        return VectorQuantize<T1>{u, 1 / s};
+    }
 }
 
+EXPAND_PSABI_END
+
 #endif /* VectorOps_h */
@@ -0,0 +1,220 @@
+//
+//  VectorReduce.h
+//  Expand
+//
+
+#ifndef VectorReduce_h
+#define VectorReduce_h
+
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include "Dispatch.h"
+#include "Packet.h"
+#include "VectorOps.h"
+
+EXPAND_PSABI_BEGIN
+
+namespace expand {
+    
+    // --------------------------------------------------------------------
+    // reduction operators
+    // --------------------------------------------------------------------
+    
+    // \c apply combines scalars or packets lane by lane, \c horizontal
+    // combines the lanes of a packet
+    
+    struct ReduceSum {
+        template <typename X>
+        static constexpr X apply(X const& a, X const& b) {
+            return a + b;
+        }
+        
+        template <typename P>
+        static auto horizontal(typename P::type const& x) {
+            return P::sum(x);
+        }
+    };
+    
+    struct ReduceMin {
+        template <typename X>
+        static constexpr X apply(X const& a, X const& b) {
+            return b < a ? b : a;
+        }
+        
+        template <typename P>
+        static auto horizontal(typename P::type const& x) {
+            auto m = x[0];
+            for (std::size_t k(1); k < P::size; k++) {
+                m = apply(m, x[k]);
+            }
+            return m;
+        }
+    };
+    
+    struct ReduceMax {
+        template <typename X>
+        static constexpr X apply(X const& a, X const& b) {
+            return a < b ? b : a;
+        }
+        
+        template <typename P>
+        static auto horizontal(typename P::type const& x) {
+            auto m = x[0];
+            for (std::size_t k(1); k < P::size; k++) {
+                m = apply(m, x[k]);
+            }
+            return m;
+        }
+    };
+    
+    // --------------------------------------------------------------------
+    // reduction kernel
+    // --------------------------------------------------------------------
+    
+    /**
+     *
+     * Reduces the elements of the non-empty expression \c e through \c R in
+     * a single pass.
+     *
+     * Four independent accumulators are carried along so that consecutive
+     * iterations do not wait on each other, each holding a whole packet of
+     * \c W bytes when the expression is vectorizable. Elements of reduced
+     * precision are accumulated in their widened type.
+     *
+     */
+    template <typename R, std::size_t W, typename E>
+    WidenedType<E> reduceLoop(E const& e) {
+        typedef WidenedType<E> T;
+        constexpr std::size_t A = 4;
+        
+        std::size_t const n = e.size();
+        std::size_t i(0);
+        T result;
+        if constexpr (E::vectorizable) {
+            typedef Packet<T, W> P;
+            if (n >= A * P::size) {
+                typename P::type acc[A];
+                for (std::size_t a(0); a < A; a++) {
+                    acc[a] = e.template packet<P>(a * P::size);
+                }
+                for (i = A * P::size; i + A * P::size <= n; i += A * P::size) {
+#pragma GCC unroll 4
+                    for (std::size_t a(0); a < A; a++) {
+                        acc[a] = R::apply(acc[a], e.template packet<P>(i + a * P::size));
+                    }
+                }
+                for (; i + P::size <= n; i += P::size) {
+                    acc[0] = R::apply(acc[0], e.template packet<P>(i));
+                }
+                result = R::template horizontal<P>(
+                    R::apply(R::apply(acc[0], acc[1]), R::apply(acc[2], acc[3])));
+                for (; i < n; i++) {
+                    result = R::apply(result, static_cast<T>(kernelElement<W>(e, i)));
+                }
+                return result;
+            }
+        }
+        if (n >= A) {
+            T acc[A];
+            for (std::size_t a(0); a < A; a++) {
+                acc[a] = kernelElement<W>(e, a);
+            }
+            // bounded by the last whole group, which keeps GCC from seeing
+            // the tails of fixed sizes read past their elements
+            std::size_t const m = n - n % A;
+            for (i = A; i < m; i += A) {
+                for (std::size_t a(0); a < A; a++) {
+                    acc[a] = R::apply(acc[a], static_cast<T>(kernelElement<W>(e, i + a)));
+                }
+            }
+            result = R::apply(R::apply(acc[0], acc[1]), R::apply(acc[2], acc[3]));
+        } else {
+            result = kernelElement<W>(e, 0);
+            i = 1;
+        }
+        for (; i < n; i++) {
+            result = R::apply(result, static_cast<T>(kernelElement<W>(e, i)));
+        }
+        return result;
+    }
+    
+    // the same, in code compiled for the instruction set selected at runtime
+    template <typename R, typename E>
+    WidenedType<E> reduceLoop(E const& e) {
+        return dispatch([&](auto w) {
+            return reduceLoop<R, decltype(w)::value>(e);
+        });
+    }
+    
+    // reduces the elements 0 and \c I + 1 of expression \c e through \c R,
+    // fully unrolled so that it can take place at compile time
+    template <typename R, typename E, std::size_t... I>
+    constexpr WidenedType<E> reduceUnrolled(E const& e, std::index_sequence<I...>) {
+        typedef WidenedType<E> T;
+        T result = element(e, 0);
+        ((result = R::apply(result, static_cast<T>(element(e, I + 1)))), ...);
+        return result;
+    }
+    
+    // reduces the elements of the non-empty expression \c e through \c R,
+    // small fixed-size expressions being reduced fully unrolled
+    template <typename R, typename E>
+    constexpr WidenedType<E> reduce(E const& e) {
+        constexpr std::size_t N = VectorShape<E>::size;
+        if constexpr (N != Dynamic && N > 0 && N <= EXPAND_UNROLL_LIMIT) {
+            return reduceUnrolled<R>(e, std::make_index_sequence<N - 1>());
+        } else {
+            return reduceLoop<R>(e);
+        }
+    }
+    
+    // --------------------------------------------------------------------
+    // reductions
+    // --------------------------------------------------------------------
+    
+    // sum of the elements
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr WidenedType<T1> sum(T1 const& u) {
+        return u.size() == 0 ? WidenedType<T1>(0) : reduce<ReduceSum>(u);
+    }
+    
+    // dot product
+    template <typename T1, typename T2, EnableIfVectorExpressions<T1, T2> = 0>
+    constexpr auto dot(T1 const& u, T2 const& v) {
+        static_assert(VectorShapes<T1, T2>::agree, "Vector dimensions must agree");
+        ASSERT(u.size() == v.size(), "Vector dimensions must agree");
+        return sum(VectorMul<T1, T2>{u, v});
+    }
+    
+    // squared euclidean norm
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr WidenedType<T1> squaredNorm(T1 const& u) {
+        return sum(VectorMul<T1, T1>{u, u});
+    }
+    
+    // euclidean norm
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    auto norm(T1 const& u) {
+        return std::sqrt(squaredNorm(u));
+    }
+    
+    // smallest element
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr WidenedType<T1> minCoeff(T1 const& u) {
+        ASSERT(u.size() > 0, "Vector must not be empty");
+        return reduce<ReduceMin>(u);
+    }
+    
+    // largest element
+    template <typename T1, EnableIfVectorExpression<T1> = 0>
+    constexpr WidenedType<T1> maxCoeff(T1 const& u) {
+        ASSERT(u.size() > 0, "Vector must not be empty");
+        return reduce<ReduceMax>(u);
+    }
+}
+
+EXPAND_PSABI_END
+
+#endif /* VectorReduce_h */
@@ -0,0 +1,65 @@
+//
+//  ArrayFile.cpp
+//  Expand
+//
+//  Streaming writes of array files, and reduction over their items either
+//  mapped in memory or read into a container first.
+//
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ArrayFile.h"
+#include "Benchmark.h"
+
+using namespace expand;
+
+namespace bench {
+
+    namespace {
+
+        template <typename E>
+        void run(Runner& runner, const char* name, std::size_t const& n) {
+            typedef typename E::value_type T;
+            const char* type = typeName<T>();
+
+            std::string const path = (std::filesystem::temp_directory_path() / "expand-benchmark.bin").string();
+            std::vector<E> items(n, E(T(1)));
+            double const bytes = double(n) * sizeof(E);
+
+            runner.run("io", name, "write", type, n, bytes, 0, [&] {
+                ArrayFileWriter<E> writer(path);
+                writer.write(items.data(), items.size());
+            });
+
+            E total(T(0));
+            escape(&total);
+            runner.run("io", name, "mmap", type, n, bytes, 0, [&] {
+                ArrayFile<E> file(path);
+                for (std::size_t i(0); i < file.size(); i++) {
+                    total += file[i];
+                }
+            });
+            runner.run("io", name, "read", type, n, bytes, 0, [&] {
+                std::ifstream file(path, std::ios::binary);
+                ArrayFileHeader header;
+                file.read(reinterpret_cast<char*>(&header), sizeof(header));
+                std::vector<E> read(header.count);
+                file.read(reinterpret_cast<char*>(read.data()), std::streamsize(header.count * sizeof(E)));
+                for (std::size_t i(0); i < read.size(); i++) {
+                    total += read[i];
+                }
+            });
+
+            std::remove(path.c_str());
+        }
+    }
+
+    void files(Runner& runner) {
+        run<Vector<float, 3>>(runner, "Vector<3>", 1 << 20);
+        run<Matrix<double, 4>>(runner, "Matrix<4>", 1 << 18);
+    }
+}
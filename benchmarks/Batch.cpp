@@ -0,0 +1,110 @@
+//
+//  Batch.cpp
+//  Expand
+//
+//  Products, inverses and transforms of batches of small matrices, one
+//  SIMD lane per matrix, against the same operations on arrays of
+//  matrices, and the gather and scatter between both layouts.
+//
+
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "MatrixBatch.h"
+
+using namespace expand;
+
+namespace bench {
+
+    namespace {
+
+        template <typename T, std::size_t N>
+        void run(Runner& runner, std::size_t n) {
+            const char* type = typeName<T>();
+
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<T> dist(-1, 1);
+            std::vector<Matrix<T, N>> a(n), b(n), c(n);
+            std::vector<Vector<T, N>> x(n), y(n);
+            std::vector<Vector<T, N - 1>> p(n), q(n);
+            for (std::size_t i(0); i < n; i++) {
+                for (std::size_t r(0); r < N; r++) {
+                    for (std::size_t s(0); s < N; s++) {
+                        a[i](r, s) = dist(gen) + (r == s ? T(N) : T(0));
+                        b[i](r, s) = dist(gen);
+                    }
+                    x[i][r] = dist(gen);
+                }
+                for (std::size_t r(0); r + 1 < N; r++) {
+                    p[i][r] = dist(gen);
+                }
+            }
+            MatrixBatch<T, N, N> A(a.data(), n), B(b.data(), n), C(n);
+            VectorBatch<T, N> X(x.data(), n), Y(n);
+            VectorBatch<T, N - 1> P(p.data(), n), Q(n);
+            escape(A.data());
+            escape(B.data());
+            escape(C.data());
+            escape(c.data());
+
+            double const bytes = double(n) * N * N * sizeof(T);
+
+            runner.run("batch", "c=a*b", "expand", type, N, 3 * bytes, 2.0 * n * N * N * N, [&] {
+                C = A * B;
+            });
+            runner.run("batch", "c=a*b", "loop", type, N, 3 * bytes, 2.0 * n * N * N * N, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    c[i] = a[i] * b[i];
+                }
+            });
+
+            runner.run("batch", "y=a*x", "expand", type, N, bytes, 2.0 * n * N * N, [&] {
+                Y = A * X;
+            });
+            runner.run("batch", "y=a*x", "loop", type, N, bytes, 2.0 * n * N * N, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    y[i] = a[i] * x[i];
+                }
+            });
+
+            runner.run("batch", "q=transform(a,p)", "expand", type, N, bytes, 2.0 * n * N * (N - 1), [&] {
+                Q = transform(A, P);
+            });
+            runner.run("batch", "q=transform(a,p)", "loop", type, N, bytes, 2.0 * n * N * (N - 1), [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    for (std::size_t r(0); r + 1 < N; r++) {
+                        T sum(a[i](r, N - 1));
+                        for (std::size_t s(0); s + 1 < N; s++) {
+                            sum += a[i](r, s) * p[i][s];
+                        }
+                        q[i][r] = sum;
+                    }
+                }
+            });
+
+            runner.run("batch", "c=inverse(a)", "expand", type, N, 2 * bytes, 2.0 * n * N * N * N, [&] {
+                C = inverse(A);
+            });
+            runner.run("batch", "c=inverse(a)", "loop", type, N, 2 * bytes, 2.0 * n * N * N * N, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    c[i] = inverse(a[i]);
+                }
+            });
+
+            runner.run("batch", "a.gather", "expand", type, N, 2 * bytes, 0, [&] {
+                A.gather(a.data());
+            });
+            runner.run("batch", "a.scatter", "expand", type, N, 2 * bytes, 0, [&] {
+                A.scatter(c.data());
+            });
+        }
+    }
+
+    void batches(Runner& runner) {
+        run<float, 3>(runner, 1 << 16);
+        run<float, 4>(runner, 1 << 16);
+        run<double, 4>(runner, 1 << 16);
+        run<float, 6>(runner, 1 << 14);
+    }
+}
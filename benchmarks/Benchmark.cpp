@@ -0,0 +1,139 @@
+//
+//  Benchmark.cpp
+//  Expand
+//
+//  Runs the benchmark suites and reports their results as a table, CSV or
+//  JSON, to track the performance of the library across releases.
+//
+//  Benchmark [--format=table|csv|json] [--output=FILE] [--filter=TEXT]
+//            [--min-time=SECONDS]
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Benchmark.h"
+#include "Matrix.h"
+
+using namespace bench;
+
+namespace {
+
+    // throughputs, 0 when not meaningful
+    double gigabytesPerSecond(Result const& r) {
+        return r.bytes / r.seconds * 1e-9;
+    }
+
+    double gigaflopsPerSecond(Result const& r) {
+        return r.flops / r.seconds * 1e-9;
+    }
+
+    void writeTable(std::FILE* out, std::vector<Result> const& results) {
+        std::fprintf(out, "%-12s %-14s %-8s %-7s %9s %14s %10s %10s\n",
+                     "suite", "name", "variant", "type", "size", "ns", "GB/s", "GFLOP/s");
+        for (Result const& r : results) {
+            std::fprintf(out, "%-12s %-14s %-8s %-7s %9zu %14.1f %10.2f %10.2f\n",
+                         r.suite.c_str(), r.name.c_str(), r.variant.c_str(), r.type.c_str(), r.size,
+                         r.seconds * 1e9, gigabytesPerSecond(r), gigaflopsPerSecond(r));
+        }
+    }
+
+    void writeCsv(std::FILE* out, std::vector<Result> const& results) {
+        std::fprintf(out, "suite,name,variant,type,size,ns,gbps,gflops\n");
+        for (Result const& r : results) {
+            std::fprintf(out, "%s,%s,%s,%s,%zu,%.3f,%.4f,%.4f\n",
+                         r.suite.c_str(), r.name.c_str(), r.variant.c_str(), r.type.c_str(), r.size,
+                         r.seconds * 1e9, gigabytesPerSecond(r), gigaflopsPerSecond(r));
+        }
+    }
+
+    // names and types are plain identifiers and operators, which need no
+    // escaping
+    void writeJson(std::FILE* out, std::vector<Result> const& results) {
+        std::fprintf(out, "{\n");
+        std::fprintf(out, "  \"context\": {\n");
+        std::fprintf(out, "    \"compiler\": \"%s\",\n", __VERSION__);
+        std::fprintf(out, "    \"simd_bytes\": %d,\n", EXPAND_SIMD_BYTES);
+        std::fprintf(out, "    \"isa\": \"%s\",\n", expand::isaName(expand::isa()));
+        std::fprintf(out, "    \"unroll_limit\": %d,\n", EXPAND_UNROLL_LIMIT);
+        std::fprintf(out, "    \"threads\": %zu\n", expand::maxThreads());
+        std::fprintf(out, "  },\n");
+        std::fprintf(out, "  \"results\": [");
+        for (std::size_t i(0); i < results.size(); i++) {
+            Result const& r = results[i];
+            std::fprintf(out, "%s\n    {\"suite\": \"%s\", \"name\": \"%s\", \"variant\": \"%s\", \"type\": \"%s\", "
+                         "\"size\": %zu, \"ns\": %.3f, \"gbps\": %.4f, \"gflops\": %.4f}",
+                         i ? "," : "", r.suite.c_str(), r.name.c_str(), r.variant.c_str(), r.type.c_str(),
+                         r.size, r.seconds * 1e9, gigabytesPerSecond(r), gigaflopsPerSecond(r));
+        }
+        std::fprintf(out, "\n  ]\n}\n");
+    }
+
+    // value of option \c name in \c arg, or nullptr
+    const char* option(const char* arg, const char* name) {
+        std::size_t const length = std::strlen(name);
+        if (std::strncmp(arg, name, length) == 0 && arg[length] == '=') {
+            return arg + length + 1;
+        }
+        return nullptr;
+    }
+
+    void usage(const char* program) {
+        std::fprintf(stderr, "usage: %s [--format=table|csv|json] [--output=FILE] [--filter=TEXT] "
+                     "[--min-time=SECONDS]\n", program);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string format("table");
+    std::string output;
+    std::string filter;
+    double minTime(0.1);
+
+    for (int i(1); i < argc; i++) {
+        if (const char* value = option(argv[i], "--format")) {
+            format = value;
+        } else if (const char* value = option(argv[i], "--output")) {
+            output = value;
+        } else if (const char* value = option(argv[i], "--filter")) {
+            filter = value;
+        } else if (const char* value = option(argv[i], "--min-time")) {
+            minTime = std::atof(value);
+        } else {
+            usage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (format != "table" && format != "csv" && format != "json") {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Runner runner(filter, minTime);
+    expressions(runner);
+    copies(runner);
+    strided(runner);
+    matrices(runner);
+    files(runner);
+    batches(runner);
+    sparse(runner);
+
+    std::FILE* out = output.empty() ? stdout : std::fopen(output.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "cannot open %s\n", output.c_str());
+        return EXIT_FAILURE;
+    }
+    if (format == "csv") {
+        writeCsv(out, runner.results());
+    } else if (format == "json") {
+        writeJson(out, runner.results());
+    } else {
+        writeTable(out, runner.results());
+    }
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return EXIT_SUCCESS;
+}
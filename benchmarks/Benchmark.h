@@ -0,0 +1,149 @@
+//
+//  Benchmark.h
+//  Expand
+//
+//  Timing and reporting shared by the benchmark suites.
+//
+
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    // --------------------------------------------------------------------
+    // optimization barriers
+    // --------------------------------------------------------------------
+
+    // makes the memory at \c p visible to the compiler as read and written
+    // elsewhere, so that the computations around it are not elided
+    inline void escape(const void* p) {
+        asm volatile("" : : "g"(p) : "memory");
+    }
+
+    // forces every pending store to memory
+    inline void clobber() {
+        asm volatile("" : : : "memory");
+    }
+
+    // --------------------------------------------------------------------
+    // results
+    // --------------------------------------------------------------------
+
+    /**
+     *
+     * One measurement: the \c variant ("expand" or a hand-written reference)
+     * of operation \c name of \c suite, over \c size elements of \c type.
+     * \c bytes and \c flops are those of a single run, or 0 when they are not
+     * meaningful.
+     *
+     */
+    struct Result {
+        std::string suite;
+        std::string name;
+        std::string variant;
+        std::string type;
+        std::size_t size;
+        double seconds;
+        double bytes;
+        double flops;
+    };
+
+    template <typename T>
+    const char* typeName();
+
+    template <>
+    inline const char* typeName<float>() {
+        return "float";
+    }
+
+    template <>
+    inline const char* typeName<double>() {
+        return "double";
+    }
+
+    // --------------------------------------------------------------------
+    // runner
+    // --------------------------------------------------------------------
+
+    class Runner {
+
+    public:
+
+        Runner(std::string const& filter, double const& minTime) : _filter(filter), _minTime(minTime) {}
+
+        /**
+         *
+         * Times \c f, run repeatedly for at least the minimum time after a
+         * first warm-up run, unless "suite/name/variant/type/size" does not
+         * contain the filter.
+         *
+         */
+        template <typename F>
+        void run(const char* suite, const char* name, const char* variant, const char* type,
+                 std::size_t const& size, double const& bytes, double const& flops, F const& f) {
+            Result result{suite, name, variant, type, size, 0, bytes, flops};
+            std::string const id = result.suite + "/" + result.name + "/" + result.variant + "/" +
+                                   result.type + "/" + std::to_string(size);
+            if (id.find(_filter) == std::string::npos) {
+                return;
+            }
+
+            typedef std::chrono::steady_clock Clock;
+            f();
+            clobber();
+            std::size_t runs(0);
+            Clock::time_point const start = Clock::now();
+            double elapsed(0);
+            do {
+                f();
+                clobber();
+                runs++;
+                elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            } while (elapsed < _minTime);
+            result.seconds = elapsed / runs;
+            _results.push_back(result);
+        }
+
+        std::vector<Result> const& results() const {
+            return _results;
+        }
+
+    private:
+
+        std::string _filter;
+        double _minTime;
+        std::vector<Result> _results;
+    };
+
+    // --------------------------------------------------------------------
+    // suites
+    // --------------------------------------------------------------------
+
+    // vector expressions against hand-written loops
+    void expressions(Runner& runner);
+
+    // copies and construction of vectors, matrices and containers of them
+    void copies(Runner& runner);
+
+    // strided column and trace views of matrices
+    void strided(Runner& runner);
+
+    // matrix expressions and products
+    void matrices(Runner& runner);
+
+    // writing and reading array files
+    void files(Runner& runner);
+
+    // batches of small matrices against arrays of matrices
+    void batches(Runner& runner);
+
+    // sparse matrix-vector products against hand-written loops
+    void sparse(Runner& runner);
+}
+
+#endif /* Benchmark_h */
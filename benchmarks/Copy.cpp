@@ -0,0 +1,90 @@
+//
+//  Copy.cpp
+//  Expand
+//
+//  Throughput of copies and reallocations of containers of small vectors
+//  and matrices, against plain arrays of the same size, and of the copy
+//  construction of large vectors and matrices.
+//
+
+#include <array>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Matrix.h"
+
+using namespace expand;
+
+// fixed-size instances are laid out and copied like plain arrays
+static_assert(std::is_trivially_copyable<Vector<float, 3>>::value, "Vector must be trivially copyable");
+static_assert(std::is_trivially_copyable<Vector<double, 4>>::value, "Vector must be trivially copyable");
+static_assert(std::is_trivially_copyable<Matrix<float, 4>>::value, "Matrix must be trivially copyable");
+static_assert(sizeof(Vector<float, 3>) == 3 * sizeof(float), "Vector must not hold more than its elements");
+static_assert(sizeof(Matrix<float, 4>) == 16 * sizeof(float), "Matrix must not hold more than its elements");
+
+namespace bench {
+
+    namespace {
+
+        // copy of a whole container, and growth of a container to \c n
+        // elements one reallocation at a time, every reallocation moving the
+        // previous elements, about \c n in total
+        template <typename E>
+        void containers(Runner& runner, const char* name, const char* variant, std::size_t const& n) {
+            std::vector<E> source(n);
+            std::vector<E> copy;
+            double const bytes = double(n) * sizeof(E);
+
+            runner.run("copy", name, variant, "float", n, bytes, 0, [&] {
+                copy = source;
+                escape(copy.data());
+            });
+            runner.run("copy", (std::string(name) + "-grow").c_str(), variant, "float", n, bytes, 0, [&] {
+                std::vector<E> grow(1);
+                while (grow.size() < n) {
+                    grow.resize(2 * grow.size());
+                }
+                escape(grow.data());
+            });
+        }
+
+        // copy construction of a single large instance
+        template <typename T>
+        void construct(Runner& runner, std::size_t const& n) {
+            VectorX<T> source(n, T(1));
+            runner.run("copy", "VectorX", "expand", typeName<T>(), n, double(n) * sizeof(T), 0, [&] {
+                VectorX<T> copy(source);
+                escape(copy.elements());
+            });
+
+            MatrixX<T> matrix(n / 256, 256, T(1));
+            runner.run("copy", "MatrixX", "expand", typeName<T>(), n, double(n) * sizeof(T), 0, [&] {
+                MatrixX<T> copy(matrix);
+                escape(copy.data());
+            });
+
+            std::vector<T> vector(n, T(1));
+            runner.run("copy", "VectorX", "vector", typeName<T>(), n, double(n) * sizeof(T), 0, [&] {
+                std::vector<T> copy(vector);
+                escape(copy.data());
+            });
+        }
+    }
+
+    void copies(Runner& runner) {
+        for (std::size_t n : {std::size_t(1) << 12, std::size_t(1) << 20}) {
+            containers<std::array<float, 3>>(runner, "vector<3>", "array", n);
+            containers<Vector<float, 3>>(runner, "vector<3>", "expand", n);
+            containers<std::array<float, 4>>(runner, "vector<4>", "array", n);
+            containers<Vector<float, 4>>(runner, "vector<4>", "expand", n);
+            containers<std::array<float, 16>>(runner, "matrix<4>", "array", n);
+            containers<Matrix<float, 4>>(runner, "matrix<4>", "expand", n);
+        }
+        for (std::size_t n : {std::size_t(1) << 12, std::size_t(1) << 20}) {
+            construct<float>(runner, n);
+            construct<double>(runner, n);
+        }
+    }
+}
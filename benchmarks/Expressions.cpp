@@ -0,0 +1,128 @@
+//
+//  Expressions.cpp
+//  Expand
+//
+//  Element-wise vector expressions and reductions against the equivalent
+//  hand-written loops, for fixed and dynamic sizes.
+//
+
+#include <memory>
+#include <random>
+
+#include "Benchmark.h"
+#include "Matrix.h"
+
+using namespace expand;
+
+namespace bench {
+
+    namespace {
+
+        template <typename V>
+        void fill(V& v, std::mt19937& gen) {
+            std::uniform_real_distribution<typename V::value_type> dist(-1, 1);
+            for (std::size_t i(0); i < v.size(); i++) {
+                v[i] = dist(gen);
+            }
+        }
+
+        // runs every operation on vectors of type \c V, built by \c make
+        template <typename V, typename Make>
+        void run(Runner& runner, std::size_t const& n, Make const& make) {
+            typedef typename V::value_type T;
+            const char* type = typeName<T>();
+
+            std::mt19937 gen(42);
+            std::unique_ptr<V> a(make()), b(make()), c(make()), d(make());
+            fill(*a, gen);
+            fill(*b, gen);
+            fill(*c, gen);
+            fill(*d, gen);
+            T* pa = &(*a)[0];
+            T* pb = &(*b)[0];
+            T* pc = &(*c)[0];
+            T* pd = &(*d)[0];
+            escape(pa);
+            escape(pb);
+            escape(pc);
+            escape(pd);
+
+            double const bytes = double(n) * sizeof(T);
+
+            runner.run("expressions", "d=a+b*c", "expand", type, n, 4 * bytes, 2.0 * n, [&] {
+                *d = *a + *b * *c;
+            });
+            runner.run("expressions", "d=a+b*c", "loop", type, n, 4 * bytes, 2.0 * n, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    pd[i] = pa[i] + pb[i] * pc[i];
+                }
+            });
+
+            T const alpha(0.5);
+            runner.run("expressions", "d=alpha*a+d", "expand", type, n, 3 * bytes, 2.0 * n, [&] {
+                *d = alpha * *a + *d;
+            });
+            runner.run("expressions", "d=alpha*a+d", "loop", type, n, 3 * bytes, 2.0 * n, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    pd[i] = alpha * pa[i] + pd[i];
+                }
+            });
+
+            runner.run("expressions", "d=(a-alpha)/alpha+b*alpha", "expand", type, n, 3 * bytes, 4.0 * n, [&] {
+                *d = (*a - alpha) / alpha + *b * alpha;
+            });
+            runner.run("expressions", "d=(a-alpha)/alpha+b*alpha", "loop", type, n, 3 * bytes, 4.0 * n, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    pd[i] = (pa[i] - alpha) / alpha + pb[i] * alpha;
+                }
+            });
+
+            runner.run("expressions", "d+=a-b", "expand", type, n, 4 * bytes, 2.0 * n, [&] {
+                *d += *a - *b;
+            });
+            runner.run("expressions", "d+=a-b", "loop", type, n, 4 * bytes, 2.0 * n, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    pd[i] += pa[i] - pb[i];
+                }
+            });
+
+            T result(0);
+            escape(&result);
+            runner.run("expressions", "dot(a,b)", "expand", type, n, 2 * bytes, 2.0 * n, [&] {
+                result = dot(*a, *b);
+            });
+            runner.run("expressions", "dot(a,b)", "loop", type, n, 2 * bytes, 2.0 * n, [&] {
+                T sum(0);
+                for (std::size_t i(0); i < n; i++) {
+                    sum += pa[i] * pb[i];
+                }
+                result = sum;
+            });
+        }
+
+        template <typename T, std::size_t N>
+        void fixed(Runner& runner) {
+            run<Vector<T, N>>(runner, N, [] { return new Vector<T, N>(); });
+        }
+
+        template <typename T>
+        void dynamic(Runner& runner, std::size_t const& n) {
+            run<VectorX<T>>(runner, n, [n] { return new VectorX<T>(n); });
+        }
+
+        template <typename T>
+        void all(Runner& runner) {
+            fixed<T, 4>(runner);
+            fixed<T, 16>(runner);
+            fixed<T, 256>(runner);
+            dynamic<T>(runner, 4096);
+            dynamic<T>(runner, 1 << 16);
+            dynamic<T>(runner, 1 << 20);
+        }
+    }
+
+    void expressions(Runner& runner) {
+        all<float>(runner);
+        all<double>(runner);
+    }
+}
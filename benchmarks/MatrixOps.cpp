@@ -0,0 +1,377 @@
+//
+//  MatrixOps.cpp
+//  Expand
+//
+//  Element-wise matrix expressions, the blocked matrix product, the
+//  matrix-vector product, transposes, linear solves and products of
+//  packed symmetric, triangular and diagonal matrices, against the
+//  equivalent hand-written loops or dense products, and the matrix-vector
+//  product of matrices stored in reduced precision against the float one.
+//
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+
+#include "Benchmark.h"
+#include "Matrix.h"
+#include "MatrixStructured.h"
+
+using namespace expand;
+
+namespace bench {
+
+    namespace {
+
+        template <typename T, std::size_t N>
+        void naiveProduct(T* c, T const* a, T const* b) {
+            for (std::size_t i(0); i < N; i++) {
+                for (std::size_t j(0); j < N; j++) {
+                    T sum(0);
+                    for (std::size_t k(0); k < N; k++) {
+                        sum += a[i * N + k] * b[k * N + j];
+                    }
+                    c[i * N + j] = sum;
+                }
+            }
+        }
+
+        template <typename T, std::size_t N>
+        void run(Runner& runner) {
+            const char* type = typeName<T>();
+
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<T> dist(-1, 1);
+            std::unique_ptr<Matrix<T, N>> a(new Matrix<T, N>);
+            std::unique_ptr<Matrix<T, N>> b(new Matrix<T, N>);
+            std::unique_ptr<Matrix<T, N>> c(new Matrix<T, N>);
+            Vector<T, N> x, y;
+            for (std::size_t i(0); i < N; i++) {
+                for (std::size_t j(0); j < N; j++) {
+                    (*a)(i, j) = dist(gen);
+                    (*b)(i, j) = dist(gen);
+                }
+                x[i] = dist(gen);
+            }
+            T* pa = a->data();
+            T* pb = b->data();
+            T* pc = c->data();
+            escape(pa);
+            escape(pb);
+            escape(pc);
+            escape(&x[0]);
+            escape(&y[0]);
+
+            std::size_t const n = N * N;
+            double const bytes = double(n) * sizeof(T);
+
+            runner.run("matrix", "c=a+b", "expand", type, N, 3 * bytes, double(n), [&] {
+                *c = *a + *b;
+            });
+            runner.run("matrix", "c=a+b", "loop", type, N, 3 * bytes, double(n), [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    pc[i] = pa[i] + pb[i];
+                }
+            });
+
+            runner.run("matrix", "c-=hadamard", "expand", type, N, 3 * bytes, 2.0 * n, [&] {
+                *c -= hadamard(*a, *b);
+            });
+            runner.run("matrix", "c-=hadamard", "loop", type, N, 3 * bytes, 2.0 * n, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    pc[i] -= pa[i] * pb[i];
+                }
+            });
+
+            runner.run("matrix", "c=a*s", "expand", type, N, 2 * bytes, double(n), [&] {
+                *c = *a * T(2);
+            });
+            runner.run("matrix", "c=a*s", "loop", type, N, 2 * bytes, double(n), [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    pc[i] = pa[i] * T(2);
+                }
+            });
+
+            runner.run("matrix", "c=a*b", "expand", type, N, 3 * bytes, 2.0 * n * N, [&] {
+                *c = *a * *b;
+            });
+            runner.run("matrix", "c=a*b", "naive", type, N, 3 * bytes, 2.0 * n * N, [&] {
+                naiveProduct<T, N>(pc, pa, pb);
+            });
+
+            runner.run("matrix", "y=a*x", "expand", type, N, bytes, 2.0 * n, [&] {
+                y = *a * x;
+            });
+            runner.run("matrix", "y=a*x", "loop", type, N, bytes, 2.0 * n, [&] {
+                for (std::size_t i(0); i < N; i++) {
+                    T sum(0);
+                    for (std::size_t k(0); k < N; k++) {
+                        sum += pa[i * N + k] * x[k];
+                    }
+                    y[i] = sum;
+                }
+            });
+        }
+
+        template <typename T, std::size_t N>
+        void transposes(Runner& runner) {
+            const char* type = typeName<T>();
+
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<T> dist(-1, 1);
+            std::unique_ptr<Matrix<T, N>> a(new Matrix<T, N>);
+            std::unique_ptr<Matrix<T, N>> c(new Matrix<T, N>);
+            Vector<T, N> x, y;
+            for (std::size_t i(0); i < N; i++) {
+                for (std::size_t j(0); j < N; j++) {
+                    (*a)(i, j) = dist(gen);
+                }
+                x[i] = dist(gen);
+            }
+            T* pa = a->data();
+            T* pc = c->data();
+            escape(pa);
+            escape(pc);
+            escape(&x[0]);
+            escape(&y[0]);
+
+            std::size_t const n = N * N;
+            double const bytes = double(n) * sizeof(T);
+
+            runner.run("matrix", "c=transpose(a)", "expand", type, N, 2 * bytes, 0, [&] {
+                *c = transpose(*a);
+            });
+            runner.run("matrix", "c=transpose(a)", "loop", type, N, 2 * bytes, 0, [&] {
+                for (std::size_t i(0); i < N; i++) {
+                    for (std::size_t j(0); j < N; j++) {
+                        pc[j * N + i] = pa[i * N + j];
+                    }
+                }
+            });
+
+            runner.run("matrix", "a.transposeInPlace", "expand", type, N, 2 * bytes, 0, [&] {
+                a->transposeInPlace();
+            });
+            runner.run("matrix", "a.transposeInPlace", "loop", type, N, 2 * bytes, 0, [&] {
+                for (std::size_t i(0); i < N; i++) {
+                    for (std::size_t j(i + 1); j < N; j++) {
+                        std::swap(pa[i * N + j], pa[j * N + i]);
+                    }
+                }
+            });
+
+            runner.run("matrix", "y=transpose(a)*x", "expand", type, N, bytes, 2.0 * n, [&] {
+                y = transpose(*a) * x;
+            });
+            runner.run("matrix", "y=transpose(a)*x", "loop", type, N, bytes, 2.0 * n, [&] {
+                for (std::size_t j(0); j < N; j++) {
+                    T sum(0);
+                    for (std::size_t k(0); k < N; k++) {
+                        sum += pa[k * N + j] * x[k];
+                    }
+                    y[j] = sum;
+                }
+            });
+        }
+
+        // Gaussian elimination with partial pivoting of the n x n matrix
+        // at a, overwriting b with the solution of a x = b
+        template <typename T, std::size_t N>
+        void naiveSolve(T* a, T* b) {
+            for (std::size_t k(0); k < N; k++) {
+                std::size_t p(k);
+                for (std::size_t i(k + 1); i < N; i++) {
+                    if (std::abs(a[i * N + k]) > std::abs(a[p * N + k])) {
+                        p = i;
+                    }
+                }
+                for (std::size_t j(0); j < N; j++) {
+                    std::swap(a[k * N + j], a[p * N + j]);
+                }
+                std::swap(b[k], b[p]);
+                for (std::size_t i(k + 1); i < N; i++) {
+                    T const l = a[i * N + k] / a[k * N + k];
+                    for (std::size_t j(k); j < N; j++) {
+                        a[i * N + j] -= l * a[k * N + j];
+                    }
+                    b[i] -= l * b[k];
+                }
+            }
+            for (std::size_t i(N); i-- > 0;) {
+                for (std::size_t j(i + 1); j < N; j++) {
+                    b[i] -= a[i * N + j] * b[j];
+                }
+                b[i] /= a[i * N + i];
+            }
+        }
+
+        template <typename T, std::size_t N>
+        void solves(Runner& runner) {
+            const char* type = typeName<T>();
+
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<T> dist(-1, 1);
+            std::unique_ptr<Matrix<T, N>> a(new Matrix<T, N>);
+            std::unique_ptr<Matrix<T, N>> s(new Matrix<T, N>);
+            std::unique_ptr<Matrix<T, N>> w(new Matrix<T, N>);
+            Vector<T, N> x, y;
+            for (std::size_t i(0); i < N; i++) {
+                for (std::size_t j(0); j < N; j++) {
+                    (*a)(i, j) = dist(gen);
+                }
+                x[i] = dist(gen);
+            }
+            *s = *a * transpose(*a);
+            for (std::size_t i(0); i < N; i++) {
+                (*s)(i, i) += T(N);
+            }
+            T* pw = w->data();
+            escape(a->data());
+            escape(s->data());
+            escape(pw);
+            escape(&x[0]);
+            escape(&y[0]);
+
+            double const bytes = double(N * N) * sizeof(T);
+            double const flops = 2.0 * N * N * N / 3;
+
+            runner.run("solve", "y=lu(a).solve(x)", "expand", type, N, bytes, flops, [&] {
+                y = a->lu().solve(x);
+            });
+            runner.run("solve", "y=lu(a).solve(x)", "loop", type, N, bytes, flops, [&] {
+                *w = *a;
+                y = x;
+                naiveSolve<T, N>(pw, &y[0]);
+            });
+
+            runner.run("solve", "y=cholesky(s).solve(x)", "expand", type, N, bytes, flops / 2, [&] {
+                y = s->cholesky().solve(x);
+            });
+
+            runner.run("solve", "w=inverse(a)", "expand", type, N, 2 * bytes, 3 * flops, [&] {
+                *w = inverse(*a);
+            });
+        }
+
+        template <typename T, std::size_t N>
+        void structured(Runner& runner) {
+            const char* type = typeName<T>();
+
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<T> dist(-1, 1);
+            std::unique_ptr<Matrix<T, N>> a(new Matrix<T, N>);
+            std::unique_ptr<Matrix<T, N>> c(new Matrix<T, N>);
+            Vector<T, N> x, y;
+            for (std::size_t i(0); i < N; i++) {
+                for (std::size_t j(0); j <= i; j++) {
+                    (*a)(i, j) = (*a)(j, i) = dist(gen);
+                }
+                x[i] = dist(gen);
+            }
+            SymmetricMatrix<T, Dynamic> s(*a);
+            TriangularMatrix<T, Dynamic> l(*a);
+            DiagonalMatrix<T, N> d(x);
+            escape(a->data());
+            escape(c->data());
+            escape(s.data());
+            escape(l.data());
+            escape(&x[0]);
+            escape(&y[0]);
+
+            double const bytes = double(N * N) * sizeof(T);
+
+            runner.run("structured", "y=s*x", "packed", type, N, bytes / 2, 2.0 * N * N, [&] {
+                y = s * x;
+            });
+            runner.run("structured", "y=s*x", "dense", type, N, bytes, 2.0 * N * N, [&] {
+                y = *a * x;
+            });
+
+            runner.run("structured", "y=l*x", "packed", type, N, bytes / 2, double(N * N), [&] {
+                y = l * x;
+            });
+            runner.run("structured", "y=x-l*x", "packed", type, N, bytes / 2, double(N * N), [&] {
+                y = x - l * x;
+            });
+
+            runner.run("structured", "c=d*a", "expand", type, N, 2 * bytes, double(N * N), [&] {
+                *c = d * *a;
+            });
+            runner.run("structured", "c=d*a", "loop", type, N, 2 * bytes, double(N * N), [&] {
+                for (std::size_t i(0); i < N; i++) {
+                    for (std::size_t j(0); j < N; j++) {
+                        (*c)(i, j) = x[i] * (*a)(i, j);
+                    }
+                }
+            });
+        }
+
+        // bandwidth-bound products of matrices of half, bfloat16 and 8-bit
+        // integers by a vector of floats, computed in single precision
+        template <std::size_t N>
+        void reduced(Runner& runner) {
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<float> dist(-1, 1);
+            MatrixX<float> a(N, N);
+            VectorX<float> x(N), y(N);
+            for (std::size_t i(0); i < N; i++) {
+                for (std::size_t j(0); j < N; j++) {
+                    a(i, j) = dist(gen);
+                }
+                x[i] = dist(gen);
+            }
+            float const scale = 1.0f / 127;
+            MatrixX<half> h(a);
+            MatrixX<bfloat16> b(a);
+            MatrixX<std::int8_t> q(quantize(a, scale));
+            escape(a.data());
+            escape(h.data());
+            escape(b.data());
+            escape(q.data());
+            escape(&x[0]);
+            escape(&y[0]);
+
+            double const n = double(N) * N;
+
+            runner.run("reduced", "y=a*x", "expand", "float", N, 4 * n, 2 * n, [&] {
+                y = a * x;
+            });
+            runner.run("reduced", "y=a*x", "expand", "half", N, 2 * n, 2 * n, [&] {
+                y = h * x;
+            });
+            runner.run("reduced", "y=a*x", "expand", "bfloat16", N, 2 * n, 2 * n, [&] {
+                y = b * x;
+            });
+            runner.run("reduced", "y=a*x", "expand", "int8", N, n, 2 * n, [&] {
+                y = dequantize(q, scale) * x;
+            });
+        }
+
+        template <typename T>
+        void all(Runner& runner) {
+            run<T, 4>(runner);
+            run<T, 16>(runner);
+            run<T, 64>(runner);
+            run<T, 256>(runner);
+            run<T, 512>(runner);
+            transposes<T, 64>(runner);
+            transposes<T, 512>(runner);
+            transposes<T, 1024>(runner);
+            solves<T, 3>(runner);
+            solves<T, 6>(runner);
+            solves<T, 64>(runner);
+            solves<T, 512>(runner);
+            structured<T, 64>(runner);
+            structured<T, 1024>(runner);
+        }
+    }
+
+    void matrices(Runner& runner) {
+        all<float>(runner);
+        all<double>(runner);
+        reduced<1024>(runner);
+        reduced<4096>(runner);
+    }
+}
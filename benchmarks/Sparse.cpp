@@ -0,0 +1,107 @@
+//
+//  Sparse.cpp
+//  Expand
+//
+//  Products of the 5-point Laplacian of a square grid, stored in CSR and
+//  CSC order, with vectors against hand-written CSR loops, and its
+//  compression from triplets.
+//
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "SparseMatrix.h"
+
+using namespace expand;
+
+namespace bench {
+
+    namespace {
+
+        template <typename T>
+        void run(Runner& runner, std::size_t side) {
+            const char* type = typeName<T>();
+            std::size_t const n = side * side;
+
+            SparseBuilder<T> builder(n, n);
+            builder.reserve(5 * n);
+            for (std::size_t i(0); i < side; i++) {
+                for (std::size_t j(0); j < side; j++) {
+                    std::size_t const k = i * side + j;
+                    builder.add(k, k, T(4));
+                    if (i > 0) {
+                        builder.add(k, k - side, T(-1));
+                    }
+                    if (i + 1 < side) {
+                        builder.add(k, k + side, T(-1));
+                    }
+                    if (j > 0) {
+                        builder.add(k, k - 1, T(-1));
+                    }
+                    if (j + 1 < side) {
+                        builder.add(k, k + 1, T(-1));
+                    }
+                }
+            }
+            SparseMatrix<T> A(builder);
+            SparseMatrix<T, CSC> C(A);
+            VectorX<T> x(n, T(1)), b(n, T(2)), y(n), r(n);
+            const std::size_t* offsets = A.offsets();
+            const std::size_t* indices = A.indices();
+            const T* values = A.values();
+            const T* px = x.elements();
+            const T* pb = b.elements();
+            T* py = y.elements();
+            T* pr = r.elements();
+            escape(px);
+            escape(pb);
+
+            double const bytes = double(A.nonZeros()) * (sizeof(T) + sizeof(std::size_t)) + 2.0 * n * sizeof(T);
+            double const flops = 2.0 * A.nonZeros();
+
+            runner.run("sparse", "y=A*x", "expand", type, n, bytes, flops, [&] {
+                y = A * x;
+            });
+            runner.run("sparse", "y=A*x", "loop", type, n, bytes, flops, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    T sum(0);
+                    for (std::size_t k(offsets[i]); k < offsets[i + 1]; k++) {
+                        sum += values[k] * px[indices[k]];
+                    }
+                    py[i] = sum;
+                }
+            });
+
+            runner.run("sparse", "r=b-A*x", "expand", type, n, bytes + n * sizeof(T), flops + n, [&] {
+                r = b - A * x;
+            });
+            runner.run("sparse", "r=b-A*x", "loop", type, n, bytes + n * sizeof(T), flops + n, [&] {
+                for (std::size_t i(0); i < n; i++) {
+                    T sum(0);
+                    for (std::size_t k(offsets[i]); k < offsets[i + 1]; k++) {
+                        sum += values[k] * px[indices[k]];
+                    }
+                    pr[i] = pb[i] - sum;
+                }
+            });
+
+            runner.run("sparse", "y=transpose(A)*x", "csr", type, n, bytes, flops, [&] {
+                y = transpose(A) * x;
+            });
+            runner.run("sparse", "y=transpose(A)*x", "csc", type, n, bytes, flops, [&] {
+                y = transpose(C) * x;
+            });
+
+            runner.run("sparse", "build", "expand", type, n, 2 * double(builder.size()) * sizeof(typename SparseBuilder<T>::Triplet), 0, [&] {
+                SparseMatrix<T> B(builder);
+                escape(B.values());
+            });
+        }
+    }
+
+    void sparse(Runner& runner) {
+        run<float>(runner, 64);
+        run<double>(runner, 64);
+        run<double>(runner, 512);
+    }
+}
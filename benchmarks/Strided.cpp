@@ -0,0 +1,82 @@
+//
+//  Strided.cpp
+//  Expand
+//
+//  Access through the strided column and trace views of fixed-size
+//  matrices, against the equivalent hand-written loops.
+//
+
+#include <memory>
+#include <random>
+
+#include "Benchmark.h"
+#include "Matrix.h"
+
+using namespace expand;
+
+namespace bench {
+
+    namespace {
+
+        template <typename T, std::size_t N>
+        void run(Runner& runner) {
+            const char* type = typeName<T>();
+
+            std::mt19937 gen(42);
+            std::uniform_real_distribution<T> dist(-1, 1);
+            std::unique_ptr<Matrix<T, N>> m(new Matrix<T, N>);
+            for (std::size_t i(0); i < N; i++) {
+                for (std::size_t j(0); j < N; j++) {
+                    (*m)(i, j) = dist(gen);
+                }
+            }
+            Vector<T, N> acc(T(0));
+            T trace(0);
+            escape(m->data());
+            escape(&acc[0]);
+            escape(&trace);
+
+            double const bytes = double(N) * N * sizeof(T);
+
+            // sum of the columns
+            runner.run("strided", "getCol", "expand", type, N, bytes, double(N) * N, [&] {
+                for (std::size_t j(0); j < N; j++) {
+                    acc += m->getCol(int(j));
+                }
+            });
+            runner.run("strided", "getCol", "loop", type, N, bytes, double(N) * N, [&] {
+                T const* p = m->data();
+                for (std::size_t j(0); j < N; j++) {
+                    for (std::size_t i(0); i < N; i++) {
+                        acc[i] += p[i * N + j];
+                    }
+                }
+            });
+
+            runner.run("strided", "getTrace", "expand", type, N, double(N) * sizeof(T), double(N), [&] {
+                trace = sum(m->getTrace());
+            });
+            runner.run("strided", "getTrace", "loop", type, N, double(N) * sizeof(T), double(N), [&] {
+                T const* p = m->data();
+                T t(0);
+                for (std::size_t i(0); i < N; i++) {
+                    t += p[i * (N + 1)];
+                }
+                trace = t;
+            });
+        }
+
+        template <typename T>
+        void all(Runner& runner) {
+            run<T, 4>(runner);
+            run<T, 16>(runner);
+            run<T, 64>(runner);
+            run<T, 256>(runner);
+        }
+    }
+
+    void strided(Runner& runner) {
+        all<float>(runner);
+        all<double>(runner);
+    }
+}
@@ -0,0 +1,235 @@
+//
+//  Matrices.cpp
+//  Expand
+//
+//  Matrix expressions, products and transposes against triple loops, packed
+//  structured matrices against the dense ones they hold, and the residuals
+//  of the LU and Cholesky solvers.
+//
+
+#include <cmath>
+#include <vector>
+
+#include "Matrix.h"
+#include "MatrixStructured.h"
+#include "Test.h"
+
+using namespace expand;
+
+namespace test {
+
+    namespace {
+
+        template <typename M>
+        void fill(M& a, Random& random) {
+            for (std::size_t i(0); i < a.rows(); i++) {
+                for (std::size_t j(0); j < a.cols(); j++) {
+                    a(i, j) = typename M::value_type(random());
+                }
+            }
+        }
+
+        // zeroed \c n x \c n matrix and vector of \c n elements, of fixed
+        // size \c N unless Dynamic
+        template <std::size_t N>
+        auto square(std::size_t const& n) {
+            if constexpr (N == Dynamic) {
+                return MatrixX<double>(n, n, 0.0);
+            } else {
+                return Matrix<double, N, N>(0.0);
+            }
+        }
+
+        template <std::size_t N>
+        auto column(std::size_t const& n) {
+            if constexpr (N == Dynamic) {
+                return VectorX<double>(n, 0.0);
+            } else {
+                return Vector<double, N>(0.0);
+            }
+        }
+
+        // true when matrices \c a and \c b hold the same elements up to
+        // \c tolerance
+        template <typename M1, typename M2>
+        bool close(M1 const& a, M2 const& b, double const& tolerance) {
+            for (std::size_t i(0); i < a.rows(); i++) {
+                for (std::size_t j(0); j < a.cols(); j++) {
+                    if (!near(double(a(i, j)), double(b(i, j)), tolerance)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        template <typename T>
+        void products(Checker& checker, const char* type, double const& tolerance) {
+            if (!checker.enabled("matrices", "products")) {
+                return;
+            }
+            Random random(11);
+            for (std::size_t n : {1, 3, 8, 17, 33, 64, 100, 129}) {
+                std::size_t const m = n + 2, k = n + 5;
+                MatrixX<T> a(m, k), b(k, n);
+                fill(a, random);
+                fill(b, random);
+                VectorX<T> x(k);
+                for (std::size_t j(0); j < k; j++) {
+                    x[j] = T(random());
+                }
+
+                MatrixX<T> reference(m, n, T(0));
+                for (std::size_t i(0); i < m; i++) {
+                    for (std::size_t l(0); l < k; l++) {
+                        for (std::size_t j(0); j < n; j++) {
+                            reference(i, j) += a(i, l) * b(l, j);
+                        }
+                    }
+                }
+                MatrixX<T> const c = a * b;
+                checker.check(close(c, reference, tolerance), "matrices", "a*b", n, type);
+
+                std::vector<T> y(m, T(0));
+                for (std::size_t i(0); i < m; i++) {
+                    for (std::size_t l(0); l < k; l++) {
+                        y[i] += a(i, l) * x[l];
+                    }
+                }
+                VectorX<T> const ax = a * x;
+                checker.check(test::close(ax, y, m, tolerance), "matrices", "a*x", n, type);
+                VectorX<T> const r = ax * T(2) - a * x;
+                checker.check(test::close(r, y, m, tolerance), "matrices", "2ax-a*x", n, type);
+
+                MatrixX<T> const t = transpose(a);
+                bool passed(t.rows() == k && t.cols() == m);
+                for (std::size_t i(0); passed && i < m; i++) {
+                    for (std::size_t j(0); j < k; j++) {
+                        passed = passed && t(j, i) == a(i, j);
+                    }
+                }
+                checker.check(passed, "matrices", "transpose", n, type);
+
+                MatrixX<T> const s = a * T(2) + a - hadamard(a, a);
+                passed = true;
+                for (std::size_t i(0); i < m; i++) {
+                    for (std::size_t j(0); j < k; j++) {
+                        passed = passed && near(s(i, j), a(i, j) * T(3) - a(i, j) * a(i, j), tolerance);
+                    }
+                }
+                checker.check(passed, "matrices", "2a+a-a.*a", n, type);
+            }
+
+            Matrix<T, 4, 4> a, b;
+            fill(a, random);
+            fill(b, random);
+            Matrix<T, 4, 4> reference(T(0));
+            for (std::size_t i(0); i < 4; i++) {
+                for (std::size_t l(0); l < 4; l++) {
+                    for (std::size_t j(0); j < 4; j++) {
+                        reference(i, j) += a(i, l) * b(l, j);
+                    }
+                }
+            }
+            Matrix<T, 4, 4> const c = a * b;
+            checker.check(close(c, reference, tolerance), "matrices", "fixed a*b", 4, type);
+        }
+
+        template <std::size_t N>
+        void structured(Checker& checker, std::size_t const& n) {
+            if (!checker.enabled("matrices", "structured")) {
+                return;
+            }
+            typedef decltype(square<N>(n)) M;
+            typedef decltype(column<N>(n)) V;
+            Random random(13);
+            M a = square<N>(n);
+            V x = column<N>(n);
+            for (std::size_t i(0); i < n; i++) {
+                x[i] = random();
+                for (std::size_t j(0); j <= i; j++) {
+                    a(i, j) = a(j, i) = random();
+                }
+            }
+            SymmetricMatrix<double, N> const s(a);
+            TriangularMatrix<double, N> const l(a);
+            TriangularMatrix<double, N, Upper> const u(a);
+
+            std::vector<double> sx(n, 0.0), lx(n, 0.0), ux(n, 0.0);
+            for (std::size_t i(0); i < n; i++) {
+                for (std::size_t j(0); j < n; j++) {
+                    sx[i] += a(i, j) * x[j];
+                    lx[i] += j <= i ? a(i, j) * x[j] : 0.0;
+                    ux[i] += j >= i ? a(i, j) * x[j] : 0.0;
+                }
+            }
+            V const ys = s * x, yl = l * x, yu = u * x;
+            checker.check(test::close(ys, sx, n, 1e-12), "matrices", "symmetric*x", n, "double");
+            checker.check(test::close(yl, lx, n, 1e-12), "matrices", "lower*x", n, "double");
+            checker.check(test::close(yu, ux, n, 1e-12), "matrices", "upper*x", n, "double");
+
+            DiagonalMatrix<double, N> const d(x);
+            M const da = d * a;
+            bool passed(true);
+            for (std::size_t i(0); i < n; i++) {
+                for (std::size_t j(0); j < n; j++) {
+                    passed = passed && da(i, j) == x[i] * a(i, j);
+                }
+            }
+            checker.check(passed, "matrices", "diagonal*a", n, "double");
+        }
+
+        template <std::size_t N>
+        void solvers(Checker& checker, std::size_t const& n) {
+            if (!checker.enabled("matrices", "solvers")) {
+                return;
+            }
+            typedef decltype(square<N>(n)) M;
+            typedef decltype(column<N>(n)) V;
+            Random random(17);
+            M a = square<N>(n);
+            fill(a, random);
+            V b = column<N>(n);
+            for (std::size_t i(0); i < n; i++) {
+                b[i] = random();
+                a(i, i) += 4;
+            }
+
+            V const x = solve(a, b);
+            V const r = a * x - b;
+            checker.check(test::close(r, std::vector<double>(n, 0.0), n, 1e-10), "matrices", "lu residual", n, "double");
+
+            M product = a * inverse(a);
+            bool passed(true);
+            for (std::size_t i(0); i < n; i++) {
+                for (std::size_t j(0); j < n; j++) {
+                    passed = passed && near(product(i, j), i == j ? 1.0 : 0.0, 1e-10);
+                }
+            }
+            checker.check(passed, "matrices", "inverse", n, "double");
+
+            // symmetric positive definite
+            M s = a * transpose(a);
+            auto const cholesky = s.cholesky();
+            checker.check(cholesky.positive(), "matrices", "cholesky positive", n, "double");
+            V const y = cholesky.solve(b);
+            V const q = s * y - b;
+            checker.check(test::close(q, std::vector<double>(n, 0.0), n, 1e-9), "matrices", "cholesky residual", n,
+                          "double");
+        }
+    }
+
+    void matrices(Checker& checker) {
+        products<float>(checker, "float", 1e-4);
+        products<double>(checker, "double", 1e-12);
+        structured<7>(checker, 7);
+        structured<40>(checker, 40);
+        structured<Dynamic>(checker, 1);
+        structured<Dynamic>(checker, 129);
+        solvers<3>(checker, 3);
+        solvers<9>(checker, 9);
+        solvers<Dynamic>(checker, 1);
+        solvers<Dynamic>(checker, 70);
+        solvers<Dynamic>(checker, 301);
+    }
+}
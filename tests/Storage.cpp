@@ -0,0 +1,240 @@
+//
+//  Storage.cpp
+//  Expand
+//
+//  Conversions of half and bfloat16 against exhaustive decoding and the
+//  rounding of the values between consecutive ones, int8 quantization and
+//  its dequantizing products against scalar loops, and sparse products
+//  against the dense matrices they hold.
+//
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "Matrix.h"
+#include "SparseMatrix.h"
+#include "Test.h"
+
+using namespace expand;
+
+namespace test {
+
+    namespace {
+
+        float fromBits(std::uint32_t const& u) {
+            float f;
+            std::memcpy(&f, &u, sizeof(f));
+            return f;
+        }
+
+        std::uint32_t toBits(float const& f) {
+            std::uint32_t u;
+            std::memcpy(&u, &f, sizeof(u));
+            return u;
+        }
+
+        // value of the half-precision number of bits \c h
+        double decodeHalf(std::uint16_t const& h) {
+            int const exponent = (h >> 10) & 31;
+            int const mantissa = h & 1023;
+            double const sign = h & 0x8000 ? -1.0 : 1.0;
+            if (exponent == 31) {
+                return mantissa ? std::numeric_limits<double>::quiet_NaN() : sign * HUGE_VAL;
+            }
+            return sign * (exponent ? std::ldexp(1024 + mantissa, exponent - 25) : std::ldexp(mantissa, -24));
+        }
+
+        /**
+         *
+         * Checks the rounding of storage type \c S, whose positive finite
+         * values are those of bits [1, \c largest] decoded by \c decode: the
+         * values just below, at and just above the midpoint between
+         * consecutive ones round to the lower one, to the one of even bits
+         * and to the upper one, both one by one and by packets.
+         *
+         */
+        template <typename S, typename D>
+        void rounding(Checker& checker, const char* type, std::uint16_t const& largest, D const& decode) {
+            std::vector<float> values;
+            std::vector<std::uint16_t> expected;
+            for (std::uint32_t bits(1); bits < largest; bits++) {
+                float const low = float(decode(std::uint16_t(bits)));
+                float const high = float(decode(std::uint16_t(bits + 1)));
+                float const middle = float((double(low) + double(high)) / 2);
+                values.insert(values.end(), {low, std::nextafter(middle, low), middle, std::nextafter(middle, high)});
+                expected.insert(expected.end(), {std::uint16_t(bits), std::uint16_t(bits), std::uint16_t(bits + (bits & 1)),
+                                                 std::uint16_t(bits + 1)});
+            }
+            std::size_t const n = values.size();
+            for (std::size_t i(0); i < n; i++) {
+                values.push_back(-values[i]);
+                expected.push_back(std::uint16_t(expected[i] | 0x8000));
+            }
+
+            VectorX<float> wide(values.size());
+            for (std::size_t i(0); i < values.size(); i++) {
+                wide[i] = values[i];
+            }
+            VectorX<S> const narrow = wide * 1.0f;
+            bool packed(true), scalar(true);
+            for (std::size_t i(0); i < values.size(); i++) {
+                packed = packed && narrow[i].bits == expected[i];
+                scalar = scalar && S(values[i]).bits == expected[i];
+            }
+            checker.check(packed, "storage", "round packets", values.size(), type);
+            checker.check(scalar, "storage", "round scalars", values.size(), type);
+        }
+
+        void halves(Checker& checker) {
+            if (!checker.enabled("storage", "half")) {
+                return;
+            }
+            // every half except NaNs widened by packets and one by one
+            VectorX<half> h(65536 - 2 * 1023);
+            std::size_t n(0);
+            for (std::uint32_t bits(0); bits < 65536; bits++) {
+                if (!std::isnan(decodeHalf(std::uint16_t(bits)))) {
+                    h[n++].bits = std::uint16_t(bits);
+                }
+            }
+            VectorX<float> const wide = h * 1.0f;
+            bool packed(true), scalar(true);
+            for (std::size_t i(0); i < n; i++) {
+                double const value = decodeHalf(h[i].bits);
+                packed = packed && double(wide[i]) == value && std::signbit(wide[i]) == std::signbit(value);
+                scalar = scalar && double(float(h[i])) == value;
+            }
+            checker.check(packed, "storage", "widen packets", n, "half");
+            checker.check(scalar, "storage", "widen scalars", n, "half");
+
+            rounding<half>(checker, "half", 0x7bff, decodeHalf);
+
+            VectorX<float> const large(37, 65520.0f);
+            VectorX<half> const infinite = large * 1.0f;
+            checker.check(infinite[36].bits == 0x7c00 && half(65519.0f).bits == 0x7bff, "storage", "overflow", 37, "half");
+        }
+
+        void bfloats(Checker& checker) {
+            if (!checker.enabled("storage", "bfloat16")) {
+                return;
+            }
+            rounding<bfloat16>(checker, "bfloat16", 0x7f7f, [](std::uint16_t const& b) {
+                return double(fromBits(std::uint32_t(b) << 16));
+            });
+
+            // sums computed in single precision, rounded once
+            VectorX<bfloat16> a(100), b(100);
+            for (std::size_t i(0); i < 100; i++) {
+                a[i] = float(i) + 0.25f;
+                b[i] = float(i) * 3.0f;
+            }
+            VectorX<bfloat16> const c = a + b * 2.0f;
+            bool passed(true);
+            for (std::size_t i(0); i < 100; i++) {
+                float const exact = float(a[i]) + float(b[i]) * 2.0f;
+                std::uint32_t const u = toBits(exact);
+                passed = passed && c[i].bits == std::uint16_t((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+            }
+            checker.check(passed, "storage", "a+b*2", 100, "bfloat16");
+        }
+
+        void quantized(Checker& checker) {
+            if (!checker.enabled("storage", "int8")) {
+                return;
+            }
+            Random random(19);
+            float const scale = 0.0125f;
+            for (std::size_t n : {1, 15, 16, 17, 64, 100, 1000}) {
+                VectorX<float> x(n);
+                for (std::size_t i(0); i < n; i++) {
+                    x[i] = float(random() * 2);
+                }
+                VectorX<std::int8_t> const q = quantize(x, scale);
+                VectorX<float> const d = dequantize(q, scale);
+                bool quantizes(true), dequantizes(true);
+                for (std::size_t i(0); i < n; i++) {
+                    float const v = std::fmin(std::fmax(x[i] * (1 / scale), -128.0f), 127.0f);
+                    quantizes = quantizes && q[i] == std::int8_t(std::nearbyint(v));
+                    dequantizes = dequantizes && d[i] == float(q[i]) * scale;
+                }
+                checker.check(quantizes, "storage", "quantize", n, "int8");
+                checker.check(dequantizes, "storage", "dequantize", n, "int8");
+
+                std::size_t const m = n / 2 + 3;
+                MatrixX<float> a(m, n);
+                for (std::size_t i(0); i < m; i++) {
+                    for (std::size_t j(0); j < n; j++) {
+                        a(i, j) = float(random());
+                    }
+                }
+                MatrixX<std::int8_t> const qa = quantize(a, scale);
+                VectorX<float> const y = dequantize(qa, scale) * x;
+                std::vector<double> reference(m, 0.0);
+                for (std::size_t i(0); i < m; i++) {
+                    for (std::size_t j(0); j < n; j++) {
+                        reference[i] += double(qa(i, j)) * scale * x[j];
+                    }
+                }
+                checker.check(test::close(y, reference, m, 1e-4), "storage", "dequantize(A)*x", n, "int8");
+            }
+        }
+
+        void sparse(Checker& checker) {
+            if (!checker.enabled("storage", "sparse")) {
+                return;
+            }
+            Random random(23);
+            for (std::size_t m : {1, 7, 300, 3000}) {
+                std::size_t const n = m + 3;
+                SparseBuilder<double> builder(m, n);
+                std::vector<double> dense(m * n, 0.0);
+                for (std::size_t k(0); k < m * 10; k++) {
+                    std::size_t const i = random.below(m), j = random.below(n);
+                    double const value = random();
+                    builder.add(i, j, value);
+                    dense[i * n + j] += value;
+                }
+                SparseMatrix<double> const a(builder);
+                SparseMatrix<double, CSC> const c(builder);
+
+                VectorX<double> x(n), z(m);
+                for (std::size_t j(0); j < n; j++) {
+                    x[j] = random();
+                }
+                for (std::size_t i(0); i < m; i++) {
+                    z[i] = random();
+                }
+                std::vector<double> ax(m, 0.0), atz(n, 0.0);
+                for (std::size_t i(0); i < m; i++) {
+                    for (std::size_t j(0); j < n; j++) {
+                        ax[i] += dense[i * n + j] * x[j];
+                        atz[j] += dense[i * n + j] * z[i];
+                    }
+                }
+                VectorX<double> y = a * x;
+                checker.check(test::close(y, ax, m, 1e-12), "storage", "csr*x", m, "double");
+                y = c * x;
+                checker.check(test::close(y, ax, m, 1e-12), "storage", "csc*x", m, "double");
+                VectorX<double> w = transpose(a) * z;
+                checker.check(test::close(w, atz, n, 1e-12), "storage", "transpose(csr)*z", m, "double");
+                w = transpose(c) * z;
+                checker.check(test::close(w, atz, n, 1e-12), "storage", "transpose(csc)*z", m, "double");
+                VectorX<double> r = z - a * x;
+                for (std::size_t i(0); i < m; i++) {
+                    ax[i] = z[i] - ax[i];
+                }
+                checker.check(test::close(r, ax, m, 1e-12), "storage", "z-csr*x", m, "double");
+            }
+        }
+    }
+
+    void storage(Checker& checker) {
+        halves(checker);
+        bfloats(checker);
+        quantized(checker);
+        sparse(checker);
+    }
+}
@@ -0,0 +1,41 @@
+//
+//  Test.cpp
+//  Expand
+//
+//  Runs the test suites against the instruction set selected at runtime,
+//  which EXPAND_ISA narrows, and fails when any check does.
+//
+//  Test [--filter=TEXT]
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Matrix.h"
+#include "Test.h"
+
+using namespace test;
+
+int main(int argc, char** argv) {
+    std::string filter;
+
+    for (int i(1); i < argc; i++) {
+        if (std::strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else {
+            std::fprintf(stderr, "usage: %s [--filter=TEXT]\n", argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    Checker checker(filter);
+    vectors(checker);
+    matrices(checker);
+    storage(checker);
+
+    std::printf("%zu checks, %zu failed, simd %d bytes, isa %s\n", checker.checks(), checker.failures(),
+                EXPAND_SIMD_BYTES, expand::isaName(expand::isa()));
+    return checker.failures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,141 @@
+//
+//  Test.h
+//  Expand
+//
+//  Checks shared by the test suites, which compare the results of the
+//  library against naive reference loops.
+//
+
+#ifndef Test_h
+#define Test_h
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace test {
+
+    // --------------------------------------------------------------------
+    // checker
+    // --------------------------------------------------------------------
+
+    /**
+     *
+     * Counts the checks of the suites and reports the failed ones as
+     * "suite/name/size: message", the first failures of each check only.
+     *
+     */
+    class Checker {
+
+    public:
+
+        Checker(std::string const& filter) : _filter(filter) {}
+
+        // true unless "suite/name" does not contain the filter, in which
+        // case the checks of \c name are to be skipped
+        bool enabled(const char* suite, const char* name) const {
+            return (std::string(suite) + "/" + name).find(_filter) != std::string::npos;
+        }
+
+        bool check(bool const& passed, const char* suite, const char* name, std::size_t const& size,
+                   const char* message) {
+            _checks++;
+            if (!passed) {
+                if (_failures < 100) {
+                    std::printf("FAILED %s/%s/%zu: %s\n", suite, name, size, message);
+                }
+                _failures++;
+            }
+            return passed;
+        }
+
+        std::size_t checks() const {
+            return _checks;
+        }
+
+        std::size_t failures() const {
+            return _failures;
+        }
+
+    private:
+
+        std::string _filter;
+        std::size_t _checks = 0;
+        std::size_t _failures = 0;
+    };
+
+    // --------------------------------------------------------------------
+    // comparisons
+    // --------------------------------------------------------------------
+
+    // true when \c a and \c b differ by at most \c tolerance relatively to
+    // the largest of them, or absolutely below 1
+    inline bool near(double const& a, double const& b, double const& tolerance) {
+        double const scale = std::fmax(1.0, std::fmax(std::fabs(a), std::fabs(b)));
+        return std::fabs(a - b) <= tolerance * scale;
+    }
+
+    // true when the \c n elements of \c v equal those of the reference \c r
+    template <typename V, typename R>
+    bool equal(V const& v, R const& r, std::size_t const& n) {
+        for (std::size_t i(0); i < n; i++) {
+            if (!(v[i] == r[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // true when the \c n elements of \c v are near those of the reference \c r
+    template <typename V, typename R>
+    bool close(V const& v, R const& r, std::size_t const& n, double const& tolerance) {
+        for (std::size_t i(0); i < n; i++) {
+            if (!near(double(v[i]), double(r[i]), tolerance)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // pseudo-random values in [-1, 1), the same on every platform
+    class Random {
+
+    public:
+
+        Random(std::uint32_t const& seed) : _state(seed * 2654435761u + 1) {}
+
+        double operator()() {
+            _state = _state * 1664525u + 1013904223u;
+            return double(_state >> 8) / double(1u << 23) - 1.0;
+        }
+
+        // integer in [0, n)
+        std::size_t below(std::size_t const& n) {
+            _state = _state * 1664525u + 1013904223u;
+            return std::size_t(_state >> 8) % n;
+        }
+
+    private:
+
+        std::uint32_t _state;
+    };
+
+    // --------------------------------------------------------------------
+    // suites
+    // --------------------------------------------------------------------
+
+    // vector expressions, fused multiply-adds, reductions, strided views,
+    // aligned storage and the thread pool
+    void vectors(Checker& checker);
+
+    // matrix expressions, products, transposes, structured matrices and
+    // factorizations
+    void matrices(Checker& checker);
+
+    // reduced-precision and quantized storage, and sparse matrices
+    void storage(Checker& checker);
+}
+
+#endif /* Test_h */
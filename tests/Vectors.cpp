@@ -0,0 +1,281 @@
+//
+//  Vectors.cpp
+//  Expand
+//
+//  Vector expressions of every length around the packet widths, and above
+//  the parallel threshold, against element-by-element loops.
+//
+
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include "Matrix.h"
+#include "Test.h"
+
+using namespace expand;
+
+namespace test {
+
+    namespace {
+
+        // sizes covering the scalar tails of every packet width, unrolled
+        // fixed sizes excepted, and the evaluation split across threads
+        std::vector<std::size_t> const sizes = {1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 257,
+                                                EXPAND_PARALLEL_THRESHOLD + 37};
+
+        // small integers, exact in every type and through any rounding
+        template <typename T>
+        VectorX<T> integers(std::size_t const& n, int const& offset) {
+            VectorX<T> v(n);
+            for (std::size_t i(0); i < n; i++) {
+                v[i] = T(int((i * 7 + offset) % 23) - 11);
+            }
+            return v;
+        }
+
+        template <typename T>
+        void expressions(Checker& checker, const char* type) {
+            if (!checker.enabled("vectors", "expressions")) {
+                return;
+            }
+            for (std::size_t n : sizes) {
+                VectorX<T> const a = integers<T>(n, 1), b = integers<T>(n, 5), c = integers<T>(n, 13);
+                std::vector<T> r(n);
+
+                VectorX<T> z = a + b * T(2) - c;
+                for (std::size_t i(0); i < n; i++) {
+                    r[i] = a[i] + b[i] * T(2) - c[i];
+                }
+                checker.check(equal(z, r, n), "vectors", "a+b*2-c", n, type);
+
+                z = T(3) - a * b + c * T(2);
+                for (std::size_t i(0); i < n; i++) {
+                    r[i] = T(3) - a[i] * b[i] + c[i] * T(2);
+                }
+                checker.check(equal(z, r, n), "vectors", "3-a*b+c*2", n, type);
+
+                z = a;
+                z += b;
+                z -= c * T(3);
+                z *= T(2);
+                for (std::size_t i(0); i < n; i++) {
+                    r[i] = (a[i] + b[i] - c[i] * T(3)) * T(2);
+                }
+                checker.check(equal(z, r, n), "vectors", "compound", n, type);
+
+                // aliased operands
+                z = a;
+                z = z * T(2) + z;
+                for (std::size_t i(0); i < n; i++) {
+                    r[i] = a[i] * T(3);
+                }
+                checker.check(equal(z, r, n), "vectors", "z=z*2+z", n, type);
+
+                checker.check(sum(a) == [&] {
+                    T s(0);
+                    for (std::size_t i(0); i < n; i++) {
+                        s += a[i];
+                    }
+                    return s;
+                }(), "vectors", "sum", n, type);
+
+                T low(a[0]), high(a[0]);
+                for (std::size_t i(1); i < n; i++) {
+                    low = a[i] < low ? a[i] : low;
+                    high = a[i] > high ? a[i] : high;
+                }
+                checker.check(minCoeff(a) == low && maxCoeff(a) == high, "vectors", "min/max", n, type);
+            }
+        }
+
+        // results which either are fused multiply-adds for every element or
+        // for none, whether computed by packets or by the scalar tail
+        template <typename T>
+        void fused(Checker& checker, const char* type) {
+            if (!checker.enabled("vectors", "fused")) {
+                return;
+            }
+            Random random(7);
+            for (std::size_t n : sizes) {
+                VectorX<T> a(n), b(n), c(n);
+                for (std::size_t i(0); i < n; i++) {
+                    a[i] = T(random());
+                    b[i] = T(random());
+                    c[i] = T(random());
+                }
+                VectorX<T> const z = a * b + c;
+                VectorX<T> const d = c - a * b;
+                bool fusedAll(true), plainAll(true);
+                for (std::size_t i(0); i < n; i++) {
+                    fusedAll = fusedAll && z[i] == std::fma(a[i], b[i], c[i]) && d[i] == std::fma(-a[i], b[i], c[i]);
+                    plainAll = plainAll && z[i] == a[i] * b[i] + c[i] && d[i] == c[i] - a[i] * b[i];
+                }
+                checker.check(fusedAll || plainAll, "vectors", "a*b+c", n, type);
+                T const dotted = dot(a, b);
+                T reference(0);
+                for (std::size_t i(0); i < n; i++) {
+                    reference += a[i] * b[i];
+                }
+                checker.check(near(dotted, reference, 1e-4), "vectors", "dot", n, type);
+            }
+        }
+
+        // reductions of fixed-size vectors, unrolled or not
+        template <typename T, std::size_t N>
+        void fixed(Checker& checker, const char* type) {
+            Vector<T, N> a, b;
+            T s(0);
+            for (std::size_t i(0); i < N; i++) {
+                a[i] = T(int(i % 5) - 2);
+                b[i] = T(int(i % 3));
+                s += a[i] + b[i] * T(2);
+            }
+            Vector<T, N> const z = a + b * T(2);
+            checker.check(sum(z) == s && sum(a + b * T(2)) == s, "vectors", "fixed sum", N, type);
+        }
+
+        // columns and traces of matrices, read and written through strides
+        template <typename T, std::size_t N>
+        void strided(Checker& checker, const char* type) {
+            if (!checker.enabled("vectors", "strided")) {
+                return;
+            }
+            Matrix<T, N, N> m;
+            for (std::size_t i(0); i < N; i++) {
+                for (std::size_t j(0); j < N; j++) {
+                    m(i, j) = T(int((i * N + j) % 17));
+                }
+            }
+            Matrix<T, N, N> const original = m;
+            bool passed(true);
+            for (std::size_t j(0); j < N; j++) {
+                Vector<T, N> const column = m.getCol(j) * T(2) + m.getCol(0);
+                for (std::size_t i(0); i < N; i++) {
+                    passed = passed && column[i] == original(i, j) * T(2) + original(i, 0);
+                }
+            }
+            checker.check(passed, "vectors", "read columns", N, type);
+
+            m.getCol(1) = m.getCol(2) - m.getCol(3);
+            m.getTrace() += T(1);
+            passed = true;
+            for (std::size_t i(0); i < N; i++) {
+                for (std::size_t j(0); j < N; j++) {
+                    T expected = j == 1 ? original(i, 2) - original(i, 3) : original(i, j);
+                    passed = passed && m(i, j) == (i == j ? expected + T(1) : expected);
+                }
+            }
+            checker.check(passed, "vectors", "write columns", N, type);
+        }
+
+        // true when the padding of aligned vector \c v is zeroed
+        template <typename T, std::size_t N>
+        bool zeroPadded(Vector<T, N, 0, Aligned> const& v) {
+            for (std::size_t i(N); i < Aligned::padded<T>(N); i++) {
+                if (!(v.elements()[i] == T(0))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // padded storage, whose padding stays zeroed
+        template <typename T, std::size_t N>
+        void aligned(Checker& checker, const char* type) {
+            if (!checker.enabled("vectors", "aligned")) {
+                return;
+            }
+            Vector<T, N, 0, Aligned> a, b;
+            for (std::size_t i(0); i < N; i++) {
+                a[i] = T(int(i % 9) + 1);
+                b[i] = T(int(i % 4) - 2);
+            }
+            Vector<T, N, 0, Aligned> z = a * b + a;
+            z -= b * T(2);
+            bool passed(true);
+            for (std::size_t i(0); i < N; i++) {
+                passed = passed && z[i] == a[i] * b[i] + a[i] - b[i] * T(2);
+            }
+            checker.check(passed, "vectors", "aligned", N, type);
+            checker.check(reinterpret_cast<std::uintptr_t>(z.elements()) % Aligned::alignment<T>() == 0,
+                          "vectors", "alignment", N, type);
+            checker.check(zeroPadded(z), "vectors", "zero padding", N, type);
+        }
+
+        // broadcasts over padded storage, the padding being evaluated only
+        // by those keeping it zeroed
+        void broadcasts(Checker& checker) {
+            if (!checker.enabled("vectors", "broadcasts")) {
+                return;
+            }
+            Vector<int, 40, 0, Aligned> const a(2);
+            Vector<int, 40, 0, Aligned> const b = 8 / a, c = a / 2, d = 3 * a;
+            bool passed(true);
+            for (std::size_t i(0); i < 40; i++) {
+                passed = passed && b[i] == 4 && c[i] == 1 && d[i] == 6;
+            }
+            checker.check(passed && zeroPadded(b) && zeroPadded(c) && zeroPadded(d), "vectors", "broadcast padding", 40,
+                          "int");
+
+            Vector<float, 20, 0, Aligned> x(0.f), y(2.f);
+            x += 1.f;
+            Vector<float, 20, 0, Aligned> const z = x + y, w = 1.f - y;
+            passed = true;
+            for (std::size_t i(0); i < 20; i++) {
+                passed = passed && x[i] == 1.f && z[i] == 3.f && w[i] == -1.f;
+            }
+            checker.check(passed && zeroPadded(x) && zeroPadded(z) && zeroPadded(w), "vectors", "broadcast padding", 20,
+                          "float");
+        }
+
+        void threads(Checker& checker) {
+            if (!checker.enabled("vectors", "threads")) {
+                return;
+            }
+            std::size_t const n = 100003;
+            std::vector<std::atomic<int>> visits(n);
+            parallelFor(n, 1000, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i(begin); i < end; i++) {
+                    visits[i]++;
+                }
+            });
+            bool passed(true);
+            for (std::size_t i(0); i < n; i++) {
+                passed = passed && visits[i] == 1;
+            }
+            checker.check(passed, "vectors", "parallelFor", n, "int");
+
+            std::size_t const previous = maxThreads();
+            setMaxThreads(4);
+            VectorX<double> const a = integers<double>(n, 3);
+            VectorX<double> const z = a * 2.0 + 1.0;
+            passed = true;
+            for (std::size_t i(0); i < n; i++) {
+                passed = passed && z[i] == a[i] * 2.0 + 1.0;
+            }
+            checker.check(passed, "vectors", "4 threads", n, "double");
+            setMaxThreads(previous);
+        }
+    }
+
+    void vectors(Checker& checker) {
+        expressions<float>(checker, "float");
+        expressions<double>(checker, "double");
+        expressions<int>(checker, "int");
+        fused<float>(checker, "float");
+        fused<double>(checker, "double");
+        fixed<float, 7>(checker, "float");
+        fixed<float, 20>(checker, "float");
+        fixed<double, 33>(checker, "double");
+        strided<float, 5>(checker, "float");
+        strided<double, 37>(checker, "double");
+        strided<float, 256>(checker, "float");
+        aligned<float, 3>(checker, "float");
+        aligned<float, 37>(checker, "float");
+        aligned<double, 20>(checker, "double");
+        aligned<int, 40>(checker, "int");
+        broadcasts(checker);
+        threads(checker);
+    }
+}